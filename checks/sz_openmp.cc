@@ -0,0 +1,10 @@
+#include <sz/sz.h>
+#include <sz/sz_omp.h>
+
+int main()
+{
+  size_t outsize = 0;
+  float data[8] = {0};
+  unsigned char* compressed = SZ_compress_float_3D_MDQ_openmp(data, 2, 2, 2, 1e-3f, &outsize);
+  return compressed == nullptr;
+}
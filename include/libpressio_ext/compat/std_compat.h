@@ -37,6 +37,7 @@
 #include <functional>
 #include <numeric>
 #include <memory>
+#include <utility>
 #include <pressio_version.h>
 
 #ifndef PRESSIO_COMPAT
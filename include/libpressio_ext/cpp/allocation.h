@@ -0,0 +1,175 @@
+#ifndef LIBPRESSIO_ALLOCATION_H
+#define LIBPRESSIO_ALLOCATION_H
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "pressio_data.h"
+
+/**
+ * \file
+ * \brief control over how the buffers owned by pressio_data are allocated
+ */
+
+/**
+ * the alignment in bytes of buffers allocated by libpressio, the size of a cache line and of the widest vector registers
+ */
+constexpr size_t pressio_simd_alignment = 64;
+
+/**
+ * where the pages of a buffer are placed on a machine with several NUMA nodes
+ */
+enum class pressio_numa_policy {
+  /** use the operating system default: pages are placed on the node of the thread which first touches them */
+  system,
+  /** spread the pages round robin over all NUMA nodes */
+  interleave,
+  /** touch the pages from the threads of the shared thread pool so each lands on the node of the worker which will process it */
+  local,
+  /** place the pages on a specific NUMA node */
+  node,
+};
+
+/**
+ * whether large buffers are backed by huge pages to reduce TLB misses
+ */
+enum class pressio_huge_page_policy {
+  /** use normal pages */
+  none,
+  /** align the buffer to the huge page size and advise the kernel to back it with transparent huge pages */
+  transparent,
+  /** map the buffer from the hugetlbfs pool, falling back to transparent huge pages if the pool is exhausted */
+  hugetlbfs,
+};
+
+/**
+ * how a buffer should be allocated; placement requests are best effort and are
+ * ignored on systems which do not support them
+ */
+struct pressio_allocation_policy {
+  /** where the pages of the buffer are placed */
+  pressio_numa_policy numa = pressio_numa_policy::system;
+  /** the node used by pressio_numa_policy::node */
+  int numa_node = 0;
+  /** whether buffers of at least huge_page_threshold bytes use huge pages */
+  pressio_huge_page_policy huge_pages = pressio_huge_page_policy::none;
+  /** the smallest buffer in bytes backed by huge pages */
+  size_t huge_page_threshold = 1 << 21;
+  /** the alignment of the buffer in bytes, a power of two of at least sizeof(void*); the size is padded to a multiple of it */
+  size_t alignment = pressio_simd_alignment;
+
+  /**
+   * \returns true if the policy only needs the heap
+   */
+  bool is_default() const {
+    return numa == pressio_numa_policy::system && huge_pages == pressio_huge_page_policy::none;
+  }
+
+  /**
+   * \returns the process wide policy used by pressio_data::owning, copies, and clones
+   */
+  static pressio_allocation_policy defaults();
+
+  /**
+   * sets the process wide policy
+   * \param[in] policy the new default policy
+   */
+  static void set_defaults(pressio_allocation_policy const& policy);
+};
+
+/**
+ * a buffer and the deleter which releases it
+ */
+struct pressio_allocation {
+  /** the allocated buffer, nullptr if bytes was 0 or the allocation failed */
+  void* ptr;
+  /** the function which frees ptr */
+  pressio_data_delete_fn deleter;
+  /** the metadata passed to deleter */
+  void* metadata;
+};
+
+/**
+ * allocates a buffer
+ * \param[in] bytes the size of the buffer
+ * \param[in] policy how to allocate the buffer
+ * \returns the buffer and how to free it
+ */
+pressio_allocation pressio_allocate(size_t bytes, pressio_allocation_policy const& policy);
+
+/**
+ * allocates a buffer with the process wide default policy
+ * \param[in] bytes the size of the buffer
+ * \returns the buffer and how to free it
+ */
+pressio_allocation pressio_allocate(size_t bytes);
+
+/**
+ * parses the names "system", "interleave", "local", and "node"
+ * \param[in] name the name of the policy
+ * \param[out] policy the parsed policy
+ * \returns false if the name is not recognized
+ */
+bool pressio_parse_numa_policy(std::string const& name, pressio_numa_policy& policy);
+
+/**
+ * \param[in] policy the policy to name
+ * \returns the name of a NUMA policy
+ */
+const char* pressio_numa_policy_name(pressio_numa_policy policy);
+
+/**
+ * parses the names "none", "transparent", and "hugetlbfs"
+ * \param[in] name the name of the policy
+ * \param[out] policy the parsed policy
+ * \returns false if the name is not recognized
+ */
+bool pressio_parse_huge_page_policy(std::string const& name, pressio_huge_page_policy& policy);
+
+/**
+ * \param[in] policy the policy to name
+ * \returns the name of a huge page policy
+ */
+const char* pressio_huge_page_policy_name(pressio_huge_page_policy policy);
+
+/**
+ * \param[in] alignment the alignment to check
+ * \returns true if alignment can be used as pressio_allocation_policy::alignment
+ */
+inline bool pressio_valid_alignment(size_t alignment) {
+  return alignment >= sizeof(void*) && (alignment & (alignment - 1)) == 0;
+}
+
+/**
+ * \param[in] ptr the pointer to check
+ * \param[in] alignment the alignment in bytes
+ * \returns true if ptr is a multiple of alignment
+ */
+inline bool pressio_is_aligned(const void* ptr, size_t alignment = pressio_simd_alignment) {
+  return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+/**
+ * tells the compiler that a pointer is aligned to pressio_simd_alignment so
+ * loops over it can use aligned vector instructions; debug builds assert that
+ * it is
+ *
+ * \param[in] ptr the pointer which is aligned
+ * \returns ptr
+ */
+template <class T>
+T* pressio_assume_aligned(T* ptr) {
+  assert(pressio_is_aligned(ptr));
+#if defined(__GNUC__)
+  return static_cast<T*>(__builtin_assume_aligned(ptr, pressio_simd_alignment));
+#else
+  return ptr;
+#endif
+}
+
+/**
+ * \returns the size of a huge page in bytes, 2 MiB if it cannot be determined
+ */
+size_t pressio_huge_page_size();
+
+#endif /* end of include guard: LIBPRESSIO_ALLOCATION_H */
@@ -0,0 +1,225 @@
+#ifndef LIBPRESSIO_COMPRESSED_ARRAY_H
+#define LIBPRESSIO_COMPRESSED_ARRAY_H
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pressio_dtype.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/dtype.h"
+
+/**
+ * \file
+ * \brief an array stored compressed in blocks which are decompressed on demand
+ */
+
+struct libpressio_compressor_plugin;
+
+/**
+ * an array which is stored as independently compressed blocks
+ *
+ * Reads and writes go through a least recently used cache of decompressed
+ * blocks; modified blocks are compressed again when they are evicted or when
+ * flush is called; a modified block which fails to compress stays cached
+ * until a later write back succeeds, so the cache may temporarily exceed its
+ * size.  Blocks which were never written read as zeros and use no
+ * memory.  Accesses to different blocks may run concurrently from several
+ * threads; accesses to the same block are serialized by a per-block lock.
+ * Compressors whose pressio:thread_safe is below pressio_thread_safety_multiple
+ * are called by one thread at a time, and the blocks are processed serially.
+ *
+ * Methods which return int return 0 on success; on failure the code and
+ * message are available from error_code and error_msg.
+ */
+class pressio_compressed_array {
+  public:
+  /**
+   * creates an array whose blocks are all zero
+   *
+   * \param[in] dtype the type of the elements
+   * \param[in] dimensions the dimensions of the array, the first varying fastest
+   * \param[in] block_dimensions the dimensions of each block; blocks on the upper edges are truncated to the array
+   * \param[in] compressor the compressor used for the blocks, configured with its options; it is cloned for each concurrent access
+   * \param[in] cache_bytes the size in bytes of the decompressed blocks kept in the cache
+   */
+  pressio_compressed_array(pressio_dtype dtype, std::vector<size_t> const& dimensions,
+      std::vector<size_t> const& block_dimensions,
+      std::shared_ptr<libpressio_compressor_plugin> const& compressor, size_t cache_bytes);
+
+  ~pressio_compressed_array();
+  pressio_compressed_array(pressio_compressed_array const&)=delete;
+  pressio_compressed_array& operator=(pressio_compressed_array const&)=delete;
+
+  /**
+   * replaces the contents of the array, compressing the blocks in parallel on the shared thread pool if the compressor allows it;
+   * it should not be called concurrently with other accesses
+   *
+   * \param[in] data the new contents, with the dtype and dimensions of the array
+   * \returns 0 on success
+   */
+  int assign(pressio_data const& data);
+
+  /**
+   * copies a region of the array
+   *
+   * \param[in] start the index of the first element of the region
+   * \param[in] count the number of elements of the region in each dimension
+   * \param[out] out set to an owning buffer with the dimensions count
+   * \returns 0 on success
+   */
+  int read(std::vector<size_t> const& start, std::vector<size_t> const& count, pressio_data* out);
+
+  /**
+   * overwrites a region of the array
+   *
+   * \param[in] start the index of the first element of the region
+   * \param[in] values the new values with the dtype of the array; its dimensions are the extent of the region
+   * \returns 0 on success
+   */
+  int write(std::vector<size_t> const& start, pressio_data const& values);
+
+  /**
+   * decompresses the whole array
+   *
+   * \param[out] out set to an owning buffer with the dimensions of the array
+   * \returns 0 on success
+   */
+  int to_data(pressio_data* out);
+
+  /**
+   * reads one element
+   *
+   * \param[in] index the index of the element
+   * \param[out] value the value of the element; T must be the type of the array
+   * \returns 0 on success
+   */
+  template <class T>
+  int get(std::vector<size_t> const& index, T* value) {
+    if(pressio_dtype_from_type<T>() != array_dtype) return type_mismatch();
+    return access(index, value, false);
+  }
+
+  /**
+   * writes one element
+   *
+   * \param[in] index the index of the element
+   * \param[in] value the new value of the element; T must be the type of the array
+   * \returns 0 on success
+   */
+  template <class T>
+  int set(std::vector<size_t> const& index, T value) {
+    if(pressio_dtype_from_type<T>() != array_dtype) return type_mismatch();
+    return access(index, &value, true);
+  }
+
+  /**
+   * compresses every modified block in the cache; the blocks stay cached
+   * \returns 0 on success
+   */
+  int flush();
+
+  /**
+   * changes the size of the cache, evicting blocks if it shrinks
+   * \param[in] cache_bytes the size in bytes of the decompressed blocks kept in the cache
+   * \returns 0 on success
+   */
+  int set_cache_size(size_t cache_bytes);
+
+  /**
+   * \returns the size in bytes of the decompressed blocks kept in the cache
+   */
+  size_t cache_size() const;
+
+  /**
+   * \returns the size in bytes of the decompressed blocks currently cached
+   */
+  size_t cached_bytes() const;
+
+  /**
+   * \returns the size in bytes of the compressed blocks; modified blocks in the cache are counted as of their last write back
+   */
+  size_t compressed_size() const;
+
+  /**
+   * \returns the type of the elements
+   */
+  pressio_dtype dtype() const { return array_dtype; }
+
+  /**
+   * \returns the dimensions of the array
+   */
+  std::vector<size_t> const& dimensions() const { return dims; }
+
+  /**
+   * \returns the dimensions of the blocks
+   */
+  std::vector<size_t> const& block_dimensions() const { return block_dims; }
+
+  /**
+   * \returns the last error code
+   */
+  int error_code() const;
+
+  /**
+   * \returns the last error message
+   */
+  std::string error_msg() const;
+
+  private:
+  struct cache_entry {
+    size_t block;
+    pressio_data data;
+    /* written while holding both the lock of the block and cache_lock, so either lock suffices to read it */
+    bool dirty;
+  };
+  using lru_list = std::list<cache_entry>;
+  struct eviction;
+
+  int set_error(int code, std::string const& msg);
+  int type_mismatch();
+  int access(std::vector<size_t> const& index, void* value, bool modify);
+  int copy_region(std::vector<size_t> const& start, std::vector<size_t> const& count, pressio_data const* src, pressio_data* dst);
+  template <class Body>
+  int with_block(size_t block, bool modify, Body&& body);
+  void for_blocks(size_t nblocks, std::function<void(size_t, size_t)> const& body);
+  void evict(size_t keep, eviction& victims);
+  int write_back(eviction& victims);
+  int compress_block(size_t block, pressio_data const& data);
+  int decompress_block(size_t block, pressio_data& data);
+  std::vector<size_t> block_origin(size_t block) const;
+  std::vector<size_t> block_extent(size_t block) const;
+  std::shared_ptr<libpressio_compressor_plugin> acquire_compressor();
+  void release_compressor(std::shared_ptr<libpressio_compressor_plugin>&& compressor);
+
+  pressio_dtype array_dtype;
+  std::vector<size_t> dims;
+  std::vector<size_t> block_dims;
+  std::vector<size_t> grid;
+
+  /* the compressed blocks, each guarded by the lock of its block */
+  std::vector<pressio_data> blocks;
+  std::unique_ptr<std::mutex[]> block_locks;
+
+  /* the cache; entries are only removed while holding the lock of their block */
+  mutable std::mutex cache_lock;
+  lru_list lru;
+  std::unordered_map<size_t, lru_list::iterator> cached;
+  size_t capacity;
+  size_t used = 0;
+
+  std::mutex compressors_lock;
+  std::shared_ptr<libpressio_compressor_plugin> prototype;
+  /* true if the compressor calls are guarded by a lock shared by all arrays */
+  bool serialized;
+  std::vector<std::shared_ptr<libpressio_compressor_plugin>> idle_compressors;
+
+  mutable std::mutex error_lock;
+  int code = 0;
+  std::string msg;
+};
+
+#endif /* end of include guard: LIBPRESSIO_COMPRESSED_ARRAY_H */
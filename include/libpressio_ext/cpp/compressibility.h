@@ -0,0 +1,47 @@
+#ifndef LIBPRESSIO_COMPRESSIBILITY_H
+#define LIBPRESSIO_COMPRESSIBILITY_H
+#include <cstddef>
+
+/**
+ * \file
+ * \brief cheap estimates of how well a buffer will compress
+ */
+
+/**
+ * the number of bytes read by default when estimating compressibility
+ */
+constexpr size_t pressio_compressibility_sample_bytes = 1 << 16;
+
+/**
+ * estimates the order-0 entropy of a buffer from histograms of a sample of its bytes
+ *
+ * The sample is made of short runs spread evenly over the buffer.  Bytes are
+ * counted in a separate histogram for each position within an element, as if
+ * the buffer were byte shuffled, and the entropies of the positions are
+ * averaged.  The estimate ignores repeated sequences, so data with long
+ * repeats may compress better than it predicts; it is meant to recognize
+ * noise-like data without running a compressor.
+ *
+ * \param[in] data the buffer to examine
+ * \param[in] size_in_bytes the size of the buffer
+ * \param[in] element_size the size of each element; 1 treats the buffer as bytes
+ * \param[in] sample_bytes about how many bytes are read; 0 reads the whole buffer
+ * \returns the estimated entropy in bits per byte, from 0 to 8
+ */
+double pressio_estimate_entropy(void const* data, size_t size_in_bytes, size_t element_size,
+    size_t sample_bytes = pressio_compressibility_sample_bytes);
+
+/**
+ * estimates the compression ratio an entropy coder would reach on a buffer
+ *
+ * \param[in] data the buffer to examine
+ * \param[in] size_in_bytes the size of the buffer
+ * \param[in] element_size the size of each element; 1 treats the buffer as bytes
+ * \param[in] sample_bytes about how many bytes are read; 0 reads the whole buffer
+ * \returns 8 divided by the estimated entropy in bits per byte
+ * \see pressio_estimate_entropy
+ */
+double pressio_estimate_compression_ratio(void const* data, size_t size_in_bytes, size_t element_size,
+    size_t sample_bytes = pressio_compressibility_sample_bytes);
+
+#endif /* end of include guard: LIBPRESSIO_COMPRESSIBILITY_H */
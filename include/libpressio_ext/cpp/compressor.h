@@ -21,12 +21,12 @@ class libpressio_compressor_plugin {
   libpressio_compressor_plugin() noexcept;
   libpressio_compressor_plugin(libpressio_compressor_plugin const& plugin):
     error(plugin.error),
-    metrics_plugin(plugin.metrics_plugin->clone())
+    metrics_plugin(plugin.metrics_plugin ? plugin.metrics_plugin->clone() : nullptr)
   {}
   libpressio_compressor_plugin& operator=(libpressio_compressor_plugin const& plugin)
   {
     error = plugin.error;
-    metrics_plugin = plugin.metrics_plugin->clone();
+    metrics_plugin = plugin.metrics_plugin ? plugin.metrics_plugin->clone() : nullptr;
     return *this;
   }
   libpressio_compressor_plugin(libpressio_compressor_plugin&& plugin) noexcept:
@@ -195,6 +195,16 @@ class libpressio_compressor_plugin {
    * */
   virtual int check_options_impl(struct pressio_options const&);
 
+  /** the number of threads the compressor should use internally for the current call.
+   * Compressors with internal parallelism call it from compress_impl and decompress_impl
+   * and use the result for that call only, so their configured options are left unchanged
+   *
+   * \param[in] configured the number of threads set in the compressor's options
+   * \returns configured if the thread budget is disabled, otherwise this call's share of the pool
+   * \see pressio_thread_budget
+   */
+  unsigned int budgeted_threads(unsigned int configured) const;
+
   private:
   struct {
     int code;
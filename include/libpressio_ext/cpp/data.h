@@ -6,8 +6,12 @@
 #include <vector>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include "pressio_data.h"
+#include "libpressio_ext/cpp/allocation.h"
 #include "libpressio_ext/cpp/dtype.h"
 #include "libpressio_ext/compat/std_compat.h"
 
@@ -32,6 +36,16 @@ namespace {
   }
 }
 
+/**
+ * fills a region of a lazy pressio_data, it may be called concurrently from several threads
+ *
+ * \param[in] start the index of the first element of the region
+ * \param[in] count the number of elements of the region in each dimension
+ * \param[out] out a buffer for the region, with the first dimension of count varying fastest
+ * \returns 0 on success
+ */
+using pressio_data_generator = std::function<int(std::vector<size_t> const& start, std::vector<size_t> const& count, void* out)>;
+
 /**
  * represents a data buffer that may or may not be owned by the class
  */
@@ -79,6 +93,18 @@ struct pressio_data {
   static pressio_data owning(const pressio_dtype dtype, std::vector<size_t> const& dimensions) {
     return pressio_data::owning(dtype, dimensions.size(), dimensions.data());
   }
+
+  /**
+   * allocates a data buffer with a specific allocation policy
+   *
+   * \param[in] dtype the type the buffer will contain
+   * \param[in] dimensions the dimensions of the data
+   * \param[in] policy how the buffer is allocated
+   * \returns an owning data object with uninitialized memory
+   */
+  static pressio_data owning(const pressio_dtype dtype, std::vector<size_t> const& dimensions, pressio_allocation_policy const& policy) {
+    return pressio_data::owning(dtype, dimensions.size(), dimensions.data(), policy);
+  }
   /**  
    * takes ownership of an existing data buffer
    *
@@ -98,6 +124,25 @@ struct pressio_data {
     return pressio_data::move(dtype, data, dimensions.size(), dimensions.data(), deleter, metadata);
   }
 
+  /**
+   * creates data whose contents are produced on demand by a generator
+   *
+   * Copies and clones share the generator instead of producing the data.
+   * Regions are produced by read_region and contiguous selections; data()
+   * produces and stores the whole buffer the first time it is called.
+   *
+   * \param[in] dtype the type of the data
+   * \param[in] dimensions the dimensions of the data
+   * \param[in] generator fills the requested regions of the data
+   * \returns a lazy data object
+   */
+  static pressio_data lazy(const pressio_dtype dtype, std::vector<size_t> const& dimensions, pressio_data_generator generator) {
+    pressio_data data(dtype, nullptr, nullptr, nullptr, dimensions.size(), dimensions.data());
+    data.source = std::make_shared<lazy_source>();
+    data.source->generate = std::move(generator);
+    return data;
+  }
+
   /**  
    * allocates a new empty data buffer
    *
@@ -137,12 +182,9 @@ struct pressio_data {
    * */
   static pressio_data copy(const enum pressio_dtype dtype, const void* src, size_t const num_dimensions, size_t const dimensions[]) {
     size_t bytes = data_size_in_bytes(dtype, num_dimensions, dimensions);
-    void* data = nullptr;
-    if(bytes != 0) {
-      data = malloc(bytes);
-      memcpy(data, src, bytes); 
-    }
-    return pressio_data(dtype, data, nullptr, pressio_data_libc_free_fn, num_dimensions, dimensions);
+    auto allocation = pressio_allocate(bytes);
+    if(bytes != 0) memcpy(allocation.ptr, src, bytes);
+    return pressio_data(dtype, allocation, num_dimensions, dimensions);
   }
 
   /**  
@@ -155,10 +197,22 @@ struct pressio_data {
    * \see pressio_data_new_owning
    * */
   static pressio_data owning(const pressio_dtype dtype, size_t const num_dimensions, size_t const dimensions[]) {
+    return owning(dtype, num_dimensions, dimensions, pressio_allocation_policy::defaults());
+  }
+
+  /**  
+   * allocates a data buffer with a specific allocation policy
+   *
+   * \param[in] dtype the type the buffer will contain
+   * \param[in] num_dimensions the number of entries in dimensions
+   * \param[in] dimensions the dimensions of the data
+   * \param[in] policy how the buffer is allocated
+   * \returns an owning data object with uninitialized memory
+   * */
+  static pressio_data owning(const pressio_dtype dtype, size_t const num_dimensions, size_t const dimensions[],
+      pressio_allocation_policy const& policy) {
     size_t bytes = data_size_in_bytes(dtype, num_dimensions, dimensions);
-    void* data = nullptr;
-    if(bytes != 0) data = malloc(bytes);
-    return pressio_data(dtype, data, nullptr, pressio_data_libc_free_fn, num_dimensions, dimensions);
+    return pressio_data(dtype, pressio_allocate(bytes, policy), num_dimensions, dimensions);
   }
 
 
@@ -193,16 +247,12 @@ struct pressio_data {
    *
    */
   static pressio_data clone(pressio_data const& src){
+    if(src.is_lazy()) return pressio_data(src);
     size_t bytes = src.size_in_bytes(); 
-    unsigned char* data = nullptr;
-    if(bytes != 0) {
-      data = static_cast<unsigned char*>(malloc(bytes));
-      memcpy(data, src.data(), src.size_in_bytes());
-    }
+    auto allocation = pressio_allocate(bytes);
+    if(bytes != 0) memcpy(allocation.ptr, src.data(), bytes);
     return pressio_data(src.dtype(),
-        data,
-        nullptr,
-        pressio_data_libc_free_fn,
+        allocation,
         src.num_dimensions(),
         src.dimensions().data()
         );
@@ -226,32 +276,24 @@ struct pressio_data {
    * */
   pressio_data& operator=(pressio_data const& rhs) {
     if(this == &rhs) return *this;
+    if(deleter!=nullptr) deleter(data_ptr,metadata_ptr);
     data_dtype = rhs.data_dtype;
-    if(rhs.has_data() && rhs.size_in_bytes() > 0) {
-      data_ptr = malloc(rhs.size_in_bytes());
-      memcpy(data_ptr, rhs.data_ptr, rhs.size_in_bytes());
-    } else {
-      data_ptr = nullptr;
-    }
-    metadata_ptr = nullptr;
-    deleter = pressio_data_libc_free_fn;
+    void* rhs_ptr = rhs.buffer();
+    auto allocation = pressio_allocate((rhs_ptr != nullptr)? rhs.size_in_bytes() : 0);
+    data_ptr = allocation.ptr;
+    metadata_ptr = allocation.metadata;
+    deleter = allocation.deleter;
+    if(data_ptr != nullptr) memcpy(data_ptr, rhs_ptr, rhs.size_in_bytes());
     dims = rhs.dims;
+    source = rhs.source;
     return *this;
   }
   /**copy-constructor, clones the data
    * \param[in] rhs the data to clone
    * \see pressio_data::clone
    * */
-  pressio_data(pressio_data const& rhs): 
-    data_dtype(rhs.data_dtype),
-    data_ptr((rhs.has_data())? malloc(rhs.size_in_bytes()) : nullptr),
-    metadata_ptr(nullptr),
-    deleter(pressio_data_libc_free_fn),
-    dims(rhs.dims)
-  {
-    if(rhs.has_data() && rhs.size_in_bytes() > 0) {
-      memcpy(data_ptr, rhs.data_ptr, rhs.size_in_bytes());
-    }
+  pressio_data(pressio_data const& rhs): pressio_data() {
+    *this = rhs;
   }
   /**
    * move-constructor
@@ -264,7 +306,8 @@ struct pressio_data {
     data_ptr(compat::exchange(rhs.data_ptr, nullptr)),
     metadata_ptr(compat::exchange(rhs.metadata_ptr, nullptr)),
     deleter(compat::exchange(rhs.deleter, nullptr)),
-    dims(compat::exchange(rhs.dims, {})) {}
+    dims(compat::exchange(rhs.dims, {})),
+    source(std::move(rhs.source)) {}
   
   /**
    * move-assignment operator
@@ -280,6 +323,7 @@ struct pressio_data {
     metadata_ptr = compat::exchange(rhs.metadata_ptr, nullptr),
     deleter = compat::exchange(rhs.deleter, nullptr),
     dims = compat::exchange(rhs.dims, {});
+    source = std::move(rhs.source);
     return *this;
   }
 
@@ -290,20 +334,18 @@ struct pressio_data {
    */
   template <class T>
   pressio_data(std::initializer_list<T> il):
-    data_dtype(pressio_dtype_from_type<T>()),
-    data_ptr((il.size() == 0)? nullptr:malloc(il.size() * sizeof(T))),
-    metadata_ptr(nullptr),
-    deleter(pressio_data_libc_free_fn),
-    dims({il.size()}) 
+    pressio_data(pressio_dtype_from_type<T>(), pressio_allocate(il.size() * sizeof(T)), 1, std::vector<size_t>{il.size()}.data())
   {
     std::copy(std::begin(il), std::end(il), static_cast<T*>(data_ptr));
   }
     
 
   /**
-   * \returns a non-owning pointer to the data
+   * \returns a non-owning pointer to the data; lazy data is produced the first time it is called,
+   * and nullptr is returned if the generator fails
    */
   void* data() const {
+    if(source) return materialize();
     return data_ptr;
   }
 
@@ -311,7 +353,38 @@ struct pressio_data {
    * \returns true if the structure has has data
    */
   bool has_data() const {
-    return data_ptr != nullptr;
+    return source != nullptr || data_ptr != nullptr;
+  }
+
+  /**
+   * \returns true if the data was created by lazy and is produced by a generator
+   */
+  bool is_lazy() const {
+    return source != nullptr;
+  }
+
+  /**
+   * copies a region of the data to a buffer; for lazy data which has not been
+   * produced yet, only the region is produced
+   *
+   * \param[in] start the index of the first element of the region
+   * \param[in] count the number of elements of the region in each dimension
+   * \param[out] out a buffer for the region, with the first dimension of count varying fastest
+   * \returns 0 on success, non-zero if the region is out of bounds or the generator fails
+   */
+  int read_region(std::vector<size_t> const& start, std::vector<size_t> const& count, void* out) const;
+
+  /**
+   * buffers allocated by libpressio are aligned to pressio_simd_alignment unless pressio:alignment is lowered,
+   * but buffers provided with nonowning or move may not be
+   *
+   * \param[in] alignment the alignment in bytes to check for
+   * \returns true if the buffer is aligned to alignment bytes, false if there is no buffer such as for
+   * lazy data which has not been produced yet
+   */
+  bool is_aligned(size_t alignment = pressio_simd_alignment) const {
+    void* ptr = buffer();
+    return ptr != nullptr && pressio_is_aligned(ptr, alignment);
   }
   
   /**
@@ -350,18 +423,19 @@ struct pressio_data {
    *
    */
   size_t set_dimensions(std::vector<size_t>&& dims) {
+    detach();
     size_t new_size = data_size_in_bytes(data_dtype, dims.size(), dims.data());
     if(size_in_bytes() < new_size) {
-      void* tmp = malloc(new_size);
-      if(tmp == nullptr) {
+      auto allocation = pressio_allocate(new_size);
+      if(allocation.ptr == nullptr) {
         return 0;
       } else {
-        memcpy(tmp, data_ptr, size_in_bytes());
+        memcpy(allocation.ptr, data_ptr, size_in_bytes());
         if(deleter!=nullptr) deleter(data_ptr,metadata_ptr);
 
-        data_ptr = tmp;
-        deleter = pressio_data_libc_free_fn;
-        metadata_ptr = nullptr;
+        data_ptr = allocation.ptr;
+        deleter = allocation.deleter;
+        metadata_ptr = allocation.metadata;
       }
     } 
     this->dims = std::move(dims);
@@ -418,6 +492,7 @@ struct pressio_data {
    * \returns 0 if the resize was successful, negative values on warnings (i.e. dimensions mismatch), positive values on errors
    */
   int reshape(std::vector<size_t> const& new_dimensions) {
+    detach();
     const size_t old_size = data_size_in_elements(num_dimensions(), dims.data());
     const size_t new_size = data_size_in_elements(new_dimensions.size(), new_dimensions.data());
 
@@ -454,11 +529,49 @@ struct pressio_data {
     deleter(deleter),
     dims(dimensions, dimensions+num_dimensions)
   {}
+  /**
+   * constructor which takes ownership of an allocation
+   * \param dtype the type of the data
+   * \param allocation the buffer and its deleter
+   * \param num_dimensions the number of dimensions to represent
+   * \param dimensions of the data
+   */
+  pressio_data(const pressio_dtype dtype,
+      pressio_allocation const& allocation,
+      size_t const num_dimensions,
+      size_t const dimensions[]):
+    pressio_data(dtype, allocation.ptr, allocation.metadata, allocation.deleter, num_dimensions, dimensions)
+  {}
+
+  /** the generator of lazy data, shared by copies */
+  struct lazy_source {
+    pressio_data_generator generate;
+    /** guards producing the buffers of the data objects which share this source */
+    std::mutex lock;
+  };
+
+  /** produces the buffer of lazy data if needed */
+  void* materialize() const;
+  /** \returns the buffer if it has been produced without producing it */
+  void* buffer() const {
+    if(!source) return data_ptr;
+    std::lock_guard<std::mutex> guard(source->lock);
+    return data_ptr;
+  }
+  /** produces the buffer of lazy data and stops using the generator, used before the dimensions change */
+  void detach() {
+    if(!source) return;
+    materialize();
+    source.reset();
+  }
+
   pressio_dtype data_dtype;
-  void* data_ptr;
-  void* metadata_ptr;
-  void (*deleter)(void*, void*);
+  /* the buffer of lazy data is filled in by materialize on first use */
+  mutable void* data_ptr;
+  mutable void* metadata_ptr;
+  mutable void (*deleter)(void*, void*);
   std::vector<size_t> dims;
+  std::shared_ptr<lazy_source> source;
 };
 
 /**
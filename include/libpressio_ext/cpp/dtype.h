@@ -2,6 +2,7 @@
 #define LIBPRESSIO_DTYPE_CPP
 #include <pressio_dtype.h>
 #include <cstdint>
+#include <type_traits>
 
 /**
  * \file
@@ -173,6 +173,22 @@ struct pressio {
     };
   }
 
+  /**
+   * sets library wide options such as the configuration of the shared thread pool
+   * \param[in] options the options to set
+   * \returns 0 if successful, positive values on errors
+   *
+   * \see pressio_set_options
+   */
+  int set_options(struct pressio_options const& options);
+
+  /**
+   * \returns the library wide options
+   *
+   * \see pressio_get_options
+   */
+  struct pressio_options get_options() const;
+
   /**
    * \returns the version string for this version of libpressio
    *
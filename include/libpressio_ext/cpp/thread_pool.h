@@ -0,0 +1,212 @@
+#ifndef LIBPRESSIO_THREAD_POOL_H
+#define LIBPRESSIO_THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \file
+ * \brief a work stealing thread pool shared by the parallel features of libpressio
+ */
+
+/**
+ * a work stealing thread pool
+ *
+ * Each worker owns a queue of tasks.  Tasks submitted from a worker are pushed
+ * onto its own queue and run most recent first; idle workers steal the oldest
+ * tasks from the other queues.  The thread which calls parallel_for also runs
+ * iterations of the loop, so parallel_for may be nested and a pool with one
+ * thread runs everything on the calling thread.
+ */
+class pressio_thread_pool {
+  public:
+  /**
+   * \returns the process wide pool used by libpressio, configured by the pressio:nthreads and pressio:affinity options
+   * of a pressio instance
+   */
+  static pressio_thread_pool& global();
+
+  /**
+   * creates a thread pool
+   * \param[in] nthreads the number of threads which run tasks including the calling thread, 0 means one per hardware thread
+   * \param[in] affinity the cpus the workers are pinned to round robin, empty means the workers are not pinned
+   */
+  explicit pressio_thread_pool(unsigned int nthreads = 0, std::vector<int> affinity = {});
+
+  /**
+   * waits for submitted tasks to finish and joins the workers
+   */
+  ~pressio_thread_pool();
+
+  pressio_thread_pool(pressio_thread_pool const&)=delete;
+  pressio_thread_pool& operator=(pressio_thread_pool const&)=delete;
+
+  /**
+   * changes the number of threads and the affinity of the pool; the pool
+   * waits for submitted tasks and running loops to finish first, and new work
+   * waits until the pool has restarted.  A pool which already has this
+   * configuration is left running.
+   *
+   * \param[in] nthreads the number of threads which run tasks including the calling thread, 0 means one per hardware thread
+   * \param[in] affinity the cpus the workers are pinned to round robin, empty means the workers are not pinned
+   * \returns false without changing the pool if it would have to wait for the calling thread, i.e. when called from a task or loop body
+   */
+  bool configure(unsigned int nthreads, std::vector<int> affinity);
+
+  /**
+   * \returns the number of threads which run tasks including the calling thread
+   */
+  unsigned int nthreads() const;
+
+  /**
+   * \returns the cpus the workers are pinned to
+   */
+  std::vector<int> affinity() const;
+
+  /**
+   * runs a task asynchronously; if the pool has no workers it runs before submit returns
+   * \param[in] task the task to run
+   */
+  void submit(std::function<void()> task);
+
+  /**
+   * calls body on disjoint sub-ranges which cover [begin, end) and returns once all have completed
+   *
+   * \param[in] begin the first index of the range
+   * \param[in] end one past the last index of the range
+   * \param[in] grain the minimum number of indices in each sub-range
+   * \param[in] body a function called with the begin and end of each sub-range
+   *
+   * if body throws, the first exception is re-thrown after the other sub-ranges complete
+   */
+  void parallel_for(size_t begin, size_t end, size_t grain, std::function<void(size_t, size_t)> const& body);
+
+  private:
+  struct task_queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  /**
+   * counts work which uses the workers for its lifetime so that configure
+   * waits for it, and configure excludes new work while it restarts the pool
+   */
+  class usage {
+    public:
+    explicit usage(pressio_thread_pool& pool);
+    ~usage();
+    usage(usage const&)=delete;
+    usage& operator=(usage const&)=delete;
+
+    private:
+    pressio_thread_pool& pool;
+  };
+
+  void acquire();
+  void release();
+  void start();
+  void stop();
+  void worker_loop(size_t id);
+  bool try_pop(size_t id, std::function<void()>& task);
+
+  unsigned int requested_threads;
+  std::vector<int> cpus;
+  std::vector<std::unique_ptr<task_queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<unsigned int> thread_count{1};
+  mutable std::mutex config_mutex;
+  std::condition_variable idle;
+  std::atomic<size_t> in_flight{0};
+  std::mutex sleep_mutex;
+  std::condition_variable wake;
+  std::atomic<size_t> pending{0};
+  std::atomic<size_t> next_queue{0};
+  bool stopping = false;
+};
+
+/**
+ * divides the threads of the shared thread pool between concurrent
+ * compressions (outer concurrency) and the threads each compressor uses
+ * internally, such as zfp's OpenMP threads and blosc's internal threads
+ *
+ * every outermost call to compress or decompress is counted while it runs;
+ * when the budget is enabled, compressors are asked to use
+ * total_threads() / outer() threads of their own.
+ */
+class pressio_thread_budget {
+  public:
+  /**
+   * \returns the process wide budget, enabled by the pressio:thread_budget option of a pressio instance
+   */
+  static pressio_thread_budget& global();
+
+  /**
+   * registers an outer task for its lifetime; scopes nested on the same thread are not counted again
+   */
+  class scope {
+    public:
+    /**
+     * \param[in] budget the budget the task is counted against
+     */
+    explicit scope(pressio_thread_budget& budget);
+    ~scope();
+    scope(scope const&)=delete;
+    scope& operator=(scope const&)=delete;
+
+    private:
+    pressio_thread_budget* budget;
+  };
+
+  /**
+   * \param[in] enabled if true, compressors are told how many threads to use internally
+   */
+  void set_enabled(bool enabled);
+
+  /**
+   * \returns true if the budget is enabled
+   */
+  bool enabled() const;
+
+  /**
+   * \returns the number of threads to divide, the size of the global thread pool
+   */
+  unsigned int total_threads() const;
+
+  /**
+   * \returns the number of outer tasks currently running
+   */
+  unsigned int outer() const;
+
+  /**
+   * \returns the number of threads each outer task should use internally, at least 1
+   */
+  unsigned int inner_threads() const;
+
+  private:
+  std::atomic<bool> is_enabled{false};
+  std::atomic<unsigned int> active{0};
+};
+
+/**
+ * parses a list of cpus such as "0-3,8,10-11"
+ * \param[in] list the list of cpus
+ * \param[out] cpus the parsed cpus
+ * \returns false if the list is not valid
+ */
+bool pressio_parse_cpu_list(std::string const& list, std::vector<int>& cpus);
+
+/**
+ * formats a list of cpus as a comma separated list
+ * \param[in] cpus the list of cpus
+ * \returns the formatted list
+ */
+std::string pressio_format_cpu_list(std::vector<int> const& cpus);
+
+#endif /* end of include guard: LIBPRESSIO_THREAD_POOL_H */
@@ -12,6 +12,7 @@ extern "C" {
 struct pressio;
 struct pressio_compressor;
 struct pressio_metrics;
+struct pressio_options;
 
 /**
  * gets a reference to a new instance of libpressio; initializes the library if necessary
@@ -56,6 +57,26 @@ int pressio_error_code(struct pressio* library);
  */
 const char* pressio_error_msg(struct pressio* library);
 
+/**
+ * sets library wide options.  "pressio:nthreads" (uint32) is the number of
+ * threads in the thread pool shared by the parallel features of libpressio, 0
+ * means one per hardware thread, and "pressio:affinity" (string) is a list of
+ * cpus such as "0-3,8" that the pool's threads are pinned to.  The thread pool
+ * is shared by every library instance in the process.
+ *
+ * \param[in] library the pointer to the library
+ * \param[in] options the options to set
+ * \returns 0 if successful, positive values on errors
+ */
+int pressio_set_options(struct pressio* library, struct pressio_options const* options);
+
+/**
+ * \param[in] library the pointer to the library
+ * \returns a new pressio_options structure with the library wide options
+ * \see pressio_set_options for the supported options
+ */
+struct pressio_options* pressio_get_options(struct pressio* library);
+
 /**
  * it will not return more information than the tailored functions below
  * \returns a string with version and feature information
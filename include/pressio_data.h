@@ -177,6 +177,12 @@ enum pressio_dtype pressio_data_dtype(struct pressio_data const* data);
  * \returns an integer code corresponding to the data-type
  */
 bool pressio_data_has_data(struct pressio_data const* data);
+/**
+ * \param[in] data the pressio data to query
+ * \param[in] alignment the alignment in bytes to check for
+ * \returns true if the buffer of the data is aligned to alignment bytes, false if it has no buffer
+ */
+bool pressio_data_is_aligned(struct pressio_data const* data, size_t alignment);
 /**
  * \param[in] data the pressio data to query
  * \returns the number of dimensions contained in the object
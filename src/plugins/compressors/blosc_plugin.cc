@@ -1,15 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <memory>
 #include <sstream>
 #include <blosc.h>
+#include "libpressio_ext/cpp/compressibility.h"
 #include "libpressio_ext/cpp/data.h"
 #include "libpressio_ext/cpp/compressor.h"
 #include "libpressio_ext/cpp/options.h"
 #include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 #include "pressio_options.h"
 #include "pressio_data.h"
 #include "pressio_compressor.h"
 
+namespace {
+  /*
+   * the framed format stores independently compressed chunks so buffers
+   * larger than BLOSC_MAX_BUFFERSIZE can be compressed and decoded in parallel:
+   *
+   *   uint64 number of chunks
+   *   uint64 uncompressed bytes in each chunk, the last may be smaller
+   *   uint64 total uncompressed bytes
+   *   uint64 offsets of the chunks from the end of the index, one per chunk plus the total size
+   *   uint64 flags, one per chunk: 0 for a blosc chunk, or raw_chunk for a chunk stored uncompressed
+   *   the chunks
+   */
+  struct frame_index {
+    static constexpr uint64_t raw_chunk = 1;
+
+    uint64_t nchunks;
+    uint64_t chunk_bytes;
+    uint64_t total_bytes;
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> flags;
+
+    static size_t header_bytes(size_t nchunks) {
+      return sizeof(uint64_t) * (2 * nchunks + 4);
+    }
+
+    size_t bytes() const {
+      return header_bytes(nchunks);
+    }
+
+    size_t chunk_size(size_t chunk) const {
+      return std::min<uint64_t>(chunk_bytes, total_bytes - chunk * chunk_bytes);
+    }
+
+    /* \returns false if the buffer does not hold a valid index */
+    bool read(unsigned char const* buffer, size_t size) {
+      uint64_t header[3];
+      if(size < sizeof(header)) return false;
+      memcpy(header, buffer, sizeof(header));
+      nchunks = header[0];
+      chunk_bytes = header[1];
+      total_bytes = header[2];
+      if(chunk_bytes == 0 || nchunks != (total_bytes + chunk_bytes - 1) / chunk_bytes) return false;
+      if(nchunks > size / (2 * sizeof(uint64_t)) || size < bytes()) return false;
+      offsets.resize(nchunks + 1);
+      flags.resize(nchunks);
+      memcpy(offsets.data(), buffer + sizeof(header), sizeof(uint64_t) * offsets.size());
+      memcpy(flags.data(), buffer + sizeof(header) + sizeof(uint64_t) * offsets.size(), sizeof(uint64_t) * flags.size());
+      for (size_t i = 0; i < nchunks; ++i) {
+        if(offsets[i] > offsets[i + 1]) return false;
+        if(flags[i] == raw_chunk && offsets[i + 1] - offsets[i] != chunk_size(i)) return false;
+        if(flags[i] != 0 && flags[i] != raw_chunk) return false;
+      }
+      return offsets.back() <= size - bytes();
+    }
+  };
+
+  /* chunks of a few MiB keep each chunk's blocks in cache while leaving enough chunks to spread over the threads */
+  constexpr size_t default_chunk_bytes = 4 << 20;
+}
+
 
 class blosc_plugin: public libpressio_compressor_plugin {
   public:
@@ -20,6 +86,11 @@ class blosc_plugin: public libpressio_compressor_plugin {
       options.set("blosc:doshuffle", doshuffle);
       options.set("blosc:blocksize", blocksize);
       options.set("blosc:compressor", compressor);
+      options.set("blosc:framed", framed);
+      options.set("blosc:chunk_size", chunk_size);
+      options.set("blosc:min_estimated_ratio", min_estimated_ratio);
+      options.set("blosc:region_start", region_start);
+      options.set("blosc:region_count", region_count);
       return options;
     }
 
@@ -35,14 +106,28 @@ class blosc_plugin: public libpressio_compressor_plugin {
       options.get("blosc:doshuffle", &doshuffle);
       options.get("blosc:blocksize", &blocksize);
       options.get("blosc:compressor", &compressor);
+      options.get("blosc:framed", &framed);
+      options.get("blosc:chunk_size", &chunk_size);
+      options.get("blosc:min_estimated_ratio", &min_estimated_ratio);
+      options.get("blosc:region_start", &region_start);
+      options.get("blosc:region_count", &region_count);
 
       return 0;
     }
 
+    /*
+     * the threads blosc uses for this call, blosc:numinternalthreads unless the thread budget is enabled
+     */
+    int call_threads() const {
+      return static_cast<int>(budgeted_threads(static_cast<unsigned int>(numinternalthreads)));
+    }
+
     int compress_impl(const pressio_data *input, struct pressio_data* output) override {
+      if(framed) return compress_framed(input, output);
       int typesize = pressio_dtype_size(pressio_data_dtype(input));
       size_t nbytes = 0, destsize = 0;
       const void* src = pressio_data_ptr(input, &nbytes);
+      if(nbytes > BLOSC_MAX_BUFFERSIZE) return too_large();
       *output = pressio_data::owning(pressio_byte_dtype, {nbytes + BLOSC_MAX_OVERHEAD});
       void* dest = pressio_data_ptr(output, &destsize);
 
@@ -56,7 +141,7 @@ class blosc_plugin: public libpressio_compressor_plugin {
           destsize,
           compressor.c_str(),
           blocksize,
-          numinternalthreads
+          call_threads()
           );
       //deliberately ignoring warnings from reshape since new size guaranteed to be smaller
       size_t compressed_size = ret;
@@ -72,6 +157,7 @@ class blosc_plugin: public libpressio_compressor_plugin {
     }
 
     int decompress_impl(const pressio_data *input, struct pressio_data* output) override {
+      if(framed) return decompress_framed(input, output);
       const void* src = pressio_data_ptr(input, nullptr);
       if(pressio_data_has_data(output)) {
         std::vector<size_t> dims;
@@ -91,7 +177,7 @@ class blosc_plugin: public libpressio_compressor_plugin {
           src,
           dest,
           destsize,
-          numinternalthreads
+          call_threads()
           );
 
       if(ret >= 0) {
@@ -128,12 +214,143 @@ class blosc_plugin: public libpressio_compressor_plugin {
   private:
     int internal_error(int rc) { std::stringstream ss; ss << "interal error " << rc; return set_error(1, ss.str()); }
     int reshape_error() { return set_error(2, "failed to reshape array after compression"); }
+    int too_large() { return set_error(3, "the input is larger than BLOSC_MAX_BUFFERSIZE, set blosc:framed to compress it in chunks"); }
+    int invalid_frame() { return set_error(4, "invalid framed blosc stream"); }
+    int invalid_region() { return set_error(5, "blosc:region_start and blosc:region_count must each hold one index inside the data"); }
+
+    /*
+     * compresses the chunks in parallel on the shared thread pool, each into a
+     * slot large enough for its worst case, then closes the gaps between them;
+     * chunks whose sampled entropy predicts a ratio below blosc:min_estimated_ratio
+     * are copied without running blosc
+     */
+    int compress_framed(const pressio_data *input, struct pressio_data* output) {
+      const size_t typesize = pressio_dtype_size(pressio_data_dtype(input));
+      size_t nbytes = 0;
+      auto src = static_cast<unsigned char const*>(pressio_data_ptr(input, &nbytes));
+      size_t chunk_bytes = std::min<size_t>((chunk_size == 0) ? default_chunk_bytes : chunk_size,
+          BLOSC_MAX_BUFFERSIZE - BLOSC_MAX_OVERHEAD);
+      chunk_bytes = std::max(typesize, chunk_bytes - chunk_bytes % typesize);
+      const size_t nchunks = (nbytes + chunk_bytes - 1) / chunk_bytes;
+      const size_t slot_bytes = chunk_bytes + BLOSC_MAX_OVERHEAD;
+      const size_t index_bytes = frame_index::header_bytes(nchunks);
+
+      *output = pressio_data::owning(pressio_byte_dtype, {index_bytes + nchunks * slot_bytes});
+      auto dest = static_cast<unsigned char*>(output->data());
+      std::vector<uint64_t> sizes(nchunks);
+      std::vector<uint64_t> flags(nchunks, 0);
+      std::atomic<int> error{0};
+      const int nthreads = call_threads();
+      pressio_thread_pool::global().parallel_for(0, nchunks, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          const size_t begin = chunk * chunk_bytes;
+          const size_t size = std::min(chunk_bytes, nbytes - begin);
+          //without shuffling every byte shares one histogram
+          const size_t element_size = (doshuffle == BLOSC_NOSHUFFLE) ? 1 : typesize;
+          if(min_estimated_ratio > 0 &&
+              pressio_estimate_compression_ratio(src + begin, size, element_size) < min_estimated_ratio) {
+            memcpy(dest + index_bytes + chunk * slot_bytes, src + begin, size);
+            sizes[chunk] = size;
+            flags[chunk] = frame_index::raw_chunk;
+            continue;
+          }
+          const int ret = blosc_compress_ctx(clevel, doshuffle, typesize,
+              size, src + begin,
+              dest + index_bytes + chunk * slot_bytes, slot_bytes,
+              compressor.c_str(), blocksize, nthreads);
+          if(ret <= 0) error = (ret == 0) ? -1 : ret;
+          else sizes[chunk] = static_cast<uint64_t>(ret);
+        }
+      });
+      if(error) return internal_error(error);
+
+      std::vector<uint64_t> index{nchunks, chunk_bytes, nbytes, 0};
+      for (size_t chunk = 0; chunk < nchunks; ++chunk) {
+        const uint64_t offset = index.back();
+        //slots are moved toward the front in order, so a chunk never overwrites one not yet moved
+        memmove(dest + index_bytes + offset, dest + index_bytes + chunk * slot_bytes, sizes[chunk]);
+        index.push_back(offset + sizes[chunk]);
+      }
+      index.insert(index.end(), flags.begin(), flags.end());
+      memcpy(dest, index.data(), index_bytes);
+      size_t compressed_size = index_bytes + index[3 + nchunks];
+      if(output->reshape({compressed_size}) > 0) return reshape_error();
+      return 0;
+    }
+
+    /*
+     * decompresses the chunks in parallel; when a region is requested only
+     * the chunks which overlap it are decoded
+     */
+    int decompress_framed(const pressio_data *input, struct pressio_data* output) {
+      size_t input_bytes = 0;
+      auto src = static_cast<unsigned char const*>(pressio_data_ptr(input, &input_bytes));
+      frame_index index;
+      if(!index.read(src, input_bytes)) return invalid_frame();
+      src += index.bytes();
+
+      const pressio_dtype dtype = pressio_data_dtype(output);
+      const size_t typesize = pressio_dtype_size(dtype);
+      uint64_t first_byte = 0, region_bytes = index.total_bytes;
+      if(region_start.has_data() || region_count.has_data()) {
+        auto start_values = region_start.cast(pressio_uint64_dtype);
+        auto count_values = region_count.cast(pressio_uint64_dtype);
+        if(start_values.num_elements() != 1 || count_values.num_elements() != 1) return invalid_region();
+        const uint64_t start = *static_cast<uint64_t*>(start_values.data());
+        const uint64_t count = *static_cast<uint64_t*>(count_values.data());
+        const uint64_t elements = index.total_bytes / typesize;
+        if(start > elements || count > elements - start) return invalid_region();
+        first_byte = start * typesize;
+        region_bytes = count * typesize;
+        *output = pressio_data::owning(dtype, {count});
+      } else {
+        if(output->size_in_bytes() != index.total_bytes) return invalid_frame();
+        if(!output->has_data()) *output = pressio_data::owning(dtype, output->dimensions());
+      }
+      if(region_bytes == 0) return 0;
+
+      auto dest = static_cast<unsigned char*>(output->data());
+      const size_t first_chunk = first_byte / index.chunk_bytes;
+      const size_t last_chunk = (first_byte + region_bytes - 1) / index.chunk_bytes;
+      std::atomic<int> error{0};
+      const int nthreads = call_threads();
+      pressio_thread_pool::global().parallel_for(first_chunk, last_chunk + 1, 1, [&](size_t first, size_t last) {
+        std::vector<unsigned char> partial;
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          const uint64_t chunk_begin = chunk * index.chunk_bytes;
+          const size_t chunk_size = index.chunk_size(chunk);
+          const uint64_t begin = std::max(chunk_begin, first_byte);
+          const uint64_t end = std::min(chunk_begin + chunk_size, first_byte + region_bytes);
+          unsigned char const* compressed = src + index.offsets[chunk];
+          int ret;
+          if(index.flags[chunk] == frame_index::raw_chunk) {
+            memcpy(dest + (begin - first_byte), compressed + (begin - chunk_begin), end - begin);
+            continue;
+          } else if(begin == chunk_begin && end == chunk_begin + chunk_size) {
+            ret = blosc_decompress_ctx(compressed, dest + (begin - first_byte), chunk_size, nthreads);
+          } else {
+            partial.resize(chunk_size);
+            ret = blosc_decompress_ctx(compressed, partial.data(), chunk_size, nthreads);
+            if(ret >= 0) memcpy(dest + (begin - first_byte), partial.data() + (begin - chunk_begin), end - begin);
+          }
+          if(ret < 0) error = ret;
+          else if(static_cast<size_t>(ret) != chunk_size) error = -1;
+        }
+      });
+      if(error) return internal_error(error);
+      return 0;
+    }
 
     int clevel;
     int numinternalthreads = 1;
     int doshuffle = BLOSC_NOSHUFFLE;
     unsigned int blocksize = 0;
     std::string compressor{BLOSC_BLOSCLZ_COMPNAME};
+    int framed = 0;
+    unsigned int chunk_size = 0;
+    double min_estimated_ratio = 0;
+    pressio_data region_start = pressio_data::empty(pressio_uint64_dtype, {});
+    pressio_data region_count = pressio_data::empty(pressio_uint64_dtype, {});
     
 };
 
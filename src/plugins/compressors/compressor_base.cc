@@ -6,6 +6,7 @@
 #include "libpressio_ext/cpp/compressor.h"
 #include "libpressio_ext/cpp/metrics.h"
 #include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 
 #include "pressio_options_iter.h"
 #include "pressio_options.h"
@@ -93,6 +94,7 @@ int libpressio_compressor_plugin::set_options(struct pressio_options const& opti
 }
 
 int libpressio_compressor_plugin::compress(const pressio_data *input, struct pressio_data* output) {
+  pressio_thread_budget::scope outer(pressio_thread_budget::global());
   if(metrics_plugin) metrics_plugin->begin_compress(input, output);
   auto ret = compress_impl(input, output);
   if(metrics_plugin) metrics_plugin->end_compress(input, output, ret);
@@ -100,6 +102,7 @@ int libpressio_compressor_plugin::compress(const pressio_data *input, struct pre
 }
 
 int libpressio_compressor_plugin::decompress(const pressio_data *input, struct pressio_data* output) {
+  pressio_thread_budget::scope outer(pressio_thread_budget::global());
   if(metrics_plugin) metrics_plugin->begin_decompress(input, output);
   auto ret = decompress_impl(input, output);
   if(metrics_plugin) metrics_plugin->end_decompress(input, output, ret);
@@ -108,6 +111,11 @@ int libpressio_compressor_plugin::decompress(const pressio_data *input, struct p
 
 int libpressio_compressor_plugin::check_options_impl(struct pressio_options const &) { return 0;}
 
+unsigned int libpressio_compressor_plugin::budgeted_threads(unsigned int configured) const {
+  auto const& budget = pressio_thread_budget::global();
+  return budget.enabled() ? budget.inner_threads() : configured;
+}
+
 
 struct pressio_options libpressio_compressor_plugin::get_metrics_results() const {
   return metrics_plugin->get_metrics_results();
@@ -1,7 +1,12 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <vector>
 #include <fpzip.h>
 #include "pressio_data.h"
 #include "pressio_compressor.h"
@@ -10,13 +15,58 @@
 #include "libpressio_ext/cpp/options.h"
 #include "libpressio_ext/cpp/printers.h"
 #include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 
 namespace {
   constexpr int INVALID_TYPE = 8;
+  constexpr int INVALID_STREAM = 9;
     auto check_dim = [](size_t dim) {
       if(dim == 0) return 1ul;
       else return dim;
     };
+
+  using fpzip_dims = std::array<size_t, 4>;
+
+  /*
+   * parallel mode splits the data into slabs of the slowest dimension whose
+   * extent is larger than one, so each slab is contiguous.  The container is
+   *
+   *   uint64 number of slabs
+   *   uint64 the dimension the data is split along
+   *   uint64 the thickness of each slab, the last may be thinner
+   *   uint64 offsets of the streams from the end of the table, one per slab plus the total size
+   *   the fpzip streams
+   */
+  struct slab_layout {
+    slab_layout(fpzip_dims const& dims, size_t thickness): dims(dims), axis(0), thickness(thickness) {
+      for (size_t d = 0; d < dims.size(); ++d) {
+        if(dims[d] > 1) axis = d;
+      }
+      nslabs = (dims[axis] + thickness - 1) / thickness;
+    }
+
+    fpzip_dims slab_dims(size_t slab) const {
+      fpzip_dims slab_dims = dims;
+      slab_dims[axis] = std::min(thickness, dims[axis] - slab * thickness);
+      return slab_dims;
+    }
+
+    /** \returns the index of the first element of the slab */
+    size_t slab_begin(size_t slab) const {
+      size_t stride = 1;
+      for (size_t d = 0; d < axis; ++d) stride *= dims[d];
+      return slab * thickness * stride;
+    }
+
+    size_t table_bytes() const {
+      return sizeof(uint64_t) * (nslabs + 4);
+    }
+
+    fpzip_dims dims;
+    size_t axis;
+    size_t thickness;
+    size_t nslabs;
+  };
 }
 
 class fpzip_plugin: public libpressio_compressor_plugin {
@@ -25,6 +75,8 @@ class fpzip_plugin: public libpressio_compressor_plugin {
     struct pressio_options options = pressio_options();
     options.set("fpzip:has_header", has_header);
     options.set("fpzip:prec", prec);
+    options.set("fpzip:parallel", parallel);
+    options.set("fpzip:slab_size", slab_size);
     return options;
   };
 
@@ -39,11 +91,13 @@ class fpzip_plugin: public libpressio_compressor_plugin {
 
   int 	set_options_impl (struct pressio_options const& options) override {
     int tmp;
-    if( options.get("fpzip:has_header", &tmp) != pressio_options_key_set) {
+    if( options.get("fpzip:has_header", &tmp) == pressio_options_key_set) {
       has_header = tmp != 0;
     }
 
     options.get("fpzip:prec", &prec);
+    options.get("fpzip:parallel", &parallel);
+    options.get("fpzip:slab_size", &slab_size);
     return 0;
   }
 
@@ -52,6 +106,7 @@ class fpzip_plugin: public libpressio_compressor_plugin {
     if(type == INVALID_TYPE) {
       return INVALID_TYPE;
     }
+    if(parallel) return compress_parallel(input, output, type);
 
     if(!pressio_data_has_data(output))
     {
@@ -94,6 +149,7 @@ class fpzip_plugin: public libpressio_compressor_plugin {
     if(type == INVALID_TYPE) {
       return INVALID_TYPE;
     }
+    if(parallel) return decompress_parallel(input, output, type);
 
     FPZ* fpz = fpzip_read_from_buffer(
         pressio_data_ptr(input, nullptr)
@@ -114,6 +170,133 @@ class fpzip_plugin: public libpressio_compressor_plugin {
      return 0;
    }
 
+   static fpzip_dims data_dims(pressio_data const* data) {
+     return {
+       check_dim(data->get_dimension(0)),
+       check_dim(data->get_dimension(1)),
+       check_dim(data->get_dimension(2)),
+       check_dim(data->get_dimension(3)),
+     };
+   }
+
+   /* writes one fpzip stream to buffer and returns its size, or 0 on failure */
+   size_t write_stream(void const* data, fpzip_dims const& dims, int type, void* buffer, size_t capacity) const {
+     FPZ* fpz = fpzip_write_to_buffer(buffer, capacity);
+     fpz->nx = static_cast<int>(dims[0]);
+     fpz->ny = static_cast<int>(dims[1]);
+     fpz->nz = static_cast<int>(dims[2]);
+     fpz->nf = static_cast<int>(dims[3]);
+     fpz->type = type;
+     fpz->prec = prec;
+     size_t outsize = 0;
+     if(!has_header || fpzip_write_header(fpz)) {
+       outsize = fpzip_write(fpz, data);
+     }
+     fpzip_write_close(fpz);
+     return outsize;
+   }
+
+   /* reads one fpzip stream from buffer, returns false on failure */
+   bool read_stream(void const* buffer, fpzip_dims const& dims, int type, void* data) const {
+     FPZ* fpz = fpzip_read_from_buffer(buffer);
+     bool ok = true;
+     if(has_header) {
+       ok = fpzip_read_header(fpz) != 0;
+     } else {
+       fpz->nx = static_cast<int>(dims[0]);
+       fpz->ny = static_cast<int>(dims[1]);
+       fpz->nz = static_cast<int>(dims[2]);
+       fpz->nf = static_cast<int>(dims[3]);
+       fpz->type = type;
+       fpz->prec = prec;
+     }
+     if(ok) ok = fpzip_read(fpz, data) != 0;
+     fpzip_read_close(fpz);
+     return ok;
+   }
+
+   /*
+    * compresses each slab as an independent stream on the shared thread pool;
+    * by default fields are compressed separately and data with a single field
+    * is split into one slab per thread
+    */
+   int compress_parallel(const pressio_data *input, struct pressio_data *output, int type) {
+     const fpzip_dims dims = data_dims(input);
+     size_t thickness = slab_size;
+     if(thickness == 0) {
+       const size_t nthreads = pressio_thread_pool::global().nthreads();
+       const size_t extent = dims[slab_layout(dims, 1).axis];
+       thickness = (dims[3] > 1) ? 1 : (extent + nthreads - 1) / nthreads;
+     }
+     const slab_layout layout(dims, thickness);
+     const size_t element_size = pressio_dtype_size(input->dtype());
+     auto in = static_cast<unsigned char const*>(input->data());
+
+     std::vector<pressio_data> streams(layout.nslabs);
+     std::atomic<bool> failed{false};
+     pressio_thread_pool::global().parallel_for(0, layout.nslabs, 1, [&](size_t first, size_t last) {
+       for (size_t slab = first; slab < last; ++slab) {
+         const fpzip_dims slab_dims = layout.slab_dims(slab);
+         const size_t slab_bytes = slab_dims[0] * slab_dims[1] * slab_dims[2] * slab_dims[3] * element_size;
+         auto stream = pressio_data::owning(pressio_byte_dtype, {slab_bytes + 1024});
+         size_t outsize = write_stream(in + layout.slab_begin(slab) * element_size, slab_dims, type, stream.data(), stream.size_in_bytes());
+         if(outsize == 0) failed = true;
+         stream.reshape({outsize});
+         streams[slab] = std::move(stream);
+       }
+     });
+     if(failed) return fpzip_error();
+
+     std::vector<uint64_t> table{layout.nslabs, layout.axis, layout.thickness, 0};
+     for (auto const& stream : streams) table.push_back(table.back() + stream.size_in_bytes());
+     *output = pressio_data::owning(pressio_byte_dtype, {layout.table_bytes() + table.back()});
+     auto out = static_cast<unsigned char*>(output->data());
+     memcpy(out, table.data(), layout.table_bytes());
+     pressio_thread_pool::global().parallel_for(0, layout.nslabs, 1, [&](size_t first, size_t last) {
+       for (size_t slab = first; slab < last; ++slab) {
+         memcpy(out + layout.table_bytes() + table[3 + slab], streams[slab].data(), streams[slab].size_in_bytes());
+       }
+     });
+     return 0;
+   }
+
+   int decompress_parallel(const pressio_data *input, struct pressio_data *output, int type) {
+     const size_t input_bytes = input->size_in_bytes();
+     auto in = static_cast<unsigned char const*>(input->data());
+     uint64_t header[3];
+     if(input_bytes < sizeof(header)) return invalid_stream();
+     memcpy(header, in, sizeof(header));
+
+     const fpzip_dims dims = data_dims(output);
+     if(header[2] == 0) return invalid_stream();
+     const slab_layout layout(dims, header[2]);
+     if(header[0] != layout.nslabs || header[1] != layout.axis || input_bytes < layout.table_bytes()) {
+       return invalid_stream();
+     }
+     std::vector<uint64_t> table(layout.nslabs + 4);
+     memcpy(table.data(), in, layout.table_bytes());
+     if(table.back() > input_bytes - layout.table_bytes()) return invalid_stream();
+
+     if(!output->has_data()) *output = pressio_data::owning(output->dtype(), output->dimensions());
+     const size_t element_size = pressio_dtype_size(output->dtype());
+     auto out = static_cast<unsigned char*>(output->data());
+     std::atomic<bool> failed{false};
+     pressio_thread_pool::global().parallel_for(0, layout.nslabs, 1, [&](size_t first, size_t last) {
+       for (size_t slab = first; slab < last; ++slab) {
+         if(!read_stream(in + layout.table_bytes() + table[3 + slab], layout.slab_dims(slab), type,
+               out + layout.slab_begin(slab) * element_size)) {
+           failed = true;
+         }
+       }
+     });
+     if(failed) return fpzip_error();
+     return 0;
+   }
+
+   int invalid_stream() {
+     return set_error(INVALID_STREAM, "invalid parallel fpzip stream");
+   }
+
    int pressio_type_to_fpzip_type(const pressio_data* data) {
      auto dtype = data->dtype();
      if(dtype == pressio_float_dtype) return 0;
@@ -165,6 +348,8 @@ class fpzip_plugin: public libpressio_compressor_plugin {
   std::string version_str;
   int has_header = 0;
   int prec = 0;
+  int parallel = 0;
+  unsigned int slab_size = 0;
 
 };
 
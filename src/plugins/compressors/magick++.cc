@@ -1,7 +1,10 @@
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <cassert>
 #include <mutex>
+#include <vector>
 
 #include <Magick++.h>
 
@@ -9,6 +12,7 @@
 #include "libpressio_ext/cpp/compressor.h"
 #include "libpressio_ext/cpp/options.h"
 #include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 #include "pressio_data.h"
 #include "pressio_compressor.h"
 #include "pressio_options.h"
@@ -62,6 +66,7 @@ class magick_plugin: public libpressio_compressor_plugin {
     options.set("magick:samples_magick", samples_magick);
     options.set("magick:compressed_magick", compressed_magick);
     options.set("magick:quality", quality);
+    options.set("magick:parallel", parallel);
     return options;
   }
 
@@ -69,6 +74,7 @@ class magick_plugin: public libpressio_compressor_plugin {
     options.get("magick:samples_magick", &samples_magick);
     options.get("magick:compressed_magick", &compressed_magick);
     options.get("magick:quality", &quality);
+    options.get("magick:parallel", &parallel);
     return 0;
   }
 
@@ -76,10 +82,6 @@ class magick_plugin: public libpressio_compressor_plugin {
    * convert from pressio_data to image, store image in blob-format
    */
   int compress_impl(const pressio_data *input, struct pressio_data* output) override {
-    auto apply_compression = [this](Magick::Image& image) {
-      image.magick(this->compressed_magick);
-      image.quality(this->quality);
-    };
     if(input->num_dimensions() == 2) {
       //convert a single image
       //convert data to samples
@@ -98,25 +100,28 @@ class magick_plugin: public libpressio_compressor_plugin {
       return 0;
     } else if (input->num_dimensions() == 3) {
       //convert a set of images
+      auto storage_type = data_type_to_storage_type(*input);
+      if(storage_type == Magick::UndefinedPixel) return invalid_type(input->dtype());
+      if(parallel) return compress_slices(*input, storage_type, output);
       
       if(not Magick::CoderInfo(compressed_magick).isMultiFrame()) return invalid_codec(compressed_magick);
 
       std::vector<Magick::Image> images(input->get_dimension(0));
       size_t image_size_in_bytes = input->get_dimension(1) * input->get_dimension(2) * pressio_dtype_size(input->dtype());
       uint8_t const* pos = reinterpret_cast<uint8_t const*>(input->data());
-      auto storage_type = data_type_to_storage_type(*input);
-      if(storage_type == Magick::UndefinedPixel) return invalid_type(input->dtype());
-      for (auto& image : images) {
-        image.read(
-            input->get_dimension(1),
-            input->get_dimension(2),
-            samples_magick,
-            storage_type,
-            pos
-            ); 
-        apply_compression(image);
-        pos += image_size_in_bytes;
-      }
+      //importing the samples does not depend on the other frames
+      pressio_thread_pool::global().parallel_for(0, images.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          images[i].read(
+              input->get_dimension(1),
+              input->get_dimension(2),
+              samples_magick,
+              storage_type,
+              pos + i * image_size_in_bytes
+              ); 
+          apply_compression(images[i]);
+        }
+      });
 
       Magick::Blob output_blob;
       writeImages(images.begin(), images.end(), &output_blob);
@@ -157,6 +162,7 @@ class magick_plugin: public libpressio_compressor_plugin {
       return 0;
     } else if (output->num_dimensions() == 3) {
       //we are inputting a set of images
+      if(parallel) return decompress_slices(*input, output);
       std::vector<Magick::Image> images;
       Magick::Blob input_blob(input->data(), input->size_in_bytes());
       Magick::readImages(&images, input_blob);
@@ -173,16 +179,17 @@ class magick_plugin: public libpressio_compressor_plugin {
 
       size_t image_size_in_bytes = images[0].rows() * images[0].columns() * pressio_dtype_size(output->dtype());
       uint8_t* pos = reinterpret_cast<uint8_t*>(output->data());
-      for (auto& image : images) {
-        image.write(0,0,
-            image.rows(),
-            image.columns(),
-            samples_magick,
-            storage_type,
-            pos
-            );
-        pos += image_size_in_bytes;
-      }
+      pressio_thread_pool::global().parallel_for(0, images.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+          images[i].write(0,0,
+              images[i].rows(),
+              images[i].columns(),
+              samples_magick,
+              storage_type,
+              pos + i * image_size_in_bytes
+              );
+        }
+      });
 
       return 0;
     } else {
@@ -239,6 +246,93 @@ class magick_plugin: public libpressio_compressor_plugin {
     return set_error(4, ss.str());
   }
 
+  int invalid_stream() {
+    return set_error(5, "invalid magick:parallel stream");
+  }
+
+  /*
+   * sets the codec and quality an image is encoded with
+   */
+  void apply_compression(Magick::Image& image) const {
+    image.magick(compressed_magick);
+    image.quality(quality);
+  }
+
+  /*
+   * with magick:parallel, each slice is encoded as its own image so the slices
+   * can be encoded and decoded concurrently:
+   *
+   *   uint64 number of slices
+   *   uint64 offsets of the images from the end of the index, one per slice plus the total size
+   *   the encoded images
+   */
+  int compress_slices(pressio_data const& input, Magick::StorageType storage_type, pressio_data* output) {
+    const size_t slices = input.get_dimension(0);
+    const size_t image_size_in_bytes = input.get_dimension(1) * input.get_dimension(2) * pressio_dtype_size(input.dtype());
+    uint8_t const* pos = reinterpret_cast<uint8_t const*>(input.data());
+    std::vector<Magick::Blob> blobs(slices);
+    pressio_thread_pool::global().parallel_for(0, slices, 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        Magick::Image image(
+            input.get_dimension(1),
+            input.get_dimension(2),
+            samples_magick,
+            storage_type,
+            pos + i * image_size_in_bytes
+            );
+        apply_compression(image);
+        image.write(&blobs[i]);
+      }
+    });
+
+    std::vector<uint64_t> index{slices, 0};
+    for (auto const& blob : blobs) {
+      index.push_back(index.back() + blob.length());
+    }
+    const size_t index_bytes = index.size() * sizeof(uint64_t);
+    *output = pressio_data::owning(pressio_byte_dtype, {index_bytes + index.back()});
+    uint8_t* dest = reinterpret_cast<uint8_t*>(output->data());
+    memcpy(dest, index.data(), index_bytes);
+    for (size_t i = 0; i < slices; ++i) {
+      memcpy(dest + index_bytes + index[i + 1], blobs[i].data(), blobs[i].length());
+    }
+    return 0;
+  }
+
+  int decompress_slices(pressio_data const& input, pressio_data* output) {
+    auto storage_type = data_type_to_storage_type(*output);
+    if(storage_type == Magick::UndefinedPixel) return invalid_type(output->dtype());
+
+    uint8_t const* src = reinterpret_cast<uint8_t const*>(input.data());
+    uint64_t slices = 0;
+    if(input.size_in_bytes() < sizeof(slices)) return invalid_stream();
+    memcpy(&slices, src, sizeof(slices));
+    if(slices != output->get_dimension(0) || slices + 2 > input.size_in_bytes() / sizeof(uint64_t)) return invalid_stream();
+    std::vector<uint64_t> offsets(slices + 1);
+    const size_t index_bytes = (slices + 2) * sizeof(uint64_t);
+    memcpy(offsets.data(), src + sizeof(slices), offsets.size() * sizeof(uint64_t));
+    for (size_t i = 0; i < slices; ++i) {
+      if(offsets[i] > offsets[i + 1]) return invalid_stream();
+    }
+    if(offsets.back() > input.size_in_bytes() - index_bytes) return invalid_stream();
+    src += index_bytes;
+
+    if(!output->has_data()) {
+      *output = pressio_data::owning(output->dtype(), output->dimensions());
+    }
+    const size_t width = output->get_dimension(1), height = output->get_dimension(2);
+    const size_t image_size_in_bytes = width * height * pressio_dtype_size(output->dtype());
+    uint8_t* pos = reinterpret_cast<uint8_t*>(output->data());
+    pressio_thread_pool::global().parallel_for(0, slices, 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        Magick::Blob blob(src + offsets[i], offsets[i + 1] - offsets[i]);
+        Magick::Image image(blob, Magick::Geometry(width, height), compressed_magick);
+        image.write(0, 0, width, height, samples_magick, storage_type, pos + i * image_size_in_bytes);
+      }
+    });
+    return 0;
+  }
+
   /**
    * converts from an arbitrary image to samples and then to a pressio_data structure by converting
    * it to an image of samples
@@ -287,6 +381,7 @@ class magick_plugin: public libpressio_compressor_plugin {
   };
 
   unsigned int quality = 100;
+  int parallel = 0;
   std::string samples_magick = "G";
   std::string compressed_magick = "JPEG";
   std::shared_ptr<magick_init> init;
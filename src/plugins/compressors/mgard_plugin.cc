@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <mutex>
 #include <sstream>
 
 //some older version of mgard need a float header in addition to the api header
@@ -17,6 +23,7 @@
 #include "libpressio_ext/cpp/options.h"
 #include "libpressio_ext/cpp/printers.h"
 #include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 
 namespace {
 enum class mgard_compression_function
@@ -42,6 +49,71 @@ get_converted(pressio_option const& arg)
   assert(arg.has_value());
   return arg.as(pressio_type_to_enum<Type>(), pressio_conversion_explicit).template get_value<Type>();
   }
+
+/*
+ * MGARD is not known to be reentrant, and the plugin reports
+ * pressio_thread_safety_single, so the subdomains of mgard:decompose take
+ * turns calling it
+ */
+std::mutex mgard_lock;
+
+/* MGARD needs at least three points along every dimension */
+constexpr size_t min_subdomain_extent = 3;
+
+/**
+ * the subdomains used by mgard:decompose
+ *
+ * The first three dimensions form the domain passed to MGARD, and each
+ * combination of the remaining indices is a separate domain.  Each domain is
+ * split into slabs along its third (slowest) dimension, the last slab taking
+ * the remainder so no slab is thinner than the others.  Slabs are at least
+ * min_subdomain_extent thick unless the domain itself is thinner.  Every
+ * subdomain is contiguous in memory.
+ */
+struct subdomain_layout {
+  subdomain_layout(std::vector<size_t> const& dims, size_t thickness):
+    inner(dims.begin(), dims.begin() + std::min<size_t>(dims.size(), 3)),
+    thickness(std::min(std::max(thickness, min_subdomain_extent), std::max<size_t>(1, inner.back())))
+  {
+    domains = 1;
+    for (size_t i = inner.size(); i < dims.size(); ++i) domains *= dims[i];
+    plane = 1;
+    for (size_t i = 0; i + 1 < inner.size(); ++i) plane *= inner[i];
+    slabs = std::max<size_t>(1, inner.back() / this->thickness);
+  }
+
+  size_t size() const { return domains * slabs; }
+
+  /** \returns the index of the first element of the subdomain */
+  size_t offset(size_t subdomain) const {
+    return (subdomain / slabs) * plane * inner.back() + (subdomain % slabs) * thickness * plane;
+  }
+
+  std::vector<size_t> dimensions(size_t subdomain) const {
+    auto dims = inner;
+    const size_t slab = subdomain % slabs;
+    dims.back() = (slab + 1 == slabs) ? inner.back() - slab * thickness : thickness;
+    return dims;
+  }
+
+  std::vector<size_t> inner;
+  size_t thickness;
+  size_t domains;
+  size_t plane;
+  size_t slabs;
+};
+
+/*
+ * mgard:decompose streams hold independently compressed subdomains:
+ *
+ *   uint64 number of subdomains
+ *   uint64 thickness of the slabs
+ *   uint64 offsets of the subdomains from the end of the index, one per subdomain plus the total size
+ *   the MGARD streams
+ */
+size_t index_bytes(size_t subdomains) {
+  return (subdomains + 3) * sizeof(uint64_t);
+}
 }
 
 class mgard_plugin: public libpressio_compressor_plugin {
@@ -67,6 +139,8 @@ class mgard_plugin: public libpressio_compressor_plugin {
     set_if_set("mgard:norm_of_qoi", pressio_option_double_type, qoi_double);
     set_if_set("mgard:qoi_double", pressio_option_userptr_type, qoi_double);
     set_if_set("mgard:qoi_float", pressio_option_userptr_type, qoi_float);
+    options.set("mgard:decompose", decompose);
+    options.set("mgard:subdomain_size", subdomain_size);
     return options;
   };
 
@@ -81,6 +155,11 @@ class mgard_plugin: public libpressio_compressor_plugin {
     set_fn("mgard:norm_of_qoi", qoi_double);
     set_fn("mgard:qoi_double", qoi_double);
     set_fn("mgard:qoi_float", qoi_float);
+    options.get("mgard:decompose", &decompose);
+    unsigned int requested_size = subdomain_size;
+    options.get("mgard:subdomain_size", &requested_size);
+    if(requested_size != 0 && requested_size < min_subdomain_extent) return invalid_subdomain_size(requested_size);
+    subdomain_size = requested_size;
     return 0;
   }
 
@@ -91,6 +170,7 @@ class mgard_plugin: public libpressio_compressor_plugin {
         return rc;
       } 
     }
+    if(decompose) return compress_subdomains(*input, output);
     //mgard destroys the input so we must copy it here to prevent the real input from being destroyed
     auto type = pressio_data_dtype(input); 
     auto input_copy = pressio_data::clone(*input);
@@ -115,6 +195,7 @@ class mgard_plugin: public libpressio_compressor_plugin {
         return rc;
       } 
      }
+    if(decompose) return decompress_subdomains(*input, output);
     auto input_copy = pressio_data::clone(*input);
     auto type = pressio_data_dtype(output); 
     switch(type) {
@@ -163,6 +244,118 @@ class mgard_plugin: public libpressio_compressor_plugin {
 
   private:
 
+  /**
+   * compresses the subdomains of the input on the thread pool, each with its
+   * own copy of the plugin, and stores them with an index; the subdomains are
+   * copied concurrently but call MGARD one at a time
+   */
+  int compress_subdomains(pressio_data const& input, pressio_data* output) {
+    const auto function = select_compression_function(input.dtype());
+    if(function == mgard_compression_function::tol_qoi_s || function == mgard_compression_function::tol_normqoi_s) {
+      return unsupported_decomposition();
+    }
+    const auto& dims = input.dimensions();
+    size_t thickness = subdomain_size;
+    if(thickness == 0) {
+      //one subdomain per thread of the pool
+      subdomain_layout whole(dims, dims.at(std::min<size_t>(dims.size(), 3) - 1));
+      const size_t per_domain = (pressio_thread_pool::global().nthreads() + whole.domains - 1) / whole.domains;
+      thickness = whole.inner.back() / std::max<size_t>(1, per_domain);
+    }
+    subdomain_layout layout(dims, thickness);
+
+    /*
+     * with an L-infinity tolerance each subdomain may use the whole tolerance;
+     * for the norms selected by mgard:s the squared errors of the subdomains add,
+     * so each subdomain gets the share of the tolerance proportional to the square
+     * root of its share of the values
+     */
+    const double global_tolerance = get_converted<double>(tolerance);
+    const bool additive_norm = s.has_value() && !std::isinf(get_converted<double>(s));
+    const size_t type_size = pressio_dtype_size(input.dtype());
+    std::vector<pressio_data> streams(layout.size());
+    std::atomic<int> error{0};
+    pressio_thread_pool::global().parallel_for(0, layout.size(), 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        auto sub_dims = layout.dimensions(i);
+        auto subdomain = pressio_data::copy(input.dtype(),
+            static_cast<unsigned char const*>(input.data()) + layout.offset(i) * type_size, sub_dims);
+        mgard_plugin plugin(*this);
+        if(additive_norm) {
+          plugin.tolerance = global_tolerance * std::sqrt(static_cast<double>(subdomain.num_elements()) / input.num_elements());
+        }
+        if(input.dtype() == pressio_double_dtype) {
+          streams[i] = plugin.compress_typed<double>(std::move(subdomain));
+        } else {
+          streams[i] = plugin.compress_typed<float>(std::move(subdomain));
+        }
+        if(streams[i].size_in_bytes() == 0) error = 1;
+      }
+    });
+    if(error) return subdomain_failed("compress");
+
+    std::vector<uint64_t> index{layout.size(), layout.thickness, 0};
+    for (auto const& stream : streams) {
+      index.push_back(index.back() + stream.size_in_bytes());
+    }
+    const size_t header = index_bytes(layout.size());
+    *output = pressio_data::owning(pressio_byte_dtype, {header + index.back()});
+    auto dest = static_cast<unsigned char*>(output->data());
+    memcpy(dest, index.data(), header);
+    for (size_t i = 0; i < streams.size(); ++i) {
+      memcpy(dest + header + index[i + 2], streams[i].data(), streams[i].size_in_bytes());
+    }
+    return 0;
+  }
+
+  /**
+   * decompresses the subdomains of a stream from compress_subdomains on the thread pool
+   */
+  int decompress_subdomains(pressio_data const& input, pressio_data* output) {
+    auto src = static_cast<unsigned char const*>(input.data());
+    const size_t input_bytes = input.size_in_bytes();
+    uint64_t header[2];
+    if(input_bytes < sizeof(header)) return invalid_stream();
+    memcpy(header, src, sizeof(header));
+    subdomain_layout layout(output->dimensions(), header[1]);
+    if(header[0] != layout.size() || header[1] != layout.thickness || input_bytes < index_bytes(layout.size())) {
+      return invalid_stream();
+    }
+    std::vector<uint64_t> offsets(layout.size() + 1);
+    memcpy(offsets.data(), src + sizeof(header), offsets.size() * sizeof(uint64_t));
+    for (size_t i = 0; i < layout.size(); ++i) {
+      if(offsets[i] > offsets[i + 1]) return invalid_stream();
+    }
+    if(offsets.back() > input_bytes - index_bytes(layout.size())) return invalid_stream();
+    src += index_bytes(layout.size());
+
+    if(!output->has_data()) {
+      *output = pressio_data::owning(output->dtype(), output->dimensions());
+    }
+    const size_t type_size = pressio_dtype_size(output->dtype());
+    std::atomic<int> error{0};
+    pressio_thread_pool::global().parallel_for(0, layout.size(), 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        auto stream = pressio_data::copy(pressio_byte_dtype, src + offsets[i], {offsets[i + 1] - offsets[i]});
+        auto subdomain = pressio_data::empty(output->dtype(), layout.dimensions(i));
+        mgard_plugin plugin(*this);
+        if(output->dtype() == pressio_double_dtype) {
+          plugin.decompress_typed<double>(std::move(stream), &subdomain);
+        } else {
+          plugin.decompress_typed<float>(std::move(stream), &subdomain);
+        }
+        if(subdomain.data() == nullptr) {
+          error = 1;
+          continue;
+        }
+        memcpy(static_cast<unsigned char*>(output->data()) + layout.offset(i) * type_size,
+            subdomain.data(), subdomain.size_in_bytes());
+      }
+    });
+    if(error) return subdomain_failed("decompress");
+    return 0;
+  }
+
   /**
    * typed dispatch function for compression
    *
@@ -184,6 +377,7 @@ class mgard_plugin: public libpressio_compressor_plugin {
     unsigned char* compressed_bytes;
     using qoi_fn =  InputType (*)(int, int, int, InputType*);
 
+    std::lock_guard<std::mutex> guard(mgard_lock);
     switch(function)
     {
       case mgard_compression_function::tol:
@@ -241,7 +435,7 @@ class mgard_plugin: public libpressio_compressor_plugin {
     }
 
     return pressio_data::move(
-        dtype,
+        pressio_byte_dtype,
         compressed_bytes,
         std::vector<size_t>{static_cast<size_t>(outsize)},
         pressio_data_libc_free_fn,
@@ -255,11 +449,12 @@ class mgard_plugin: public libpressio_compressor_plugin {
     auto itype = dtype_to_itype(output_data->dtype());
     InputType* output_buffer = nullptr;
     InputType quantizer = 0; /*unused by the mgard as far as I can tell, but part of the signature*/
-    std::vector<int> dims(output_data->num_dimensions());
+    std::vector<int> dims(3);
     for (int i = 0; i < 3; ++i) {
       dims[i] = output_data->get_dimension(i);
     }
 
+    std::unique_lock<std::mutex> guard(mgard_lock);
     switch(function)
     {
       case mgard_decompression_function::s:
@@ -286,6 +481,7 @@ class mgard_plugin: public libpressio_compressor_plugin {
             );
         break;
     }
+    guard.unlock();
 
     *output_data = pressio_data::move(
         output_data->dtype(),
@@ -354,11 +550,13 @@ class mgard_plugin: public libpressio_compressor_plugin {
   check_configuration(pressio_data const* input)
   {
     pressio_dtype type = input->dtype();
+    //with mgard:decompose the dimensions after the third index separate domains
+    const size_t dims = decompose ? std::min<size_t>(input->num_dimensions(), 3) : input->num_dimensions();
     if (!supported_type(type)) {
       return invalid_type(type);
     } else if (!supported_options(type)) {
       return missing_configuration();
-    } else if (!supported_dims(pressio_data_num_dimensions(input))) {
+    } else if (!supported_dims(dims)) {
       return invalid_dims(input);
     } else
       return 0;
@@ -450,10 +648,32 @@ class mgard_plugin: public libpressio_compressor_plugin {
     return set_error(3, ss.str());
   }
 
+  int unsupported_decomposition() {
+    return set_error(4, "mgard:decompose does not support quantities of interest");
+  }
+
+  int subdomain_failed(const char* action) {
+    std::stringstream ss;
+    ss << "mgard failed to " << action << " a subdomain";
+    return set_error(5, ss.str());
+  }
+
+  int invalid_subdomain_size(unsigned int size) {
+    std::stringstream ss;
+    ss << "mgard:subdomain_size must be 0 or at least " << min_subdomain_extent << ", not " << size;
+    return set_error(7, ss.str());
+  }
+
+  int invalid_stream() {
+    return set_error(6, "invalid mgard:decompose stream for the output dimensions");
+  }
+
   pressio_option tolerance;
   pressio_option s;
   pressio_option qoi_double;
   pressio_option qoi_float;
   pressio_option norm_of_qoi;
+  int decompose = 0;
+  unsigned int subdomain_size = 0;
 };
 static pressio_register X(compressor_plugins(), "mgard", [](){ return compat::make_unique<mgard_plugin>(); });
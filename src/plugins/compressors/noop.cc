@@ -7,12 +7,15 @@
 #include "libpressio_ext/cpp/compressor.h"
 #include "libpressio_ext/cpp/pressio.h"
 #include "libpressio_ext/cpp/options.h"
+#include "pressio_compressor.h"
 
 class noop_compressor_plugin: public libpressio_compressor_plugin {
   public:
 
   struct pressio_options get_configuration_impl() const override {
-    return {};
+    struct pressio_options options;
+    options.set("pressio:thread_safe", static_cast<int>(pressio_thread_safety_multiple));
+    return options;
   }
 
   struct pressio_options get_options_impl() const override {
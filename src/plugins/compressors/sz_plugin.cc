@@ -1,8 +1,14 @@
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <cstdlib>
 
 #include <sz/sz.h>
+#include "pressio_version.h"
+#if LIBPRESSIO_SZ_HAS_OPENMP
+#include <omp.h>
+#include <sz/sz_omp.h>
+#endif
 
 #include "libpressio_ext/cpp/data.h"
 #include "libpressio_ext/cpp/compressor.h"
@@ -62,6 +68,8 @@ class sz_plugin: public libpressio_compressor_plugin {
     options.set_type("sz:data_type", pressio_option_double_type);
     options.set("sz:app", app.c_str());
     options.set("sz:user_params", user_params);
+    options.set("sz:openmp", openmp);
+    options.set("sz:nthreads", nthreads);
     return options;
   }
 
@@ -101,11 +109,14 @@ class sz_plugin: public libpressio_compressor_plugin {
     options.get("sz:data_type", &confparams_cpr->dataType);
     options.get("sz:app", &app);
     options.get("sz:user_params", &user_params);
+    options.get("sz:openmp", &openmp);
+    options.get("sz:nthreads", &nthreads);
 
     return 0;
   }
 
   int compress_impl(const pressio_data *input, struct pressio_data* output) override {
+    if(openmp) return compress_openmp(input, output);
     size_t r1 = pressio_data_get_dimension(input, 0);
     size_t r2 = pressio_data_get_dimension(input, 1);
     size_t r3 = pressio_data_get_dimension(input, 2);
@@ -128,6 +139,7 @@ class sz_plugin: public libpressio_compressor_plugin {
     return 0;
   }
   int decompress_impl(const pressio_data *input, struct pressio_data* output) override {
+    if(openmp) return decompress_openmp(input, output);
 
     size_t r[] = {
      pressio_data_get_dimension(output, 0),
@@ -184,6 +196,109 @@ class sz_plugin: public libpressio_compressor_plugin {
 
 
   private:
+  /*
+   * SZ's OpenMP routines only handle 3D floating point data with an absolute
+   * error bound; value range relative bounds are converted to absolute ones
+   */
+  int check_openmp(pressio_data const* data) {
+#if LIBPRESSIO_SZ_HAS_OPENMP
+    const auto dtype = pressio_data_dtype(data);
+    if(dtype != pressio_float_dtype && dtype != pressio_double_dtype) {
+      return set_error(2, "sz:openmp requires float or double data");
+    }
+    if(pressio_data_num_dimensions(data) != 3) {
+      return set_error(2, "sz:openmp requires 3 dimensional data");
+    }
+    if(confparams_cpr->errorBoundMode != ABS && confparams_cpr->errorBoundMode != REL) {
+      return set_error(2, "sz:openmp requires the ABS or REL error bound mode");
+    }
+    return 0;
+#else
+    (void)data;
+    return set_error(1, "sz:openmp requires SZ built with OpenMP");
+#endif
+  }
+
+#if LIBPRESSIO_SZ_HAS_OPENMP
+  /*
+   * sets the number of OpenMP threads of the calling thread for the lifetime of the object
+   */
+  class omp_threads_guard {
+    public:
+    explicit omp_threads_guard(unsigned int nthreads): previous(omp_get_max_threads()) {
+      if(nthreads != 0) omp_set_num_threads(static_cast<int>(nthreads));
+    }
+    ~omp_threads_guard() {
+      omp_set_num_threads(previous);
+    }
+    omp_threads_guard(omp_threads_guard const&)=delete;
+    omp_threads_guard& operator=(omp_threads_guard const&)=delete;
+
+    private:
+    int previous;
+  };
+
+  template <class T>
+  double absolute_bound(T const* data, size_t n) const {
+    if(confparams_cpr->errorBoundMode == ABS || n == 0) return confparams_cpr->absErrBound;
+    auto range = std::minmax_element(data, data + n);
+    return confparams_cpr->relBoundRatio * (static_cast<double>(*range.second) - static_cast<double>(*range.first));
+  }
+#endif
+
+  int compress_openmp(const pressio_data *input, struct pressio_data* output) {
+    if(int ret = check_openmp(input)) return ret;
+#if LIBPRESSIO_SZ_HAS_OPENMP
+    //SZ's r1 is the slowest varying dimension
+    const size_t r1 = pressio_data_get_dimension(input, 2);
+    const size_t r2 = pressio_data_get_dimension(input, 1);
+    const size_t r3 = pressio_data_get_dimension(input, 0);
+    const size_t n = pressio_data_num_elements(input);
+    size_t outsize = 0;
+    unsigned char* compressed_data = nullptr;
+    omp_threads_guard threads(budgeted_threads(nthreads));
+    if(pressio_data_dtype(input) == pressio_float_dtype) {
+      auto data = static_cast<float*>(pressio_data_ptr(input, nullptr));
+      compressed_data = SZ_compress_float_3D_MDQ_openmp(data, r1, r2, r3, static_cast<float>(absolute_bound(data, n)), &outsize);
+    } else {
+      auto data = static_cast<double*>(pressio_data_ptr(input, nullptr));
+      compressed_data = SZ_compress_double_3D_MDQ_openmp(data, r1, r2, r3, absolute_bound(data, n), &outsize);
+    }
+    if(compressed_data == nullptr) return set_error(3, "SZ's OpenMP compression failed");
+    *output = pressio_data::move(pressio_byte_dtype, compressed_data, 1, &outsize, pressio_data_libc_free_fn, nullptr);
+    return 0;
+#else
+    (void)output;
+    return 0;
+#endif
+  }
+
+  int decompress_openmp(const pressio_data *input, struct pressio_data* output) {
+    if(int ret = check_openmp(output)) return ret;
+#if LIBPRESSIO_SZ_HAS_OPENMP
+    auto dims = output->dimensions();
+    const pressio_dtype type = pressio_data_dtype(output);
+    auto compressed = static_cast<unsigned char*>(pressio_data_ptr(input, nullptr));
+    void* decompressed_data = nullptr;
+    omp_threads_guard threads(budgeted_threads(nthreads));
+    if(type == pressio_float_dtype) {
+      float* data = nullptr;
+      decompressDataSeries_float_3D_openmp(&data, dims[2], dims[1], dims[0], compressed);
+      decompressed_data = data;
+    } else {
+      double* data = nullptr;
+      decompressDataSeries_double_3D_openmp(&data, dims[2], dims[1], dims[0], compressed);
+      decompressed_data = data;
+    }
+    if(decompressed_data == nullptr) return set_error(3, "SZ's OpenMP decompression failed");
+    *output = pressio_data::move(type, decompressed_data, dims, pressio_data_libc_free_fn, nullptr);
+    return 0;
+#else
+    (void)input;
+    return 0;
+#endif
+  }
+
   static int libpressio_type_to_sz_type(pressio_dtype type) {
     switch(type)
     {
@@ -204,6 +319,8 @@ class sz_plugin: public libpressio_compressor_plugin {
   std::string sz_version;
   std::string app = "SZ";
   void* user_params = nullptr;
+  int openmp = 0;
+  unsigned int nthreads = 0;
 };
 
 std::unique_ptr<libpressio_compressor_plugin> make_c_sz() {
@@ -1,14 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <climits>
+#include <cstring>
 #include <vector>
 #include <memory>
+#include <utility>
 #include "libpressio_ext/cpp/data.h"
 #include "libpressio_ext/cpp/compressor.h"
 #include "libpressio_ext/cpp/options.h"
 #include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 #include "pressio_options.h"
 #include "pressio_data.h"
 #include "pressio_compressor.h"
 #include "zfp.h"
 
+namespace {
+  /** the number of values along each side of a zfp block */
+  constexpr size_t block_side = 4;
+  /** the number of values in the largest (4d) zfp block */
+  constexpr size_t max_block_size = 256;
+
+  /**
+   * the blocks of a field in the order zfp encodes them, x varies fastest
+   */
+  struct block_grid {
+    explicit block_grid(std::vector<size_t> field_dims): dims(std::move(field_dims)) {
+      dims.resize(4, 1);
+      for (size_t d = 0; d < 4; ++d) blocks[d] = (dims[d] + block_side - 1) / block_side;
+    }
+
+    size_t num_blocks() const {
+      return blocks[0] * blocks[1] * blocks[2] * blocks[3];
+    }
+
+    void origin(size_t block, size_t block_origin[4]) const {
+      for (size_t d = 0; d < 4; ++d) {
+        block_origin[d] = (block % blocks[d]) * block_side;
+        block /= blocks[d];
+      }
+    }
+
+    std::vector<size_t> dims;
+    size_t blocks[4];
+  };
+
+  bool full_block(size_t dims, unsigned int const n[4]) {
+    for (size_t d = 0; d < 4; ++d) {
+      if(n[d] != (d < dims ? block_side : 1)) return false;
+    }
+    return true;
+  }
+
+  /*
+   * dispatches to zfp's block level encoder and decoder for each scalar type
+   * and dimensionality
+   */
+  template <class T> struct block_codec;
+
+#define LIBPRESSIO_ZFP_BLOCK_CODEC(type)                                                                                 \
+  template <> struct block_codec<type> {                                                                                 \
+    static void encode(zfp_stream* zfp, size_t dims, type const* p, unsigned int const n[4], int const s[4]) {         \
+      const bool full = full_block(dims, n);                                                                             \
+      switch(dims) {                                                                                                     \
+        case 1:                                                                                                          \
+          if(full) zfp_encode_block_strided_##type##_1(zfp, p, s[0]);                                                    \
+          else zfp_encode_partial_block_strided_##type##_1(zfp, p, n[0], s[0]);                                          \
+          break;                                                                                                         \
+        case 2:                                                                                                          \
+          if(full) zfp_encode_block_strided_##type##_2(zfp, p, s[0], s[1]);                                              \
+          else zfp_encode_partial_block_strided_##type##_2(zfp, p, n[0], n[1], s[0], s[1]);                              \
+          break;                                                                                                         \
+        case 3:                                                                                                          \
+          if(full) zfp_encode_block_strided_##type##_3(zfp, p, s[0], s[1], s[2]);                                        \
+          else zfp_encode_partial_block_strided_##type##_3(zfp, p, n[0], n[1], n[2], s[0], s[1], s[2]);                  \
+          break;                                                                                                         \
+        case 4:                                                                                                          \
+          if(full) zfp_encode_block_strided_##type##_4(zfp, p, s[0], s[1], s[2], s[3]);                                  \
+          else zfp_encode_partial_block_strided_##type##_4(zfp, p, n[0], n[1], n[2], n[3], s[0], s[1], s[2], s[3]);      \
+          break;                                                                                                         \
+      }                                                                                                                  \
+    }                                                                                                                    \
+    static void decode(zfp_stream* zfp, size_t dims, type* block) {                                                     \
+      switch(dims) {                                                                                                     \
+        case 1: zfp_decode_block_##type##_1(zfp, block); break;                                                          \
+        case 2: zfp_decode_block_##type##_2(zfp, block); break;                                                          \
+        case 3: zfp_decode_block_##type##_3(zfp, block); break;                                                          \
+        case 4: zfp_decode_block_##type##_4(zfp, block); break;                                                          \
+      }                                                                                                                  \
+    }                                                                                                                    \
+  };
+  LIBPRESSIO_ZFP_BLOCK_CODEC(int32)
+  LIBPRESSIO_ZFP_BLOCK_CODEC(int64)
+  LIBPRESSIO_ZFP_BLOCK_CODEC(float)
+  LIBPRESSIO_ZFP_BLOCK_CODEC(double)
+#undef LIBPRESSIO_ZFP_BLOCK_CODEC
+
+  /**
+   * copies the values of a decoded block which fall inside a region into the region's buffer
+   */
+  template <class T>
+  void scatter_block(T const* block, size_t const origin[4], size_t const start[4], size_t const count[4], T* out) {
+    size_t lo[4], hi[4], stride[4];
+    for (size_t d = 0; d < 4; ++d) {
+      lo[d] = std::max(origin[d], start[d]);
+      hi[d] = std::min(origin[d] + block_side, start[d] + count[d]);
+      if(lo[d] >= hi[d]) return;
+      stride[d] = (d == 0) ? 1 : stride[d-1] * count[d-1];
+    }
+    for (size_t w = lo[3]; w < hi[3]; ++w) {
+      for (size_t z = lo[2]; z < hi[2]; ++z) {
+        for (size_t y = lo[1]; y < hi[1]; ++y) {
+          for (size_t x = lo[0]; x < hi[0]; ++x) {
+            out[(x - start[0]) + (y - start[1]) * stride[1] + (z - start[2]) * stride[2] + (w - start[3]) * stride[3]] =
+              block[(x - origin[0]) + block_side * ((y - origin[1]) + block_side * ((z - origin[2]) + block_side * (w - origin[3])))];
+          }
+        }
+      }
+    }
+  }
+
+  /*
+   * progressive streams begin with the number of blocks and the length in
+   * bits of each block so a decoder can seek to any block and read any
+   * prefix of it
+   */
+  using block_length = uint16_t;
+
+  size_t progressive_header_bytes(size_t num_blocks) {
+    const size_t lengths_bytes = num_blocks * sizeof(block_length);
+    return sizeof(uint64_t) + (lengths_bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+  }
+
+  /**
+   * the parameters of a decompression which may be coarser than the compression
+   */
+  struct decode_params {
+    unsigned int maxprec;
+    int minexp;
+    /** the largest number of bits to read from each block */
+    unsigned int max_block_bits;
+  };
+
+  /**
+   * encodes a field one block at a time, recording the length of each block
+   * \returns false if a block was too long to record
+   */
+  template <class T>
+  bool encode_progressive(zfp_stream* zfp, bitstream* stream, T const* data, block_grid const& grid, size_t dims, block_length* lengths) {
+    const int strides[4] = {
+      1,
+      static_cast<int>(grid.dims[0]),
+      static_cast<int>(grid.dims[0] * grid.dims[1]),
+      static_cast<int>(grid.dims[0] * grid.dims[1] * grid.dims[2])
+    };
+    for (size_t block = 0; block < grid.num_blocks(); ++block) {
+      size_t origin[4];
+      grid.origin(block, origin);
+      unsigned int n[4];
+      size_t offset = 0;
+      for (size_t d = 0; d < 4; ++d) {
+        n[d] = static_cast<unsigned int>(std::min(block_side, grid.dims[d] - origin[d]));
+        offset += origin[d] * strides[d];
+      }
+      const size_t begin = stream_wtell(stream);
+      block_codec<T>::encode(zfp, dims, data + offset, n, strides);
+      const size_t bits = stream_wtell(stream) - begin;
+      if(bits > UINT16_MAX) return false;
+      lengths[block] = static_cast<block_length>(bits);
+    }
+    return true;
+  }
+
+  /**
+   * decodes the blocks covering a region of the field in parallel on the shared thread pool
+   *
+   * \param[in] stream_data the first word of the encoded blocks
+   * \param[in] stream_bytes the size of the encoded blocks
+   * \param[in] locate returns the offset and length in bits of a block given its index
+   */
+  template <class T, class Locate>
+  void decode_region(void* stream_data, size_t stream_bytes, Locate const& locate,
+      block_grid const& grid, size_t dims, decode_params const& params, size_t const start[4], size_t const count[4], T* out) {
+    size_t first_block[4], block_count[4];
+    for (size_t d = 0; d < 4; ++d) {
+      first_block[d] = start[d] / block_side;
+      block_count[d] = (start[d] + count[d] - 1) / block_side - first_block[d] + 1;
+    }
+    const size_t num_blocks = block_count[0] * block_count[1] * block_count[2] * block_count[3];
+    const size_t min_blocks_per_task = 64;
+    pressio_thread_pool::global().parallel_for(0, num_blocks, min_blocks_per_task, [&](size_t first, size_t last) {
+      zfp_stream* zfp = zfp_stream_open(nullptr);
+      bitstream* stream = stream_open(stream_data, stream_bytes);
+      zfp_stream_set_bit_stream(zfp, stream);
+      zfp->maxprec = params.maxprec;
+      zfp->minexp = params.minexp;
+      T block[max_block_size];
+      for (size_t i = first; i < last; ++i) {
+        size_t index = i, id = 0, scale = 1, origin[4];
+        for (size_t d = 0; d < 4; ++d) {
+          const size_t b = first_block[d] + index % block_count[d];
+          index /= block_count[d];
+          id += b * scale;
+          scale *= grid.blocks[d];
+          origin[d] = b * block_side;
+        }
+        //reading a prefix of a block decodes it with fewer bit planes
+        const std::pair<size_t, size_t> location = locate(id);
+        zfp->minbits = 0;
+        zfp->maxbits = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(location.second, params.max_block_bits)));
+        stream_rseek(stream, location.first);
+        block_codec<T>::decode(zfp, dims, block);
+        scatter_block(block, origin, start, count, out);
+      }
+      stream_close(stream);
+      zfp_stream_close(zfp);
+    });
+  }
+}
+
 class zfp_plugin: public libpressio_compressor_plugin {
   public:
     zfp_plugin() {
@@ -26,25 +237,42 @@ class zfp_plugin: public libpressio_compressor_plugin {
     ~zfp_plugin() {
       zfp_stream_close(zfp);
     }
-    zfp_plugin(zfp_plugin const& rhs): libpressio_compressor_plugin(rhs), zfp(zfp_stream_open(NULL)) {
+    zfp_plugin(zfp_plugin const& rhs): libpressio_compressor_plugin(rhs), zfp(zfp_stream_open(NULL)),
+      progressive(rhs.progressive), progressive_accuracy(rhs.progressive_accuracy), progressive_bytes(rhs.progressive_bytes),
+      region_start(rhs.region_start), region_count(rhs.region_count) {
       zfp_stream_set_params(zfp, rhs.zfp->minbits, rhs.zfp->maxbits, rhs.zfp->maxprec, rhs.zfp->minexp);
       zfp_stream_set_omp_threads(zfp, zfp_stream_omp_threads(rhs.zfp));
       zfp_stream_set_omp_chunk_size(zfp, zfp_stream_omp_chunk_size(rhs.zfp));
       zfp_stream_set_execution(zfp, zfp_stream_execution(rhs.zfp));
     }
-    zfp_plugin(zfp_plugin && rhs) noexcept: zfp(std::exchange(rhs.zfp, zfp_stream_open(NULL))) {}
+    zfp_plugin(zfp_plugin && rhs) noexcept: libpressio_compressor_plugin(std::move(rhs)), zfp(std::exchange(rhs.zfp, zfp_stream_open(NULL))),
+      progressive(rhs.progressive), progressive_accuracy(rhs.progressive_accuracy), progressive_bytes(rhs.progressive_bytes),
+      region_start(std::move(rhs.region_start)), region_count(std::move(rhs.region_count)) {}
     zfp_plugin& operator=(zfp_plugin && rhs) noexcept {
-      if(this != &rhs) return *this;
-      zfp = std::exchange(rhs.zfp, zfp_stream_open(NULL));
+      if(this == &rhs) return *this;
+      libpressio_compressor_plugin::operator=(std::move(rhs));
+      //rhs closes the stream this plugin owned
+      std::swap(zfp, rhs.zfp);
+      progressive = rhs.progressive;
+      progressive_accuracy = rhs.progressive_accuracy;
+      progressive_bytes = rhs.progressive_bytes;
+      region_start = std::move(rhs.region_start);
+      region_count = std::move(rhs.region_count);
       return *this;
     }
 
     zfp_plugin& operator=(zfp_plugin const& rhs) {
       if(this == &rhs) return *this;
+      libpressio_compressor_plugin::operator=(rhs);
       zfp_stream_set_params(zfp, rhs.zfp->minbits, rhs.zfp->maxbits, rhs.zfp->maxprec, rhs.zfp->minexp);
       zfp_stream_set_omp_threads(zfp, zfp_stream_omp_threads(rhs.zfp));
       zfp_stream_set_omp_chunk_size(zfp, zfp_stream_omp_chunk_size(rhs.zfp));
       zfp_stream_set_execution(zfp, zfp_stream_execution(rhs.zfp));
+      progressive = rhs.progressive;
+      progressive_accuracy = rhs.progressive_accuracy;
+      progressive_bytes = rhs.progressive_bytes;
+      region_start = rhs.region_start;
+      region_count = rhs.region_count;
       return *this;
     }
 
@@ -57,6 +285,11 @@ class zfp_plugin: public libpressio_compressor_plugin {
       options.set("zfp:execution", static_cast<int>(zfp_stream_execution(zfp)));
       options.set("zfp:omp_threads", zfp_stream_omp_threads(zfp));
       options.set("zfp:omp_chunk_size", zfp_stream_omp_chunk_size(zfp));
+      options.set("zfp:progressive", progressive);
+      options.set("zfp:progressive_accuracy", progressive_accuracy);
+      options.set("zfp:progressive_bytes", progressive_bytes);
+      options.set("zfp:region_start", region_start);
+      options.set("zfp:region_count", region_count);
       options.set_type("zfp:precision", pressio_option_uint32_type);
       options.set_type("zfp:accuracy", pressio_option_double_type);
       options.set_type("zfp:rate", pressio_option_double_type);
@@ -117,17 +350,30 @@ class zfp_plugin: public libpressio_compressor_plugin {
         }
       }
 
+      options.get("zfp:progressive", &progressive);
+      options.get("zfp:progressive_accuracy", &progressive_accuracy);
+      options.get("zfp:progressive_bytes", &progressive_bytes);
+      options.get("zfp:region_start", &region_start);
+      options.get("zfp:region_count", &region_count);
+
       return 0;
     }
 
     int compress_impl(const pressio_data *input, struct pressio_data* output) override {
-
+      //the thread budget applies to this call only, zfp:omp_threads keeps its configured value
+      omp_threads_guard threads(zfp, budgeted_threads(zfp_stream_omp_threads(zfp)));
       zfp_field* in_field;
       auto input_copy = pressio_data::clone(*input);
       if(int ret = convert_pressio_data_to_field(&input_copy, &in_field)) {
         return ret;
       }
 
+      if(progressive) {
+        int ret = compress_progressive(&input_copy, in_field, output);
+        zfp_field_free(in_field);
+        return ret;
+      }
+
       //create compressed data buffer and stream
       size_t bufsize = zfp_stream_maximum_size(zfp, in_field);
       void* buffer = malloc(bufsize);
@@ -150,6 +396,10 @@ class zfp_plugin: public libpressio_compressor_plugin {
     }
 
     int decompress_impl(const pressio_data *input, struct pressio_data* output) override {
+      if(progressive || region_start.has_data() || region_count.has_data()) {
+        return decompress_blocks(input, output);
+      }
+
       //save the exec mode, set it to serial, and reset it at the end of the decompression
       //if parallel decompression is requested and not supported
       //
@@ -222,11 +472,178 @@ class zfp_plugin: public libpressio_compressor_plugin {
 
 
   private:
+    /*
+     * sets the OpenMP threads of an OpenMP stream for the lifetime of the object
+     */
+    class omp_threads_guard {
+      public:
+      omp_threads_guard(zfp_stream* zfp, unsigned int nthreads): zfp(zfp), previous(zfp_stream_omp_threads(zfp)),
+        omp(zfp_stream_execution(zfp) == zfp_exec_omp) {
+        if(omp) zfp_stream_set_omp_threads(zfp, nthreads);
+      }
+      ~omp_threads_guard() {
+        if(omp) zfp_stream_set_omp_threads(zfp, previous);
+      }
+      omp_threads_guard(omp_threads_guard const&)=delete;
+      omp_threads_guard& operator=(omp_threads_guard const&)=delete;
+
+      private:
+      zfp_stream* zfp;
+      unsigned int previous;
+      bool omp;
+    };
+
     int invalid_type() { return set_error(1, "invalid_type");}
     int invalid_dimensions() { return set_error(2, "invalid_dimensions");}
     int compression_failed() { return set_error(3, "compression failed");}
     int decompression_failed() { return set_error(4, "decompression failed");}
     int invalid_rate() { return set_error(1, "if you set rate, you must set type, dims, and wra for the rate mode"); }
+    int invalid_stream() { return set_error(5, "the compressed stream does not match the output dimensions"); }
+    int invalid_region() { return set_error(6, "zfp:region_start and zfp:region_count must have one entry per dimension inside the field"); }
+
+    /**
+     * encodes each block separately and prepends the length of every block
+     * so decompression can read a prefix of each block
+     */
+    int compress_progressive(const pressio_data* input, zfp_field* field, pressio_data* output) {
+      const block_grid grid(input->dimensions());
+      const size_t num_blocks = grid.num_blocks();
+      const size_t header_bytes = progressive_header_bytes(num_blocks);
+      const size_t max_stream_bytes = zfp_stream_maximum_size(zfp, field);
+      if(max_stream_bytes == 0) return compression_failed();
+
+      *output = pressio_data::owning(pressio_byte_dtype, {header_bytes + max_stream_bytes});
+      auto bytes = static_cast<uint8_t*>(output->data());
+      std::vector<block_length> lengths(num_blocks);
+      bitstream* stream = stream_open(bytes + header_bytes, max_stream_bytes);
+      zfp_stream_set_bit_stream(zfp, stream);
+      zfp_stream_rewind(zfp);
+
+      const size_t dims = input->num_dimensions();
+      bool encoded = false;
+      switch(input->dtype()) {
+        case pressio_int32_dtype:
+          encoded = encode_progressive(zfp, stream, static_cast<int32 const*>(input->data()), grid, dims, lengths.data());
+          break;
+        case pressio_int64_dtype:
+          encoded = encode_progressive(zfp, stream, static_cast<int64 const*>(input->data()), grid, dims, lengths.data());
+          break;
+        case pressio_float_dtype:
+          encoded = encode_progressive(zfp, stream, static_cast<float const*>(input->data()), grid, dims, lengths.data());
+          break;
+        case pressio_double_dtype:
+          encoded = encode_progressive(zfp, stream, static_cast<double const*>(input->data()), grid, dims, lengths.data());
+          break;
+        default:
+          stream_close(stream);
+          return invalid_type();
+      }
+      zfp_stream_flush(zfp);
+      const size_t stream_bytes = zfp_stream_compressed_size(zfp);
+      stream_close(stream);
+      if(!encoded) return compression_failed();
+
+      const uint64_t header_blocks = num_blocks;
+      memcpy(bytes, &header_blocks, sizeof(header_blocks));
+      memcpy(bytes + sizeof(header_blocks), lengths.data(), num_blocks * sizeof(block_length));
+      output->set_dimensions({header_bytes + stream_bytes});
+      return 0;
+    }
+
+    /**
+     * decodes the blocks of a progressive or fixed rate stream which cover the
+     * requested region, the whole field if no region is set
+     */
+    int decompress_blocks(const pressio_data* input, pressio_data* output) {
+      const pressio_dtype dtype = output->dtype();
+      const block_grid grid(output->dimensions());
+      const size_t num_blocks = grid.num_blocks();
+      const size_t dims = output->num_dimensions();
+
+      size_t start[4] = {0, 0, 0, 0};
+      size_t count[4] = {grid.dims[0], grid.dims[1], grid.dims[2], grid.dims[3]};
+      std::vector<size_t> output_dims = output->dimensions();
+      if(region_start.has_data() || region_count.has_data()) {
+        auto region_start_values = region_start.cast(pressio_uint64_dtype);
+        auto region_count_values = region_count.cast(pressio_uint64_dtype);
+        if(region_start_values.num_elements() != dims || region_count_values.num_elements() != dims) return invalid_region();
+        auto start_ptr = static_cast<uint64_t*>(region_start_values.data());
+        auto count_ptr = static_cast<uint64_t*>(region_count_values.data());
+        for (size_t d = 0; d < dims; ++d) {
+          if(count_ptr[d] == 0 || start_ptr[d] + count_ptr[d] > grid.dims[d]) return invalid_region();
+          start[d] = start_ptr[d];
+          count[d] = count_ptr[d];
+          output_dims[d] = count_ptr[d];
+        }
+      }
+
+      decode_params params{zfp->maxprec, zfp->minexp, UINT_MAX};
+      //reversible streams (minexp below ZFP_MIN_EXP) have no coarser accuracy to decode
+      if(progressive_accuracy > 0 && zfp->minexp >= ZFP_MIN_EXP) {
+        int exponent;
+        std::frexp(progressive_accuracy, &exponent);
+        params.minexp = std::max(params.minexp, exponent - 1);
+      }
+      if(progressive_bytes > 0) {
+        //at least enough bits for the block exponent and a few bit planes
+        const size_t min_block_bits = 32;
+        params.max_block_bits = static_cast<unsigned int>(std::max<size_t>(min_block_bits, size_t(progressive_bytes) * 8 / num_blocks));
+      }
+
+      auto bytes = static_cast<uint8_t*>(input->data());
+      if(progressive) {
+        const size_t header_bytes = progressive_header_bytes(num_blocks);
+        uint64_t header_blocks = 0;
+        if(input->size_in_bytes() < header_bytes) return invalid_stream();
+        memcpy(&header_blocks, bytes, sizeof(header_blocks));
+        if(header_blocks != num_blocks) return invalid_stream();
+
+        std::vector<block_length> lengths(num_blocks);
+        memcpy(lengths.data(), bytes + sizeof(header_blocks), num_blocks * sizeof(block_length));
+        std::vector<size_t> offsets(num_blocks);
+        size_t offset = 0;
+        for (size_t block = 0; block < num_blocks; ++block) {
+          offsets[block] = offset;
+          offset += lengths[block];
+        }
+        const size_t stream_bytes = input->size_in_bytes() - header_bytes;
+        if((offset + 7) / 8 > stream_bytes) return invalid_stream();
+        auto locate = [&offsets, &lengths](size_t block) { return std::make_pair(offsets[block], static_cast<size_t>(lengths[block])); };
+        return decode_blocks(bytes + header_bytes, stream_bytes, locate, grid, dims, params, start, count, dtype, output_dims, output);
+      } else if(zfp_stream_compression_mode(zfp) == zfp_mode_fixed_rate) {
+        //every block of a fixed rate stream is exactly maxbits long
+        const size_t block_bits = zfp->maxbits;
+        if((num_blocks * block_bits + 7) / 8 > input->size_in_bytes()) return invalid_stream();
+        auto locate = [block_bits](size_t block) { return std::make_pair(block * block_bits, block_bits); };
+        return decode_blocks(bytes, input->size_in_bytes(), locate, grid, dims, params, start, count, dtype, output_dims, output);
+      } else {
+        return set_error(7, "decoding a region requires fixed rate mode or zfp:progressive");
+      }
+    }
+
+    template <class Locate>
+    int decode_blocks(void* stream_data, size_t stream_bytes, Locate const& locate, block_grid const& grid, size_t dims,
+        decode_params const& params, size_t const start[4], size_t const count[4], pressio_dtype dtype,
+        std::vector<size_t> const& output_dims, pressio_data* output) {
+      *output = pressio_data::owning(dtype, output_dims);
+      switch(dtype) {
+        case pressio_int32_dtype:
+          decode_region(stream_data, stream_bytes, locate, grid, dims, params, start, count, static_cast<int32*>(output->data()));
+          break;
+        case pressio_int64_dtype:
+          decode_region(stream_data, stream_bytes, locate, grid, dims, params, start, count, static_cast<int64*>(output->data()));
+          break;
+        case pressio_float_dtype:
+          decode_region(stream_data, stream_bytes, locate, grid, dims, params, start, count, static_cast<float*>(output->data()));
+          break;
+        case pressio_double_dtype:
+          decode_region(stream_data, stream_bytes, locate, grid, dims, params, start, count, static_cast<double*>(output->data()));
+          break;
+        default:
+          return invalid_type();
+      }
+      return 0;
+    }
 
     int libpressio_type(pressio_data* data, zfp_type* type) {
       switch(pressio_data_dtype(data))
@@ -281,6 +698,11 @@ class zfp_plugin: public libpressio_compressor_plugin {
     }
     
     zfp_stream* zfp;
+    int progressive = 0;
+    double progressive_accuracy = 0;
+    unsigned int progressive_bytes = 0;
+    pressio_data region_start = pressio_data::empty(pressio_uint64_dtype, {});
+    pressio_data region_count = pressio_data::empty(pressio_uint64_dtype, {});
 };
 
 static pressio_register X(compressor_plugins(), "zfp", [](){ return compat::make_unique<zfp_plugin>(); });
@@ -0,0 +1,176 @@
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include "pressio_data.h"
+#include "pressio_compressor.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/io.h"
+
+namespace {
+  /**
+   * a process-wide, thread-safe store of named buffers with a least-recently-used
+   * eviction policy when the store exceeds its capacity
+   */
+  class memory_store {
+    public:
+    static memory_store& instance() {
+      static memory_store store;
+      return store;
+    }
+
+    std::shared_ptr<pressio_data> get(std::string const& name) {
+      std::lock_guard<std::mutex> guard(lock);
+      auto it = entries.find(name);
+      if(it == entries.end()) return nullptr;
+      lru.splice(lru.begin(), lru, it->second.position);
+      return it->second.data;
+    }
+
+    /**
+     * \returns false if the buffer could never fit within the capacity of the store
+     */
+    bool put(std::string const& name, std::shared_ptr<pressio_data>&& data) {
+      std::lock_guard<std::mutex> guard(lock);
+      const size_t bytes = data->size_in_bytes();
+      if(capacity != 0 && bytes > capacity) return false;
+
+      remove_locked(name);
+      lru.push_front(name);
+      entries.emplace(name, entry{std::move(data), lru.begin()});
+      used += bytes;
+      evict_locked();
+      return true;
+    }
+
+    void set_capacity(size_t bytes) {
+      std::lock_guard<std::mutex> guard(lock);
+      capacity = bytes;
+      evict_locked();
+    }
+
+    size_t get_capacity() {
+      std::lock_guard<std::mutex> guard(lock);
+      return capacity;
+    }
+
+    private:
+    struct entry {
+      std::shared_ptr<pressio_data> data;
+      std::list<std::string>::iterator position;
+    };
+
+    void remove_locked(std::string const& name) {
+      auto it = entries.find(name);
+      if(it == entries.end()) return;
+      used -= it->second.data->size_in_bytes();
+      lru.erase(it->second.position);
+      entries.erase(it);
+    }
+
+    void evict_locked() {
+      //never evict the most recently used entry; put() already rejected buffers that cannot fit
+      while(capacity != 0 && used > capacity && lru.size() > 1) {
+        remove_locked(lru.back());
+      }
+    }
+
+    std::mutex lock;
+    std::list<std::string> lru;
+    std::unordered_map<std::string, entry> entries;
+    size_t used = 0;
+    size_t capacity = 0;
+  };
+
+  constexpr size_t bytes_per_mb = 1024 * 1024;
+
+  /**
+   * deleter for references returned from read; releases the reference to the stored buffer
+   */
+  void memory_io_release(void*, void* metadata) {
+    delete static_cast<std::shared_ptr<pressio_data>*>(metadata);
+  }
+}
+
+struct memory_io : public libpressio_io_plugin {
+  virtual struct pressio_data* read_impl(struct pressio_data* data) override {
+    if(data != nullptr) pressio_data_free(data);
+
+    auto stored = memory_store::instance().get(path);
+    if(not stored) {
+      missing_buffer(path);
+      return nullptr;
+    }
+
+    //returns a reference to the stored buffer which keeps it alive even if it is evicted
+    auto dims = stored->dimensions();
+    auto dtype = stored->dtype();
+    void* ptr = stored->data();
+    return pressio_data_new_move(
+        dtype,
+        ptr,
+        dims.size(),
+        dims.data(),
+        memory_io_release,
+        new std::shared_ptr<pressio_data>(std::move(stored))
+        );
+  }
+
+  virtual int write_impl(struct pressio_data const* data) override{
+    if(path.empty()) return missing_path();
+    auto stored = std::make_shared<pressio_data>(pressio_data::clone(*data));
+    if(not memory_store::instance().put(path, std::move(stored))) {
+      return exceeds_capacity(data->size_in_bytes());
+    }
+    return 0;
+  }
+
+  virtual struct pressio_options get_configuration_impl() const override{
+    return {
+      {"pressio:thread_safe",  static_cast<int>(pressio_thread_safety_multiple)}
+    };
+  }
+
+  virtual int set_options_impl(struct pressio_options const& opts) override{
+    opts.get("io:path", &path);
+    unsigned int capacity_mb;
+    if(opts.get("memory:capacity_mb", &capacity_mb) == pressio_options_key_set) {
+      memory_store::instance().set_capacity(static_cast<size_t>(capacity_mb) * bytes_per_mb);
+    }
+    return 0;
+  }
+  virtual struct pressio_options get_options_impl() const override{
+    return {
+      {"io:path", path},
+      {"memory:capacity_mb", static_cast<unsigned int>(memory_store::instance().get_capacity() / bytes_per_mb)},
+    };
+  }
+
+  int patch_version() const override{
+    return 1;
+  }
+  virtual const char* version() const override{
+    return "0.0.1";
+  }
+
+  std::shared_ptr<libpressio_io_plugin> clone() override {
+    return compat::make_unique<memory_io>(*this);
+  }
+
+  private:
+  int missing_path() { return set_error(1, "io:path must be set to name the buffer"); }
+  int missing_buffer(std::string const& name) { return set_error(2, "no buffer stored at " + name); }
+  int exceeds_capacity(size_t bytes) {
+    std::stringstream ss;
+    ss << "buffer of " << bytes << " bytes exceeds the capacity of the memory store";
+    return set_error(3, ss.str());
+  }
+
+  std::string path;
+};
+
+static pressio_register X(io_plugins(), "memory", [](){ return compat::make_unique<memory_io>(); });
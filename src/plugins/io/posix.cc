@@ -1,5 +1,10 @@
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include "pressio_data.h"
 #include "pressio_compressor.h"
@@ -8,6 +13,7 @@
 #include "libpressio_ext/cpp/options.h"
 #include "libpressio_ext/cpp/data.h"
 #include "libpressio_ext/cpp/io.h"
+#include "pressio_byteswap.h"
 
 
 
@@ -91,66 +97,102 @@ extern "C" {
   }
 }
 
-struct posix_io : public libpressio_io_plugin {
-  virtual struct pressio_data* read_impl(struct pressio_data* data) override {
-    errno = 0;
-    if(path) {
-        auto ret = pressio_io_data_path_read(data, path->c_str());
-        if(ret == nullptr) {
-          if(errno != 0)set_error(2, strerror(errno));
-          else set_error(3, "invalid dims");
-        }
-        return ret;
+namespace {
+  /**
+   * reads exactly bytes from fd unless the end of file or an error is reached
+   */
+  bool read_fully(int fd, uint8_t* buffer, size_t bytes) {
+    while(bytes > 0) {
+      ssize_t ret = read(fd, buffer, bytes);
+      if(ret <= 0) return false;
+      buffer += ret;
+      bytes -= ret;
     }
-    if(file_ptr) {
-      auto ret = pressio_io_data_fread(data, *file_ptr);
-      if(ret == nullptr) {
-        if(errno != 0)set_error(2, strerror(errno));
-        else set_error(3, "invalid dims");
-      }
-      return ret;
+    return true;
+  }
+
+  /**
+   * writes exactly bytes to fd unless an error occurs
+   */
+  bool write_fully(int fd, uint8_t const* buffer, size_t bytes) {
+    while(bytes > 0) {
+      ssize_t ret = write(fd, buffer, bytes);
+      if(ret <= 0) return false;
+      buffer += ret;
+      bytes -= ret;
     }
-    if(fd) {
-      auto ret = pressio_io_data_read(data, *fd);
-      if(ret == nullptr) {
-        if(errno != 0) set_error(2, strerror(errno));
-        else set_error(3, "invalid dims");
-      }
-      return ret;
+    return true;
+  }
+
+  /**
+   * a file accessed through either a stdio stream or a descriptor; seeks go
+   * through the same layer as the reads and writes so that buffered data is
+   * never bypassed
+   */
+  struct posix_stream {
+    FILE* file = nullptr;
+    int fd = -1;
+
+    bool read(uint8_t* buffer, size_t bytes) {
+      if(file) return fread(buffer, 1, bytes, file) == bytes;
+      return read_fully(fd, buffer, bytes);
+    }
+    bool write(uint8_t const* buffer, size_t bytes) {
+      if(file) return fwrite(buffer, 1, bytes, file) == bytes;
+      return write_fully(fd, buffer, bytes);
+    }
+    bool skip(uint64_t bytes) {
+      if(file) return fseeko(file, static_cast<off_t>(bytes), SEEK_CUR) == 0;
+      return lseek(fd, static_cast<off_t>(bytes), SEEK_CUR) != -1;
+    }
+    off_t position() const {
+      return file ? ftello(file) : lseek(fd, 0, SEEK_CUR);
+    }
+    int descriptor() const {
+      return file ? fileno(file) : fd;
     }
+  };
 
-    invalid_configuration();
-    return nullptr;
+  /**
+   * reads a byte count given either as a uint32 or, for counts of 4 GiB and
+   * more, as a double holding an integer
+   * \returns false if the option is set but is not such a count
+   */
+  bool cast_byte_count(pressio_options const& options, std::string const& key, uint64_t& value) {
+    double count;
+    if(options.cast(key, &count, pressio_conversion_implicit) != pressio_options_key_set) return true;
+    //doubles hold every integer up to 2^53 exactly
+    if(!(count >= 0 && count <= 9007199254740992.0) || std::floor(count) != count) return false;
+    value = static_cast<uint64_t>(count);
+    return true;
   }
 
-  virtual int write_impl(struct pressio_data const* data) override{
+  void set_byte_count(pressio_options& options, std::string const& key, uint64_t value) {
+    if(value <= UINT32_MAX) options.set(key, static_cast<unsigned int>(value));
+    else options.set(key, static_cast<double>(value));
+  }
+}
+
+struct posix_io : public libpressio_io_plugin {
+  virtual struct pressio_data* read_impl(struct pressio_data* data) override {
     errno = 0;
-    if(path) {
-      int ret = pressio_io_data_path_write(data, path->c_str()) != data->size_in_bytes();
-      if(ret) {
-        if(errno) return set_error(2, strerror(errno));
-        else return set_error(3, "unknown failure");
-      }
-      return ret;
-    }
-    else if(file_ptr) {
-      int ret = pressio_io_data_fwrite(data, *file_ptr) != data->size_in_bytes();
-      if(ret) {
-        if(errno) set_error(2, strerror(errno));
-        else set_error(3, "unknown failure");
-      }
-      return ret;
+    pressio_data* ret = (offset != 0 || record_stride != 0) ? read_layout(data) : read_contiguous(data);
+    if(ret != nullptr && libpressio::byteswap::needs_swap(order)) {
+      libpressio::byteswap::swap_bytes(ret->data(), ret->num_elements(), pressio_dtype_size(ret->dtype()));
     }
-    else if(fd) {
-      int ret = pressio_io_data_write(data, *fd) != data->size_in_bytes();
-      if(ret) {
-        if(errno) set_error(2, strerror(errno));
-        else set_error(3, "unknown failure");
-      }
-      return ret;
+    return ret;
+  }
+
+  virtual int write_impl(struct pressio_data const* data) override{
+    errno = 0;
+    if(libpressio::byteswap::needs_swap(order)) {
+      auto swapped = pressio_data::clone(*data);
+      libpressio::byteswap::swap_bytes(swapped.data(), swapped.num_elements(), pressio_dtype_size(swapped.dtype()));
+      return (offset != 0 || record_stride != 0) ? write_layout(&swapped) : write_contiguous(&swapped);
     }
-    return invalid_configuration();
+    return (offset != 0 || record_stride != 0) ? write_layout(data) : write_contiguous(data);
   }
+
   virtual struct pressio_options get_configuration_impl() const override{
     return {
       {"pressio:thread_safe",  static_cast<int>(pressio_thread_safety_single)}
@@ -178,6 +220,19 @@ struct posix_io : public libpressio_io_plugin {
     } else {
       this->fd = {};
     }
+
+    std::string byte_order;
+    if(options.get("io:byte_order", &byte_order) == pressio_options_key_set) {
+      if(not libpressio::byteswap::parse_byte_order(byte_order, order)) {
+        return invalid_byte_order(byte_order);
+      }
+      this->byte_order = byte_order;
+    }
+    for (auto const& count : {std::make_pair("io:offset", &offset),
+        std::make_pair("posix:record_size", &record_size),
+        std::make_pair("posix:record_stride", &record_stride)}) {
+      if(not cast_byte_count(options, count.first, *count.second)) return invalid_byte_count(count.first);
+    }
     return 0;
   }
   virtual struct pressio_options get_options_impl() const override{
@@ -192,6 +247,11 @@ struct posix_io : public libpressio_io_plugin {
     if(fd) opts.set("io:file_descriptor", *fd);
     else opts.set_type("io:file_descriptor", pressio_option_int32_type);
 
+    set_byte_count(opts, "io:offset", offset);
+    opts.set("io:byte_order", byte_order);
+    set_byte_count(opts, "posix:record_size", record_size);
+    set_byte_count(opts, "posix:record_stride", record_stride);
+
     return opts;
   }
 
@@ -207,13 +267,220 @@ struct posix_io : public libpressio_io_plugin {
   }
 
   private:
+  pressio_data* read_contiguous(struct pressio_data* data) {
+    if(path) {
+        auto ret = pressio_io_data_path_read(data, path->c_str());
+        if(ret == nullptr) {
+          if(errno != 0)set_error(2, strerror(errno));
+          else set_error(3, "invalid dims");
+        }
+        return ret;
+    }
+    if(file_ptr) {
+      auto ret = pressio_io_data_fread(data, *file_ptr);
+      if(ret == nullptr) {
+        if(errno != 0)set_error(2, strerror(errno));
+        else set_error(3, "invalid dims");
+      }
+      return ret;
+    }
+    if(fd) {
+      auto ret = pressio_io_data_read(data, *fd);
+      if(ret == nullptr) {
+        if(errno != 0) set_error(2, strerror(errno));
+        else set_error(3, "invalid dims");
+      }
+      return ret;
+    }
+
+    invalid_configuration();
+    return nullptr;
+  }
+
+  /**
+   * opens the configured file for a read or write with a layout; the stream
+   * of a path is closed by close_stream
+   */
+  bool open_stream(posix_stream& stream, bool writing) {
+    if(path) {
+      if(writing) {
+        //the bytes around the records, such as a header, are kept if the file exists
+        stream.file = fopen(path->c_str(), "r+");
+        if(stream.file == nullptr && errno == ENOENT) {
+          errno = 0;
+          stream.file = fopen(path->c_str(), "w");
+        }
+      } else {
+        stream.file = fopen(path->c_str(), "r");
+      }
+      if(stream.file == nullptr) {
+        set_error(2, strerror(errno));
+        return false;
+      }
+    }
+    else if(file_ptr) stream.file = *file_ptr;
+    else if(fd) stream.fd = *fd;
+    else {
+      invalid_configuration();
+      return false;
+    }
+    return true;
+  }
+
+  void close_stream(posix_stream& stream) {
+    if(path) fclose(stream.file);
+  }
+
+  /**
+   * reads from the file skipping io:offset bytes, then io:record_size bytes
+   * out of every io:record_stride bytes if records are used
+   */
+  pressio_data* read_layout(struct pressio_data* data) {
+    if(record_stride != 0 && (record_size == 0 || record_size > record_stride)) {
+      invalid_records();
+      if(data != nullptr) pressio_data_free(data);
+      return nullptr;
+    }
+    posix_stream stream;
+    if(not open_stream(stream, false)) {
+      if(data != nullptr) pressio_data_free(data);
+      return nullptr;
+    }
+
+    pressio_data* ret = nullptr;
+    if(not stream.skip(offset)) {
+      set_error(2, strerror(errno));
+      if(data != nullptr) pressio_data_free(data);
+    } else {
+      ret = allocate_layout(data, stream);
+      if(ret != nullptr && not read_records(stream, static_cast<uint8_t*>(ret->data()), ret->size_in_bytes())) {
+        if(errno != 0) set_error(2, strerror(errno));
+        else set_error(3, "invalid dims");
+        pressio_data_free(ret);
+        ret = nullptr;
+      }
+    }
+
+    close_stream(stream);
+    return ret;
+  }
+
+  pressio_data* allocate_layout(struct pressio_data* data, posix_stream const& stream) {
+    if(data != nullptr) {
+      if(data->has_data()) return data;
+      auto ret = pressio_data_new_owning(data->dtype(), data->num_dimensions(), data->dimensions().data());
+      pressio_data_free(data);
+      return ret;
+    }
+
+    //without dims, read the remainder of the file as bytes
+    struct stat statbuf;
+    off_t position = stream.position();
+    if(fstat(stream.descriptor(), &statbuf) || position == -1) {
+      set_error(2, strerror(errno));
+      return nullptr;
+    }
+    size_t available = (statbuf.st_size > position) ? static_cast<size_t>(statbuf.st_size - position) : 0;
+    size_t size = available;
+    if(record_stride != 0) {
+      size_t records = (available < record_size) ? 0 : (available - record_size) / record_stride + 1;
+      size = records * record_size;
+    }
+    return pressio_data_new_owning(pressio_byte_dtype, 1, &size);
+  }
+
+  bool read_records(posix_stream& stream, uint8_t* buffer, size_t bytes) {
+    if(record_stride == 0) return stream.read(buffer, bytes);
+    while(bytes > 0) {
+      size_t chunk = std::min<uint64_t>(bytes, record_size);
+      if(not stream.read(buffer, chunk)) return false;
+      buffer += chunk;
+      bytes -= chunk;
+      if(bytes > 0 && not stream.skip(record_stride - record_size)) return false;
+    }
+    return true;
+  }
+
+  /**
+   * writes to the file with the layout read by read_layout; the bytes skipped
+   * between records are left unchanged
+   */
+  int write_layout(struct pressio_data const* data) {
+    if(record_stride != 0 && (record_size == 0 || record_size > record_stride)) return invalid_records();
+    posix_stream stream;
+    if(not open_stream(stream, true)) return error_code();
+
+    bool written = stream.skip(offset);
+    uint8_t const* buffer = static_cast<uint8_t const*>(data->data());
+    size_t bytes = data->size_in_bytes();
+    if(record_stride == 0) {
+      written = written && stream.write(buffer, bytes);
+    }
+    while(written && record_stride != 0 && bytes > 0) {
+      size_t chunk = std::min<uint64_t>(bytes, record_size);
+      written = stream.write(buffer, chunk);
+      buffer += chunk;
+      bytes -= chunk;
+      if(written && bytes > 0) written = stream.skip(record_stride - record_size);
+    }
+    close_stream(stream);
+
+    if(not written) {
+      if(errno) return set_error(2, strerror(errno));
+      else return set_error(3, "unknown failure");
+    }
+    return 0;
+  }
+
+  int write_contiguous(struct pressio_data const* data) {
+    if(path) {
+      int ret = pressio_io_data_path_write(data, path->c_str()) != data->size_in_bytes();
+      if(ret) {
+        if(errno) return set_error(2, strerror(errno));
+        else return set_error(3, "unknown failure");
+      }
+      return ret;
+    }
+    else if(file_ptr) {
+      int ret = pressio_io_data_fwrite(data, *file_ptr) != data->size_in_bytes();
+      if(ret) {
+        if(errno) set_error(2, strerror(errno));
+        else set_error(3, "unknown failure");
+      }
+      return ret;
+    }
+    else if(fd) {
+      int ret = pressio_io_data_write(data, *fd) != data->size_in_bytes();
+      if(ret) {
+        if(errno) set_error(2, strerror(errno));
+        else set_error(3, "unknown failure");
+      }
+      return ret;
+    }
+    return invalid_configuration();
+  }
+
   int invalid_configuration() {
     return set_error(1, "invalid configuration");
   }
+  int invalid_byte_order(std::string const& name) {
+    return set_error(4, "invalid byte order " + name + ", expected native, little, or big");
+  }
+  int invalid_records() {
+    return set_error(5, "posix:record_size must be positive and no larger than posix:record_stride");
+  }
+  int invalid_byte_count(std::string const& key) {
+    return set_error(6, key + " must be a non-negative integer of at most 2^53");
+  }
 
   compat::optional<std::string> path;
   compat::optional<FILE*> file_ptr;
   compat::optional<int> fd;
+  uint64_t offset = 0;
+  uint64_t record_size = 0;
+  uint64_t record_stride = 0;
+  std::string byte_order = "native";
+  libpressio::byteswap::byte_order order = libpressio::byteswap::byte_order::native;
 };
 
 static pressio_register X(io_plugins(), "posix", [](){ return compat::make_unique<posix_io>(); });
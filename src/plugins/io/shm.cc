@@ -0,0 +1,406 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <vector>
+#include "pressio_data.h"
+#include "pressio_compressor.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/io.h"
+
+namespace {
+  constexpr uint64_t shm_magic = 0x6f69737365727070; /* "pressio" */
+  constexpr size_t shm_max_dims = 8;
+  constexpr size_t shm_alignment = 64;
+  constexpr size_t bytes_per_mb = 1024 * 1024;
+
+  enum shm_slot_state : uint32_t {
+    shm_slot_empty,
+    shm_slot_writing,
+    shm_slot_full,
+    shm_slot_reading,
+  };
+
+  /**
+   * placed at the start of the shared memory segment
+   *
+   * the mutex and condition variable are process-shared; on Linux these are implemented with futexes.
+   * The mutex is robust so a process which dies while holding it does not block its peers forever
+   */
+  struct shm_header {
+    uint64_t magic;
+    uint64_t num_slots;
+    uint64_t slot_bytes;
+    uint64_t write_index;
+    uint64_t read_index;
+    /* the number of mappings of the segment; the last to detach removes its name.
+     * It is updated atomically without the lock, so a process holding the lock is always counted */
+    uint64_t attached;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+  };
+
+  /**
+   * describes the buffer in a slot; the payload follows it at the next aligned offset
+   */
+  struct shm_slot {
+    uint32_t state;
+    int32_t dtype;
+    uint64_t num_dims;
+    uint64_t dims[shm_max_dims];
+    uint64_t bytes;
+  };
+
+  size_t align_up(size_t size) {
+    return (size + shm_alignment - 1) / shm_alignment * shm_alignment;
+  }
+
+  /**
+   * a mapping of the shared memory segment; held by the plugin and by every buffer returned from read
+   */
+  class shm_segment {
+    public:
+    static std::shared_ptr<shm_segment> open(std::string const& name, bool create, size_t num_slots, size_t slot_bytes, std::string& error) {
+      int flags = O_RDWR | (create ? (O_CREAT | O_EXCL) : 0);
+      int fd = shm_open(name.c_str(), flags, 0600);
+      if(fd == -1 && create && errno == EEXIST) {
+        //a previous run may not have cleaned up; only a segment nobody else has mapped is replaced
+        std::string ignored;
+        if(auto existing = open(name, false, 0, 0, ignored)) {
+          if(existing->attached() > 1) {
+            error = "a segment with this name already exists and is in use; if no process uses it, remove it with shm_unlink";
+            return nullptr;
+          }
+        }
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), flags, 0600);
+      }
+      if(fd == -1) {
+        error = strerror(errno);
+        return nullptr;
+      }
+
+      size_t length;
+      if(create) {
+        length = segment_size(num_slots, slot_bytes);
+        if(ftruncate(fd, length) == -1) {
+          error = strerror(errno);
+          close(fd);
+          shm_unlink(name.c_str());
+          return nullptr;
+        }
+      } else {
+        struct stat statbuf;
+        if(fstat(fd, &statbuf) == -1) {
+          error = strerror(errno);
+          close(fd);
+          return nullptr;
+        }
+        length = statbuf.st_size;
+        if(length < sizeof(shm_header)) {
+          error = "segment has not been initialized";
+          close(fd);
+          return nullptr;
+        }
+      }
+
+      void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if(base == MAP_FAILED) {
+        error = strerror(errno);
+        if(create) shm_unlink(name.c_str());
+        return nullptr;
+      }
+
+      auto h = static_cast<shm_header*>(base);
+      if(not create && (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != shm_magic || length < segment_size(h->num_slots, h->slot_bytes))) {
+        error = "segment has not been initialized";
+        munmap(base, length);
+        return nullptr;
+      }
+      auto segment = std::shared_ptr<shm_segment>(new shm_segment(name, base, length));
+      if(create) {
+        segment->initialize(num_slots, slot_bytes);
+      } else {
+        __atomic_add_fetch(&h->attached, 1, __ATOMIC_ACQ_REL);
+      }
+      return segment;
+    }
+
+    /*
+     * the mutex and condition variable are not destroyed since peers may still
+     * use them; they go away with the last mapping of the segment
+     */
+    ~shm_segment() {
+      const bool last = __atomic_sub_fetch(&header()->attached, 1, __ATOMIC_ACQ_REL) == 0;
+      munmap(base, length);
+      if(last) shm_unlink(name.c_str());
+    }
+
+    uint64_t attached() const {
+      return __atomic_load_n(&header()->attached, __ATOMIC_ACQUIRE);
+    }
+
+    shm_header* header() const { return static_cast<shm_header*>(base); }
+
+    shm_slot* slot(uint64_t index) const {
+      return reinterpret_cast<shm_slot*>(static_cast<uint8_t*>(base) + slot_offset(index));
+    }
+
+    void* payload(uint64_t index) const {
+      return static_cast<uint8_t*>(base) + slot_offset(index) + align_up(sizeof(shm_slot));
+    }
+
+    /**
+     * waits until pred() holds with the lock held
+     * \returns 0 on success, ETIMEDOUT if the timeout expired first
+     */
+    template <class Predicate>
+    int wait_for(Predicate&& pred, unsigned int timeout_ms) {
+      timespec deadline;
+      if(timeout_ms != 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += static_cast<long>(timeout_ms % 1000) * 1000000;
+        if(deadline.tv_nsec >= 1000000000) {
+          deadline.tv_sec += 1;
+          deadline.tv_nsec -= 1000000000;
+        }
+      }
+      while(not pred()) {
+        int rc = (timeout_ms == 0) ?
+          pthread_cond_wait(&header()->changed, &header()->lock):
+          pthread_cond_timedwait(&header()->changed, &header()->lock, &deadline);
+        if(rc == EOWNERDEAD) recover();
+        else if(rc == ETIMEDOUT) return rc;
+      }
+      return 0;
+    }
+
+    void lock() {
+      if(pthread_mutex_lock(&header()->lock) == EOWNERDEAD) recover();
+    }
+    void unlock() { pthread_mutex_unlock(&header()->lock); }
+    void notify() { pthread_cond_broadcast(&header()->changed); }
+
+    private:
+    shm_segment(std::string const& name, void* base, size_t length):
+      name(name), base(base), length(length) {}
+
+    static size_t slot_stride(size_t slot_bytes) {
+      return align_up(sizeof(shm_slot)) + align_up(slot_bytes);
+    }
+    static size_t segment_size(size_t num_slots, size_t slot_bytes) {
+      return align_up(sizeof(shm_header)) + num_slots * slot_stride(slot_bytes);
+    }
+    /*
+     * called with the lock held when its previous owner died while holding it;
+     * releases the dead process's mapping and makes the lock usable again.
+     * Slots the dead process was reading or writing stay reserved
+     */
+    void recover() {
+      __atomic_sub_fetch(&header()->attached, 1, __ATOMIC_ACQ_REL);
+      pthread_mutex_consistent(&header()->lock);
+    }
+    size_t slot_offset(uint64_t index) const {
+      return align_up(sizeof(shm_header)) + (index % header()->num_slots) * slot_stride(header()->slot_bytes);
+    }
+
+    void initialize(size_t num_slots, size_t slot_bytes) {
+      shm_header* h = header();
+      h->num_slots = num_slots;
+      h->slot_bytes = slot_bytes;
+      h->write_index = 0;
+      h->read_index = 0;
+      h->attached = 1;
+
+      pthread_mutexattr_t mutex_attr;
+      pthread_mutexattr_init(&mutex_attr);
+      pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+      pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+      pthread_mutex_init(&h->lock, &mutex_attr);
+      pthread_mutexattr_destroy(&mutex_attr);
+
+      pthread_condattr_t cond_attr;
+      pthread_condattr_init(&cond_attr);
+      pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+      pthread_cond_init(&h->changed, &cond_attr);
+      pthread_condattr_destroy(&cond_attr);
+
+      for (size_t i = 0; i < num_slots; ++i) {
+        slot(i)->state = shm_slot_empty;
+      }
+      __atomic_store_n(&h->magic, shm_magic, __ATOMIC_RELEASE);
+    }
+
+    std::string name;
+    void* base;
+    size_t length;
+  };
+
+  /**
+   * metadata for buffers returned by read; frees the slot for the writer when the buffer is freed
+   */
+  struct shm_slot_ref {
+    std::shared_ptr<shm_segment> segment;
+    uint64_t index;
+  };
+
+  void shm_release_slot(void*, void* metadata) {
+    auto ref = static_cast<shm_slot_ref*>(metadata);
+    ref->segment->lock();
+    ref->segment->slot(ref->index)->state = shm_slot_empty;
+    ref->segment->notify();
+    ref->segment->unlock();
+    delete ref;
+  }
+}
+
+struct shm_io : public libpressio_io_plugin {
+  virtual struct pressio_data* read_impl(struct pressio_data* data) override {
+    if(data != nullptr) pressio_data_free(data);
+    if(connect()) return nullptr;
+
+    //the index is re-read after each wake up since another reader may have claimed the slot
+    segment->lock();
+    shm_header* header = segment->header();
+    auto& ring = *segment;
+    if(segment->wait_for([header, &ring]{ return ring.slot(header->read_index)->state == shm_slot_full; }, timeout_ms)) {
+      segment->unlock();
+      timed_out();
+      return nullptr;
+    }
+    const uint64_t index = header->read_index++;
+    shm_slot* slot = segment->slot(index);
+    slot->state = shm_slot_reading;
+    segment->unlock();
+
+    //the returned buffer refers directly to the slot, which stays reserved until it is freed
+    std::vector<size_t> dims(slot->dims, slot->dims + slot->num_dims);
+    return pressio_data_new_move(
+        static_cast<pressio_dtype>(slot->dtype),
+        segment->payload(index),
+        dims.size(),
+        dims.data(),
+        shm_release_slot,
+        new shm_slot_ref{segment, index}
+        );
+  }
+
+  virtual int write_impl(struct pressio_data const* data) override{
+    if(int rc = connect()) return rc;
+    if(data->num_dimensions() > shm_max_dims) return too_many_dims(data->num_dimensions());
+    if(data->size_in_bytes() > segment->header()->slot_bytes) return too_large(data->size_in_bytes());
+
+    //the index is re-read after each wake up since another writer may have claimed the slot
+    segment->lock();
+    shm_header* header = segment->header();
+    auto& ring = *segment;
+    if(segment->wait_for([header, &ring]{ return ring.slot(header->write_index)->state == shm_slot_empty; }, timeout_ms)) {
+      segment->unlock();
+      return timed_out();
+    }
+    const uint64_t index = header->write_index++;
+    shm_slot* slot = segment->slot(index);
+    slot->state = shm_slot_writing;
+    segment->unlock();
+
+    slot->dtype = data->dtype();
+    slot->num_dims = data->num_dimensions();
+    for (size_t i = 0; i < data->num_dimensions(); ++i) {
+      slot->dims[i] = data->get_dimension(i);
+    }
+    slot->bytes = data->size_in_bytes();
+    if(slot->bytes) memcpy(segment->payload(index), data->data(), slot->bytes);
+
+    segment->lock();
+    slot->state = shm_slot_full;
+    segment->notify();
+    segment->unlock();
+    return 0;
+  }
+
+  virtual struct pressio_options get_configuration_impl() const override{
+    return {
+      {"pressio:thread_safe",  static_cast<int>(pressio_thread_safety_multiple)}
+    };
+  }
+
+  virtual int set_options_impl(struct pressio_options const& opts) override{
+    auto old_name = name;
+    auto old_create = create;
+    auto old_slots = num_slots;
+    auto old_slot_size = slot_size_mb;
+    opts.get("io:path", &name);
+    opts.get("shm:create", &create);
+    opts.get("shm:slots", &num_slots);
+    opts.get("shm:slot_size_mb", &slot_size_mb);
+    opts.get("shm:timeout_ms", &timeout_ms);
+
+    if(old_name != name || old_create != create || old_slots != num_slots || old_slot_size != slot_size_mb) {
+      segment.reset();
+    }
+    return 0;
+  }
+  virtual struct pressio_options get_options_impl() const override{
+    return {
+      {"io:path", name},
+      {"shm:create", create},
+      {"shm:slots", num_slots},
+      {"shm:slot_size_mb", slot_size_mb},
+      {"shm:timeout_ms", timeout_ms},
+    };
+  }
+
+  int patch_version() const override{
+    return 1;
+  }
+  virtual const char* version() const override{
+    return "0.0.1";
+  }
+
+  std::shared_ptr<libpressio_io_plugin> clone() override {
+    return compat::make_unique<shm_io>(*this);
+  }
+
+  private:
+  int connect() {
+    if(segment) return 0;
+    if(name.empty()) return set_error(1, "io:path must be set to name the shared memory segment");
+    if(create && (num_slots == 0 || slot_size_mb == 0)) return set_error(2, "shm:slots and shm:slot_size_mb must be positive");
+    std::string error;
+    segment = shm_segment::open(name, create != 0, num_slots, static_cast<size_t>(slot_size_mb) * bytes_per_mb, error);
+    if(not segment) return set_error(3, "failed to open " + name + ": " + error);
+    return 0;
+  }
+  int timed_out() { return set_error(4, "timed out waiting for the ring buffer"); }
+  int too_large(size_t bytes) {
+    std::stringstream ss;
+    ss << "buffer of " << bytes << " bytes exceeds the slot size";
+    return set_error(5, ss.str());
+  }
+  int too_many_dims(size_t dims) {
+    std::stringstream ss;
+    ss << "buffers with " << dims << " dimensions are not supported, the maximum is " << shm_max_dims;
+    return set_error(6, ss.str());
+  }
+
+  std::string name;
+  int create = 0;
+  unsigned int num_slots = 4;
+  unsigned int slot_size_mb = 64;
+  unsigned int timeout_ms = 0;
+  std::shared_ptr<shm_segment> segment;
+};
+
+static pressio_register X(io_plugins(), "shm", [](){ return compat::make_unique<shm_io>(); });
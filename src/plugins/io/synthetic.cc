@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include "pressio_data.h"
+#include "pressio_compressor.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/io.h"
+#include "libpressio_ext/cpp/thread_pool.h"
+
+namespace {
+  constexpr double pi = 3.14159265358979323846;
+
+  /*
+   * counter based random numbers: each value depends only on the seed, a
+   * stream id, and the index of the element, so the output does not depend on
+   * the number of threads used to generate it
+   */
+  uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+  double uniform(uint64_t seed, uint64_t stream, uint64_t index) {
+    uint64_t bits = splitmix64(splitmix64(splitmix64(seed) ^ stream) ^ index);
+    return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  double normal(uint64_t seed, uint64_t stream, uint64_t index) {
+    double u1 = uniform(seed, stream, 2 * index);
+    double u2 = uniform(seed, stream, 2 * index + 1);
+    return std::sqrt(-2.0 * std::log(1.0 - u1)) * std::cos(2.0 * pi * u2);
+  }
+
+  enum class synthetic_kind {
+    gaussian,
+    analytic,
+    sparse,
+    labels,
+  };
+
+  bool parse_kind(std::string const& name, synthetic_kind& kind) {
+    if(name == "gaussian") kind = synthetic_kind::gaussian;
+    else if(name == "analytic") kind = synthetic_kind::analytic;
+    else if(name == "sparse") kind = synthetic_kind::sparse;
+    else if(name == "labels") kind = synthetic_kind::labels;
+    else return false;
+    return true;
+  }
+
+  enum streams : uint64_t {
+    mode_stream = 1,
+    noise_stream,
+    sparse_stream,
+    label_stream,
+  };
+
+  struct synthetic_params {
+    synthetic_kind kind = synthetic_kind::gaussian;
+    unsigned int seed = 0;
+    unsigned int modes = 64;
+    double slope = 3.0;
+    double noise = 0.0;
+    double density = 0.1;
+    double fill_value = 0.0;
+    unsigned int labels = 16;
+    double scale = 1.0;
+    double offset = 0.0;
+  };
+
+  /**
+   * evaluates a synthetic field at normalized coordinates in [0,1)^d
+   */
+  class synthetic_field {
+    public:
+    synthetic_field(synthetic_params const& params, size_t ndims): params(params), ndims(ndims) {
+      switch(params.kind) {
+        case synthetic_kind::gaussian:
+          make_modes();
+          break;
+        case synthetic_kind::labels:
+          make_sites();
+          break;
+        default:
+          break;
+      }
+    }
+
+    double operator()(uint64_t index, double const* x) const {
+      switch(params.kind) {
+        case synthetic_kind::gaussian:
+          return gaussian(x);
+        case synthetic_kind::analytic:
+          return analytic(x) + params.noise * normal(params.seed, noise_stream, index);
+        case synthetic_kind::sparse:
+          if(uniform(params.seed, sparse_stream, index) < params.density) {
+            return analytic(x) + params.noise * normal(params.seed, noise_stream, index);
+          }
+          return params.fill_value;
+        case synthetic_kind::labels:
+        default:
+          return static_cast<double>(nearest_site(x));
+      }
+    }
+
+    /** \returns true if the value of the element is not affected by scale and offset */
+    bool is_fill(double value) const {
+      return params.kind == synthetic_kind::sparse && value == params.fill_value;
+    }
+
+    private:
+    /*
+     * a gaussian random field approximated by a sum of random fourier modes
+     * whose wave numbers are drawn log-uniformly between 1 and 64 cycles per
+     * domain.  Weighting each mode by k^((d-slope)/2) gives a power spectrum
+     * proportional to k^-slope
+     */
+    void make_modes() {
+      const double kmax = 64.0;
+      double total_power = 0;
+      uint64_t counter = 0;
+      for (unsigned int m = 0; m < params.modes; ++m) {
+        const double k = std::exp(uniform(params.seed, mode_stream, counter++) * std::log(kmax));
+        std::vector<double> direction(ndims);
+        double norm = 0;
+        for (auto& d : direction) {
+          d = normal(params.seed, mode_stream, counter++);
+          norm += d * d;
+        }
+        norm = std::sqrt(norm);
+        for (auto& d : direction) d = (norm > 0) ? 2.0 * pi * k * d / norm : 0.0;
+
+        const double amplitude = std::pow(k, (static_cast<double>(ndims) - params.slope) / 2.0);
+        total_power += amplitude * amplitude / 2.0;
+        wave_vectors.insert(wave_vectors.end(), direction.begin(), direction.end());
+        amplitudes.push_back(amplitude);
+        phases.push_back(2.0 * pi * uniform(params.seed, mode_stream, counter++));
+      }
+      //normalize to unit variance
+      const double normalization = (total_power > 0) ? 1.0 / std::sqrt(total_power) : 0.0;
+      for (auto& a : amplitudes) a *= normalization;
+    }
+
+    double gaussian(double const* x) const {
+      double value = 0;
+      for (size_t m = 0; m < amplitudes.size(); ++m) {
+        double phase = phases[m];
+        for (size_t d = 0; d < ndims; ++d) {
+          phase += wave_vectors[m * ndims + d] * x[d];
+        }
+        value += amplitudes[m] * std::cos(phase);
+      }
+      return value;
+    }
+
+    /*
+     * a smooth function with features at a few different scales
+     */
+    double analytic(double const* x) const {
+      double value = 0;
+      double r2 = 0;
+      for (size_t d = 0; d < ndims; ++d) {
+        value += std::sin(2.0 * pi * (d + 1) * x[d] + d);
+        r2 += (x[d] - 0.5) * (x[d] - 0.5);
+      }
+      return value + 2.0 * std::exp(-r2 / 0.02);
+    }
+
+    /*
+     * integer label maps are voronoi diagrams of randomly placed sites
+     */
+    void make_sites() {
+      uint64_t counter = 0;
+      for (unsigned int l = 0; l < std::max(1u, params.labels); ++l) {
+        for (size_t d = 0; d < ndims; ++d) {
+          sites.push_back(uniform(params.seed, label_stream, counter++));
+        }
+      }
+    }
+
+    size_t nearest_site(double const* x) const {
+      size_t nearest = 0;
+      double nearest_distance = std::numeric_limits<double>::max();
+      const size_t nsites = sites.size() / std::max<size_t>(1, ndims);
+      for (size_t s = 0; s < nsites; ++s) {
+        double distance = 0;
+        for (size_t d = 0; d < ndims; ++d) {
+          const double delta = sites[s * ndims + d] - x[d];
+          distance += delta * delta;
+        }
+        if(distance < nearest_distance) {
+          nearest_distance = distance;
+          nearest = s;
+        }
+      }
+      return nearest;
+    }
+
+    synthetic_params params;
+    size_t ndims;
+    std::vector<double> wave_vectors;
+    std::vector<double> amplitudes;
+    std::vector<double> phases;
+    std::vector<double> sites;
+  };
+
+  template <class T>
+  typename std::enable_if<std::is_integral<T>::value, T>::type saturate(double value) {
+    if(std::isnan(value)) return 0;
+    value = std::nearbyint(value);
+    if(value <= static_cast<double>(std::numeric_limits<T>::lowest())) return std::numeric_limits<T>::lowest();
+    if(value >= static_cast<double>(std::numeric_limits<T>::max())) return std::numeric_limits<T>::max();
+    return static_cast<T>(value);
+  }
+
+  template <class T>
+  typename std::enable_if<!std::is_integral<T>::value, T>::type saturate(double value) {
+    return static_cast<T>(value);
+  }
+
+  /*
+   * fills the region of count elements starting at start of a field with dimensions dims
+   */
+  struct fill_field {
+    template <class T>
+    int operator()(T* begin, T* end) {
+      const size_t total = static_cast<size_t>(end - begin);
+      auto fill_range = [&](size_t first, size_t last) {
+        std::vector<double> x(dims.size());
+        for (size_t i = first; i < last; ++i) {
+          //dims[0] is the fastest varying dimension
+          size_t remainder = i;
+          size_t index = 0;
+          size_t stride = 1;
+          for (size_t d = 0; d < dims.size(); ++d) {
+            const size_t coordinate = start[d] + remainder % count[d];
+            remainder /= count[d];
+            x[d] = static_cast<double>(coordinate) / static_cast<double>(dims[d]);
+            index += coordinate * stride;
+            stride *= dims[d];
+          }
+          double value = field(index, x.data());
+          if(!field.is_fill(value)) value = offset + scale * value;
+          begin[i] = saturate<T>(value);
+        }
+      };
+
+      //a non-zero nthreads limits the parallelism by limiting the number of tasks
+      const size_t grain = (nthreads == 0) ? min_elements_per_task : std::max(min_elements_per_task, (total + nthreads - 1) / nthreads);
+      pressio_thread_pool::global().parallel_for(0, total, grain, fill_range);
+      return 0;
+    }
+
+    synthetic_field const& field;
+    std::vector<size_t> const& dims;
+    std::vector<size_t> const& start;
+    std::vector<size_t> const& count;
+    size_t nthreads;
+    double scale;
+    double offset;
+    static constexpr size_t min_elements_per_task = 1 << 14;
+  };
+  constexpr size_t fill_field::min_elements_per_task;
+}
+
+struct synthetic_io : public libpressio_io_plugin {
+  virtual struct pressio_data* read_impl(struct pressio_data* data) override {
+    if(data == nullptr) {
+      missing_dims();
+      return nullptr;
+    }
+    if(lazy) {
+      auto dtype = data->dtype();
+      auto dims = data->dimensions();
+      //the generator may outlive the plugin, so it captures copies of the parameters
+      auto field = std::make_shared<synthetic_field>(params, dims.size());
+      const size_t threads = nthreads;
+      const double scale = params.scale;
+      const double offset = params.offset;
+      *data = pressio_data::lazy(dtype, dims, [=](std::vector<size_t> const& start, std::vector<size_t> const& count, void* out) {
+          auto region = pressio_data::nonowning(dtype, out, count);
+          return pressio_data_for_each<int>(region, fill_field{*field, dims, start, count, threads, scale, offset});
+      });
+      return data;
+    }
+    if(not data->has_data()) {
+      auto dtype = data->dtype();
+      auto dims = data->dimensions();
+      pressio_data_free(data);
+      data = pressio_data_new_owning(dtype, dims.size(), dims.data());
+    }
+
+    const auto dims = data->dimensions();
+    const std::vector<size_t> start(dims.size(), 0);
+    synthetic_field field(params, dims.size());
+    pressio_data_for_each<int>(*data, fill_field{field, dims, start, dims, nthreads, params.scale, params.offset});
+    return data;
+  }
+
+  virtual int write_impl(struct pressio_data const*) override{
+    return set_error(1, "the synthetic io module does not support writing");
+  }
+
+  virtual struct pressio_options get_configuration_impl() const override{
+    return {
+      {"pressio:thread_safe",  static_cast<int>(pressio_thread_safety_multiple)}
+    };
+  }
+
+  virtual int set_options_impl(struct pressio_options const& opts) override{
+    std::string kind_name;
+    if(opts.get("synthetic:kind", &kind_name) == pressio_options_key_set) {
+      if(not parse_kind(kind_name, params.kind)) return invalid_kind(kind_name);
+      kind = kind_name;
+    }
+    opts.get("synthetic:seed", &params.seed);
+    opts.get("synthetic:modes", &params.modes);
+    opts.get("synthetic:slope", &params.slope);
+    opts.get("synthetic:noise", &params.noise);
+    opts.get("synthetic:density", &params.density);
+    opts.get("synthetic:fill_value", &params.fill_value);
+    opts.get("synthetic:labels", &params.labels);
+    opts.get("synthetic:scale", &params.scale);
+    opts.get("synthetic:offset", &params.offset);
+    opts.get("synthetic:nthreads", &nthreads);
+    opts.get("synthetic:lazy", &lazy);
+    return 0;
+  }
+  virtual struct pressio_options get_options_impl() const override{
+    return {
+      {"synthetic:kind", kind},
+      {"synthetic:seed", params.seed},
+      {"synthetic:modes", params.modes},
+      {"synthetic:slope", params.slope},
+      {"synthetic:noise", params.noise},
+      {"synthetic:density", params.density},
+      {"synthetic:fill_value", params.fill_value},
+      {"synthetic:labels", params.labels},
+      {"synthetic:scale", params.scale},
+      {"synthetic:offset", params.offset},
+      {"synthetic:nthreads", nthreads},
+      {"synthetic:lazy", lazy},
+    };
+  }
+
+  int patch_version() const override{
+    return 2;
+  }
+  virtual const char* version() const override{
+    return "0.0.2";
+  }
+
+  std::shared_ptr<libpressio_io_plugin> clone() override {
+    return compat::make_unique<synthetic_io>(*this);
+  }
+
+  private:
+  int missing_dims() { return set_error(2, "the dtype and dimensions must be provided to read synthetic data"); }
+  int invalid_kind(std::string const& name) {
+    return set_error(3, "invalid kind " + name + ", expected gaussian, analytic, sparse, or labels");
+  }
+
+  std::string kind = "gaussian";
+  synthetic_params params;
+  unsigned int nthreads = 0;
+  int lazy = 0;
+};
+
+static pressio_register X(io_plugins(), "synthetic", [](){ return compat::make_unique<synthetic_io>(); });
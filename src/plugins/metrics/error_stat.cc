@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cmath>
+#include <vector>
 #include "pressio_data.h"
 #include "pressio_options.h"
 #include "libpressio_ext/cpp/data.h"
@@ -8,6 +10,8 @@
 #include "libpressio_ext/compat/std_compat.h"
 
 namespace {
+  constexpr size_t min_elements_per_slab = 1 << 20;
+
   struct error_metrics {
     double psnr;
     double mse;
@@ -27,45 +31,25 @@ namespace {
     double value_mean;
   };
 
-  struct compute_metrics{
-    template <class ForwardIt1, class ForwardIt2>
-    error_metrics operator()(ForwardIt1 input_begin, ForwardIt1 input_end, ForwardIt2 input2_begin)
-    {
-      using value_type = typename std::iterator_traits<ForwardIt1>::value_type;
-      static_assert(std::is_same<typename std::iterator_traits<ForwardIt1>::value_type, value_type>::value, "the iterators must have the same type");
-      double sum_of_squared_error = 0;
-      double sum_of_difference = 0;
-      double sum_of_error = 0;
-      double sum_of_values_squared =0;
-      double sum = 0;
-      size_t num_elements = 0;
-      auto value_min = *input_begin; 
-      auto value_max = *input_begin;
-      auto diff_min = *input_begin - *input2_begin;
-      auto diff_max = diff_min;
-      auto error_min = std::abs(double(*input_begin) - double(*input2_begin));
-      auto error_max = std::abs(double(diff_min));
-      while(input_begin != input_end) {
-        auto diff = *input_begin - *input2_begin;
-        auto error = std::abs(double(diff));
-        auto squared_error = error*error;
-
-        sum += *input_begin;
-        sum_of_values_squared += (*input_begin * *input_begin);
-        sum_of_difference += diff;
-        sum_of_error += error;
-        sum_of_squared_error += squared_error;
-        value_min = std::min(value_min, *input_begin);
-        value_max = std::max(value_max, *input_begin);
-        diff_min = std::min(diff, diff_min);
-        diff_max = std::max(diff, diff_max);
-        error_max = std::max(error, error_max);
-        error_min = std::min(error, error_min);
-        ++num_elements;
-
-        ++input_begin;
-        ++input2_begin;
-      }
+  /*
+   * the running sums of the error statistics; they are kept in double
+   * precision so the data can be compared one slab at a time
+   */
+  struct error_accumulator {
+    double sum_of_squared_error = 0;
+    double sum_of_difference = 0;
+    double sum_of_error = 0;
+    double sum_of_values_squared =0;
+    double sum = 0;
+    size_t num_elements = 0;
+    double value_min = 0;
+    double value_max = 0;
+    double diff_min = 0;
+    double diff_max = 0;
+    double error_min = 0;
+    double error_max = 0;
+
+    error_metrics finish() const {
       error_metrics m;
       m.mse = sum_of_squared_error/num_elements;
       m.rmse = sqrt(m.mse);
@@ -91,6 +75,79 @@ namespace {
       return m;
     }
   };
+
+  struct compute_metrics{
+    template <class ForwardIt1, class ForwardIt2>
+    int operator()(ForwardIt1 input_begin, ForwardIt1 input_end, ForwardIt2 input2_begin)
+    {
+      using value_type = typename std::iterator_traits<ForwardIt1>::value_type;
+      static_assert(std::is_same<typename std::iterator_traits<ForwardIt1>::value_type, value_type>::value, "the iterators must have the same type");
+      if(input_begin == input_end) return 0;
+      if(acc.num_elements == 0) {
+        acc.value_min = *input_begin;
+        acc.value_max = *input_begin;
+        acc.diff_min = *input_begin - *input2_begin;
+        acc.diff_max = acc.diff_min;
+        acc.error_min = std::abs(double(*input_begin) - double(*input2_begin));
+        acc.error_max = std::abs(acc.diff_min);
+      }
+      while(input_begin != input_end) {
+        auto diff = *input_begin - *input2_begin;
+        auto error = std::abs(double(diff));
+        auto squared_error = error*error;
+
+        acc.sum += *input_begin;
+        acc.sum_of_values_squared += (*input_begin * *input_begin);
+        acc.sum_of_difference += diff;
+        acc.sum_of_error += error;
+        acc.sum_of_squared_error += squared_error;
+        acc.value_min = std::min<double>(acc.value_min, *input_begin);
+        acc.value_max = std::max<double>(acc.value_max, *input_begin);
+        acc.diff_min = std::min<double>(diff, acc.diff_min);
+        acc.diff_max = std::max<double>(diff, acc.diff_max);
+        acc.error_max = std::max(error, acc.error_max);
+        acc.error_min = std::min(error, acc.error_min);
+        ++acc.num_elements;
+
+        ++input_begin;
+        ++input2_begin;
+      }
+      return 0;
+    }
+
+    error_accumulator& acc;
+  };
+
+  /*
+   * lazy inputs are produced one slab of the slowest dimension at a time
+   * rather than in full
+   */
+  error_metrics compare(pressio_data const& input, pressio_data const& output) {
+    error_accumulator acc;
+    if(!input.is_lazy() || input.num_dimensions() == 0) {
+      pressio_data_for_each<int>(input, output, compute_metrics{acc});
+      return acc.finish();
+    }
+
+    auto dims = input.dimensions();
+    const size_t last = dims.size() - 1;
+    const size_t plane = input.num_elements() / std::max<size_t>(1, dims[last]);
+    const size_t slab = std::max<size_t>(1, min_elements_per_slab / std::max<size_t>(1, plane));
+    const size_t output_element_size = pressio_dtype_size(output.dtype());
+    auto output_ptr = static_cast<unsigned char*>(output.data());
+
+    std::vector<size_t> start(dims.size(), 0);
+    for (size_t first = 0; first < dims[last]; first += slab) {
+      std::vector<size_t> count = dims;
+      count[last] = std::min(slab, dims[last] - first);
+      start[last] = first;
+      auto input_slab = pressio_data::owning(input.dtype(), count);
+      if(input.read_region(start, count, input_slab.data()) != 0) break;
+      auto output_slab = pressio_data::nonowning(output.dtype(), output_ptr + first * plane * output_element_size, count);
+      pressio_data_for_each<int>(input_slab, output_slab, compute_metrics{acc});
+    }
+    return acc.finish();
+  }
 }
 
 class error_stat_plugin : public libpressio_metrics_plugin {
@@ -100,7 +157,7 @@ class error_stat_plugin : public libpressio_metrics_plugin {
       input_data = pressio_data::clone(*input);
     }
     void end_decompress(struct pressio_data const*, struct pressio_data const* output, int ) override {
-      err_metrics = pressio_data_for_each<error_metrics>(input_data, *output, compute_metrics{});      
+      err_metrics = compare(input_data, *output);
     }
 
     struct pressio_options get_metrics_results() const override {
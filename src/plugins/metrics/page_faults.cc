@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sys/resource.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "pressio_data.h"
+#include "pressio_options.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/compat/std_compat.h"
+
+namespace {
+  unsigned int saturate(uint64_t value) {
+    return static_cast<unsigned int>(std::min<uint64_t>(value, UINT32_MAX));
+  }
+
+  /*
+   * counts data TLB load misses of the thread which calls start until stop;
+   * the event is opened by start so that it follows whichever thread runs the
+   * compressor and no descriptor is held between calls.  The count is
+   * unavailable when perf events are restricted.
+   */
+  class tlb_counter {
+    public:
+    tlb_counter()=default;
+    ~tlb_counter() {
+      close_event();
+    }
+    tlb_counter(tlb_counter const&)=delete;
+    tlb_counter& operator=(tlb_counter const&)=delete;
+
+    void start() {
+#if defined(__linux__)
+      close_event();
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      //pid 0 with any cpu counts the calling thread wherever it runs
+      fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    compat::optional<unsigned int> stop() {
+#if defined(__linux__)
+      if(fd < 0) return {};
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t count = 0;
+      const bool counted = read(fd, &count, sizeof(count)) == sizeof(count);
+      close_event();
+      if(!counted) return {};
+      return saturate(count);
+#else
+      return {};
+#endif
+    }
+
+    private:
+    void close_event() {
+#if defined(__linux__)
+      if(fd >= 0) close(fd);
+      fd = -1;
+#endif
+    }
+
+    int fd = -1;
+  };
+
+  struct fault_counts {
+    compat::optional<unsigned int> minor_faults;
+    compat::optional<unsigned int> major_faults;
+    compat::optional<unsigned int> dtlb_load_misses;
+  };
+
+  /*
+   * page faults are counted for the whole process so faults taken by the
+   * threads of the shared thread pool are included
+   */
+  struct fault_range {
+    void begin() {
+      getrusage(RUSAGE_SELF, &start);
+      tlb.start();
+    }
+
+    fault_counts end() {
+      fault_counts counts;
+      counts.dtlb_load_misses = tlb.stop();
+      rusage stop;
+      getrusage(RUSAGE_SELF, &stop);
+      counts.minor_faults = saturate(stop.ru_minflt - start.ru_minflt);
+      counts.major_faults = saturate(stop.ru_majflt - start.ru_majflt);
+      return counts;
+    }
+
+    rusage start;
+    tlb_counter tlb;
+  };
+}
+
+/**
+ * records the page faults and TLB misses taken while compressing and decompressing
+ */
+class page_faults_plugin : public libpressio_metrics_plugin {
+  public:
+
+  void begin_compress(const struct pressio_data *, struct pressio_data const *) override {
+    compress_range.begin();
+  }
+
+  void end_compress(struct pressio_data const*, pressio_data const*, int) override {
+    compress = compress_range.end();
+  }
+
+  void begin_decompress(struct pressio_data const*, pressio_data const*) override {
+    decompress_range.begin();
+  }
+
+  void end_decompress(struct pressio_data const*, pressio_data const*, int) override {
+    decompress = decompress_range.end();
+  }
+
+  struct pressio_options get_metrics_results() const override {
+    pressio_options opt;
+
+    auto set_or = [&opt](std::string const& key, compat::optional<unsigned int> const& value) {
+      if(value) opt.set(key, *value);
+      else opt.set_type(key, pressio_option_uint32_type);
+    };
+    auto set_counts = [&set_or](std::string const& prefix, fault_counts const& counts) {
+      set_or(prefix + ":minor_faults", counts.minor_faults);
+      set_or(prefix + ":major_faults", counts.major_faults);
+      set_or(prefix + ":dtlb_load_misses", counts.dtlb_load_misses);
+    };
+
+    set_counts("page_faults:compress", compress);
+    set_counts("page_faults:decompress", decompress);
+
+    return opt;
+  }
+
+  std::unique_ptr<libpressio_metrics_plugin> clone() override {
+    auto copy = compat::make_unique<page_faults_plugin>();
+    copy->compress = compress;
+    copy->decompress = decompress;
+    return copy;
+  }
+
+  private:
+    fault_range compress_range;
+    fault_range decompress_range;
+    fault_counts compress;
+    fault_counts decompress;
+};
+
+static pressio_register X(metrics_plugins(), "page_faults", [](){ return compat::make_unique<page_faults_plugin>(); });
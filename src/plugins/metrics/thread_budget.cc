@@ -0,0 +1,66 @@
+#include "pressio_data.h"
+#include "pressio_options.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/thread_pool.h"
+#include "libpressio_ext/compat/std_compat.h"
+
+namespace {
+  struct allocation {
+    unsigned int total;
+    unsigned int outer;
+    unsigned int inner;
+  };
+
+  allocation current_allocation() {
+    auto const& budget = pressio_thread_budget::global();
+    return {budget.total_threads(), budget.outer(), budget.enabled() ? budget.inner_threads() : 0};
+  }
+}
+
+/**
+ * records how the thread budget was divided when the last compression and decompression began
+ */
+class thread_budget_plugin : public libpressio_metrics_plugin {
+  public:
+
+    void begin_compress(const struct pressio_data *, struct pressio_data const *) override {
+      compress = current_allocation();
+    }
+
+    void begin_decompress(struct pressio_data const*, pressio_data const*) override {
+      decompress = current_allocation();
+    }
+
+  struct pressio_options get_metrics_results() const override {
+    pressio_options opt;
+
+    auto set_or = [&opt](std::string const& prefix, compat::optional<allocation> const& a) {
+      if(a) {
+        opt.set(prefix + ":total_threads", a->total);
+        opt.set(prefix + ":outer_threads", a->outer);
+        opt.set(prefix + ":inner_threads", a->inner);
+      } else {
+        opt.set_type(prefix + ":total_threads", pressio_option_uint32_type);
+        opt.set_type(prefix + ":outer_threads", pressio_option_uint32_type);
+        opt.set_type(prefix + ":inner_threads", pressio_option_uint32_type);
+      }
+    };
+
+    set_or("thread_budget:compress", compress);
+    set_or("thread_budget:decompress", decompress);
+
+    return opt;
+  }
+
+  std::unique_ptr<libpressio_metrics_plugin> clone() override {
+    return compat::make_unique<thread_budget_plugin>(*this);
+  }
+
+  private:
+    compat::optional<allocation> compress;
+    compat::optional<allocation> decompress;
+};
+
+static pressio_register X(metrics_plugins(), "thread_budget", [](){ return compat::make_unique<thread_budget_plugin>(); });
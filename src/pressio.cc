@@ -6,9 +6,12 @@
 #include <functional>
 #include "pressio.h"
 #include "pressio_version.h"
+#include "libpressio_ext/cpp/allocation.h"
 #include "libpressio_ext/cpp/metrics.h"
 #include "libpressio_ext/cpp/pressio.h"
 #include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 
 
 
@@ -22,6 +25,79 @@ pressio_registry<std::unique_ptr<libpressio_metrics_plugin>>& metrics_plugins()
   return registry;
 }
 
+int pressio::set_options(pressio_options const& options) {
+  //every option is validated before any is applied so that an error leaves the library unchanged
+  auto& pool = pressio_thread_pool::global();
+  unsigned int nthreads = pool.nthreads();
+  std::vector<int> affinity = pool.affinity();
+  options.cast("pressio:nthreads", &nthreads, pressio_conversion_implicit);
+  std::string affinity_list;
+  if(options.get("pressio:affinity", &affinity_list) == pressio_options_key_set) {
+    if(not pressio_parse_cpu_list(affinity_list, affinity)) {
+      set_error(4, "invalid cpu list " + affinity_list);
+      return 4;
+    }
+  }
+
+  int thread_budget = 0;
+  const bool has_thread_budget = options.cast("pressio:thread_budget", &thread_budget, pressio_conversion_implicit) == pressio_options_key_set;
+
+  auto allocation = pressio_allocation_policy::defaults();
+  std::string numa;
+  if(options.get("pressio:numa", &numa) == pressio_options_key_set) {
+    if(not pressio_parse_numa_policy(numa, allocation.numa)) {
+      set_error(5, "invalid numa policy " + numa);
+      return 5;
+    }
+  }
+  options.cast("pressio:numa_node", &allocation.numa_node, pressio_conversion_implicit);
+  std::string huge_pages;
+  if(options.get("pressio:huge_pages", &huge_pages) == pressio_options_key_set) {
+    if(not pressio_parse_huge_page_policy(huge_pages, allocation.huge_pages)) {
+      set_error(6, "invalid huge page policy " + huge_pages);
+      return 6;
+    }
+  }
+  unsigned int huge_page_threshold = 0;
+  if(options.cast("pressio:huge_page_threshold", &huge_page_threshold, pressio_conversion_implicit) == pressio_options_key_set) {
+    allocation.huge_page_threshold = huge_page_threshold;
+  }
+  unsigned int alignment = 0;
+  if(options.cast("pressio:alignment", &alignment, pressio_conversion_implicit) == pressio_options_key_set) {
+    if(not pressio_valid_alignment(alignment)) {
+      set_error(7, "invalid alignment " + std::to_string(alignment));
+      return 7;
+    }
+    allocation.alignment = alignment;
+  }
+
+  //options matching the current pool, such as those from get_options, leave it running
+  if(nthreads != pool.nthreads() || affinity != pool.affinity()) {
+    if(not pool.configure(nthreads, std::move(affinity))) {
+      set_error(8, "the thread pool cannot be changed from one of its tasks");
+      return 8;
+    }
+  }
+  if(has_thread_budget) pressio_thread_budget::global().set_enabled(thread_budget != 0);
+  pressio_allocation_policy::set_defaults(allocation);
+  return 0;
+}
+
+pressio_options pressio::get_options() const {
+  auto const& pool = pressio_thread_pool::global();
+  auto const allocation = pressio_allocation_policy::defaults();
+  return {
+    {"pressio:nthreads", pool.nthreads()},
+    {"pressio:affinity", pressio_format_cpu_list(pool.affinity())},
+    {"pressio:thread_budget", static_cast<int>(pressio_thread_budget::global().enabled())},
+    {"pressio:numa", std::string(pressio_numa_policy_name(allocation.numa))},
+    {"pressio:numa_node", allocation.numa_node},
+    {"pressio:huge_pages", std::string(pressio_huge_page_policy_name(allocation.huge_pages))},
+    {"pressio:huge_page_threshold", static_cast<unsigned int>(allocation.huge_page_threshold)},
+    {"pressio:alignment", static_cast<unsigned int>(allocation.alignment)},
+  };
+}
+
 extern "C" {
 
 struct pressio* pressio_instance() {
@@ -50,6 +126,14 @@ void pressio_set_error(pressio* library, int code, const char* msg) {
 }
 
 
+int pressio_set_options(struct pressio* library, struct pressio_options const* options) {
+  return library->set_options(*options);
+}
+
+struct pressio_options* pressio_get_options(struct pressio* library) {
+  return new pressio_options(library->get_options());
+}
+
 struct pressio_compressor* pressio_get_compressor(struct pressio* library, const char* compressor_id) {
   auto compressor = library->get_compressor(compressor_id);
   if(compressor != nullptr) return new pressio_compressor(std::move(compressor));
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "pressio_version.h"
+#include "libpressio_ext/cpp/allocation.h"
+#include "libpressio_ext/cpp/thread_pool.h"
+#if LIBPRESSIO_HAS_NUMA
+#include <numa.h>
+#endif
+
+namespace {
+  std::mutex& defaults_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  pressio_allocation_policy& default_policy() {
+    static pressio_allocation_policy policy;
+    return policy;
+  }
+
+  /*
+   * memory from aligned_alloc is released with free, so these buffers share
+   * the deleter of malloc'ed buffers
+   */
+  pressio_allocation allocate_heap(size_t bytes, size_t alignment) {
+    if(!pressio_valid_alignment(alignment)) alignment = pressio_simd_alignment;
+    const size_t padded = (bytes + alignment - 1) / alignment * alignment;
+    return {aligned_alloc(alignment, padded), pressio_data_libc_free_fn, nullptr};
+  }
+
+#if defined(__linux__)
+  /** placing pages of buffers smaller than this is not worth a separate mapping */
+  constexpr size_t min_placed_bytes = 1 << 16;
+
+  size_t page_size() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+  /*
+   * mappings are released with munmap, so the length of the mapping is
+   * stored in the metadata pointer
+   */
+  void munmap_deleter(void* data, void* metadata) {
+    munmap(data, reinterpret_cast<uintptr_t>(metadata));
+  }
+
+  size_t round_up(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+  }
+
+  /*
+   * maps length bytes aligned to alignment by over-allocating and unmapping
+   * the unaligned head and the excess tail
+   */
+  void* map_aligned(size_t length, size_t alignment) {
+    const size_t padded = length + alignment;
+    void* mapping = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapping == MAP_FAILED) return MAP_FAILED;
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(mapping);
+    const uintptr_t aligned = round_up(begin, alignment);
+    if(aligned != begin) munmap(mapping, aligned - begin);
+    const size_t tail = padded - (aligned - begin) - length;
+    if(tail != 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  bool uses_huge_pages(size_t bytes, pressio_allocation_policy const& policy) {
+    return policy.huge_pages != pressio_huge_page_policy::none && bytes >= policy.huge_page_threshold;
+  }
+
+  std::vector<int> online_nodes() {
+    std::vector<int> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if(!std::getline(online, list) || !pressio_parse_cpu_list(list, nodes) || nodes.empty()) {
+      nodes = {0};
+    }
+    return nodes;
+  }
+
+  /*
+   * binds the pages of a mapping with the mbind system call directly, so
+   * placement works without libnuma
+   */
+  void mbind_nodes(void* ptr, size_t length, int mode, std::vector<int> const& nodes) {
+    constexpr size_t bits_per_word = sizeof(unsigned long) * 8;
+    constexpr size_t max_nodes = 1024;
+    unsigned long mask[max_nodes / bits_per_word] = {0};
+    for (int node : nodes) {
+      if(node < 0 || static_cast<size_t>(node) >= max_nodes) continue;
+      mask[node / bits_per_word] |= 1ul << (node % bits_per_word);
+    }
+    syscall(SYS_mbind, ptr, length, mode, mask, max_nodes + 1, 0);
+  }
+
+  void place_pages(void* ptr, size_t length, pressio_allocation_policy const& policy) {
+    switch(policy.numa) {
+      case pressio_numa_policy::interleave:
+#if LIBPRESSIO_HAS_NUMA
+        if(numa_available() >= 0) {
+          numa_interleave_memory(ptr, length, numa_all_nodes_ptr);
+          break;
+        }
+#endif
+        mbind_nodes(ptr, length, MPOL_INTERLEAVE, online_nodes());
+        break;
+      case pressio_numa_policy::node:
+#if LIBPRESSIO_HAS_NUMA
+        if(numa_available() >= 0) {
+          numa_tonode_memory(ptr, length, policy.numa_node);
+          break;
+        }
+#endif
+        mbind_nodes(ptr, length, MPOL_BIND, {policy.numa_node});
+        break;
+      case pressio_numa_policy::local:
+        {
+          //first touch each page from the pool, using the same chunking as the parallel kernels
+          const size_t pages = length / page_size();
+          const size_t pages_per_task = (1 << 20) / page_size();
+          auto bytes = static_cast<volatile unsigned char*>(ptr);
+          pressio_thread_pool::global().parallel_for(0, pages, pages_per_task, [=](size_t first, size_t last) {
+              for (size_t page = first; page < last; ++page) bytes[page * page_size()] = 0;
+          });
+        }
+        break;
+      case pressio_numa_policy::system:
+        break;
+    }
+  }
+
+  pressio_allocation allocate_mapped(size_t bytes, pressio_allocation_policy const& policy) {
+    const bool huge = uses_huge_pages(bytes, policy);
+    const size_t alignment = std::max(huge ? pressio_huge_page_size() : page_size(), policy.alignment);
+    const size_t length = round_up(bytes, alignment);
+    void* ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if(huge && policy.huge_pages == pressio_huge_page_policy::hugetlbfs) {
+      ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if(ptr == MAP_FAILED) {
+      ptr = map_aligned(length, alignment);
+      if(ptr == MAP_FAILED) return allocate_heap(bytes, policy.alignment);
+#if defined(MADV_HUGEPAGE)
+      if(huge) madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+    }
+    place_pages(ptr, length, policy);
+    return {ptr, munmap_deleter, reinterpret_cast<void*>(static_cast<uintptr_t>(length))};
+  }
+#endif
+}
+
+pressio_allocation_policy pressio_allocation_policy::defaults() {
+  std::lock_guard<std::mutex> lock(defaults_mutex());
+  return default_policy();
+}
+
+void pressio_allocation_policy::set_defaults(pressio_allocation_policy const& policy) {
+  std::lock_guard<std::mutex> lock(defaults_mutex());
+  default_policy() = policy;
+}
+
+pressio_allocation pressio_allocate(size_t bytes, pressio_allocation_policy const& policy) {
+  if(bytes == 0) return {nullptr, pressio_data_libc_free_fn, nullptr};
+#if defined(__linux__)
+  if((policy.numa != pressio_numa_policy::system && bytes >= min_placed_bytes) || uses_huge_pages(bytes, policy)) {
+    return allocate_mapped(bytes, policy);
+  }
+#endif
+  return allocate_heap(bytes, policy.alignment);
+}
+
+pressio_allocation pressio_allocate(size_t bytes) {
+  return pressio_allocate(bytes, pressio_allocation_policy::defaults());
+}
+
+bool pressio_parse_numa_policy(std::string const& name, pressio_numa_policy& policy) {
+  if(name == "system") policy = pressio_numa_policy::system;
+  else if(name == "interleave") policy = pressio_numa_policy::interleave;
+  else if(name == "local") policy = pressio_numa_policy::local;
+  else if(name == "node") policy = pressio_numa_policy::node;
+  else return false;
+  return true;
+}
+
+const char* pressio_numa_policy_name(pressio_numa_policy policy) {
+  switch(policy) {
+    case pressio_numa_policy::interleave: return "interleave";
+    case pressio_numa_policy::local: return "local";
+    case pressio_numa_policy::node: return "node";
+    case pressio_numa_policy::system:
+    default:
+      return "system";
+  }
+}
+
+bool pressio_parse_huge_page_policy(std::string const& name, pressio_huge_page_policy& policy) {
+  if(name == "none") policy = pressio_huge_page_policy::none;
+  else if(name == "transparent") policy = pressio_huge_page_policy::transparent;
+  else if(name == "hugetlbfs") policy = pressio_huge_page_policy::hugetlbfs;
+  else return false;
+  return true;
+}
+
+const char* pressio_huge_page_policy_name(pressio_huge_page_policy policy) {
+  switch(policy) {
+    case pressio_huge_page_policy::transparent: return "transparent";
+    case pressio_huge_page_policy::hugetlbfs: return "hugetlbfs";
+    case pressio_huge_page_policy::none:
+    default:
+      return "none";
+  }
+}
+
+size_t pressio_huge_page_size() {
+  static const size_t size = []{
+    size_t size = 0;
+    std::ifstream pmd_size("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+    if(!(pmd_size >> size) || size == 0) size = 1 << 21;
+    return size;
+  }();
+  return size;
+}
@@ -0,0 +1,109 @@
+#ifndef PRESSIO_BYTESWAP
+#define PRESSIO_BYTESWAP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "libpressio_ext/cpp/allocation.h"
+#include "libpressio_ext/cpp/thread_pool.h"
+
+/**
+ * \file
+ * \brief internal kernels to convert buffers between byte orders
+ */
+
+namespace libpressio { namespace byteswap {
+
+  /**
+   * the byte orders understood by the io plugins
+   */
+  enum class byte_order {
+    native,
+    little,
+    big,
+  };
+
+  /**
+   * \returns true if data stored in the byte order must be swapped to be used on this machine
+   */
+  inline bool needs_swap(byte_order order) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return order == byte_order::little;
+#else
+    return order == byte_order::big;
+#endif
+  }
+
+  /**
+   * parses the names "native", "little", and "big"
+   * \returns true if the name was recognized
+   */
+  inline bool parse_byte_order(std::string const& name, byte_order& order) {
+    if(name == "native") order = byte_order::native;
+    else if(name == "little") order = byte_order::little;
+    else if(name == "big") order = byte_order::big;
+    else return false;
+    return true;
+  }
+
+  namespace detail {
+    inline uint16_t bswap(uint16_t v) { return __builtin_bswap16(v); }
+    inline uint32_t bswap(uint32_t v) { return __builtin_bswap32(v); }
+    inline uint64_t bswap(uint64_t v) { return __builtin_bswap64(v); }
+
+    /*
+     * loads and stores go through memcpy so unaligned buffers are handled;
+     * the compiler turns this loop into vector shuffles
+     */
+    template <class Word>
+    void swap_words(uint8_t* bytes, size_t elements) {
+      for (size_t i = 0; i < elements; ++i) {
+        Word w;
+        memcpy(&w, bytes + i * sizeof(Word), sizeof(Word));
+        w = bswap(w);
+        memcpy(bytes + i * sizeof(Word), &w, sizeof(Word));
+      }
+    }
+
+    inline void swap_serial(uint8_t* bytes, size_t elements, size_t element_size) {
+      switch(element_size) {
+        case 1: break;
+        case 2: swap_words<uint16_t>(bytes, elements); break;
+        case 4: swap_words<uint32_t>(bytes, elements); break;
+        case 8: swap_words<uint64_t>(bytes, elements); break;
+        default:
+          for (size_t i = 0; i < elements; ++i) {
+            std::reverse(bytes + i * element_size, bytes + (i + 1) * element_size);
+          }
+      }
+    }
+
+    /** buffers smaller than this are not worth splitting across the thread pool */
+    constexpr size_t min_bytes_per_task = 1024 * 1024;
+  }
+
+  /**
+   * reverses the bytes of each element in a buffer in place, in parallel on the shared thread pool for large buffers
+   *
+   * \param[in,out] data the buffer to convert
+   * \param[in] elements the number of elements in the buffer
+   * \param[in] element_size the size of each element in bytes
+   */
+  inline void swap_bytes(void* data, size_t elements, size_t element_size) {
+    if(element_size <= 1 || elements == 0) return;
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    //tasks cover whole blocks of elements so tasks on an aligned buffer do not share cache lines
+    const size_t block = pressio_simd_alignment;
+    const size_t grain = std::max<size_t>(1, detail::min_bytes_per_task / element_size / block);
+    pressio_thread_pool::global().parallel_for(0, (elements + block - 1) / block, grain, [=](size_t first, size_t last) {
+      const size_t first_element = first * block;
+      const size_t count = std::min(elements, last * block) - first_element;
+      detail::swap_serial(bytes + first_element * element_size, count, element_size);
+    });
+  }
+
+} }
+
+#endif /* end of include guard: PRESSIO_BYTESWAP */
@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include "libpressio_ext/cpp/compressed_array.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/thread_pool.h"
+#include "pressio_compressor.h"
+
+namespace {
+  /*
+   * copies a box of count elements from src starting at src_start to dst
+   * starting at dst_start, one contiguous row of the fastest dimension at a time
+   */
+  void copy_box(uint8_t const* src, std::vector<size_t> const& src_dims, std::vector<size_t> const& src_start,
+      uint8_t* dst, std::vector<size_t> const& dst_dims, std::vector<size_t> const& dst_start,
+      std::vector<size_t> const& count, size_t element_size) {
+    const size_t ndims = count.size();
+    std::vector<size_t> src_stride(ndims, 1), dst_stride(ndims, 1);
+    for (size_t d = 1; d < ndims; ++d) {
+      src_stride[d] = src_stride[d-1] * src_dims[d-1];
+      dst_stride[d] = dst_stride[d-1] * dst_dims[d-1];
+    }
+    size_t rows = 1;
+    for (size_t d = 1; d < ndims; ++d) rows *= count[d];
+    const size_t row_bytes = count[0] * element_size;
+
+    for (size_t row = 0; row < rows; ++row) {
+      size_t src_offset = src_start[0], dst_offset = dst_start[0];
+      size_t remaining = row;
+      for (size_t d = 1; d < ndims; ++d) {
+        const size_t i = remaining % count[d];
+        remaining /= count[d];
+        src_offset += (src_start[d] + i) * src_stride[d];
+        dst_offset += (dst_start[d] + i) * dst_stride[d];
+      }
+      memcpy(dst + dst_offset * element_size, src + src_offset * element_size, row_bytes);
+    }
+  }
+
+  /*
+   * guards the calls of compressors which are not safe to use from several
+   * threads at once; serialized compressors share state between instances,
+   * so the lock is shared by every array
+   */
+  std::mutex serialized_compressor_lock;
+
+  std::string format_dims(std::vector<size_t> const& dims) {
+    std::ostringstream ss;
+    for (size_t i = 0; i < dims.size(); ++i) {
+      if(i) ss << 'x';
+      ss << dims[i];
+    }
+    return ss.str();
+  }
+}
+
+/*
+ * blocks removed from the cache whose locks are held until they are written back
+ */
+struct pressio_compressed_array::eviction {
+  lru_list entries;
+  std::vector<std::unique_lock<std::mutex>> locks;
+};
+
+pressio_compressed_array::pressio_compressed_array(pressio_dtype dtype, std::vector<size_t> const& dimensions,
+    std::vector<size_t> const& block_dimensions,
+    std::shared_ptr<libpressio_compressor_plugin> const& compressor, size_t cache_bytes):
+  array_dtype(dtype),
+  dims(dimensions),
+  block_dims(block_dimensions),
+  capacity(cache_bytes),
+  prototype(compressor)
+{
+  int thread_safety = pressio_thread_safety_single;
+  prototype->get_configuration().get("pressio:thread_safe", &thread_safety);
+  serialized = thread_safety != pressio_thread_safety_multiple;
+
+  block_dims.resize(dims.size(), 1);
+  size_t nblocks = dims.empty() ? 0 : 1;
+  for (size_t d = 0; d < dims.size(); ++d) {
+    block_dims[d] = std::max<size_t>(1, std::min(block_dims[d], dims[d]));
+    grid.push_back(dims[d] == 0 ? 0 : (dims[d] + block_dims[d] - 1) / block_dims[d]);
+    nblocks *= grid.back();
+  }
+  blocks.resize(nblocks);
+  block_locks.reset(new std::mutex[nblocks]);
+}
+
+pressio_compressed_array::~pressio_compressed_array()=default;
+
+int pressio_compressed_array::set_error(int code, std::string const& msg) {
+  std::lock_guard<std::mutex> guard(error_lock);
+  this->code = code;
+  this->msg = msg;
+  return code;
+}
+
+int pressio_compressed_array::error_code() const {
+  std::lock_guard<std::mutex> guard(error_lock);
+  return code;
+}
+
+std::string pressio_compressed_array::error_msg() const {
+  std::lock_guard<std::mutex> guard(error_lock);
+  return msg;
+}
+
+int pressio_compressed_array::type_mismatch() {
+  return set_error(1, "the element type does not match the type of the array");
+}
+
+std::vector<size_t> pressio_compressed_array::block_origin(size_t block) const {
+  std::vector<size_t> origin(dims.size());
+  for (size_t d = 0; d < dims.size(); ++d) {
+    origin[d] = (block % grid[d]) * block_dims[d];
+    block /= grid[d];
+  }
+  return origin;
+}
+
+std::vector<size_t> pressio_compressed_array::block_extent(size_t block) const {
+  auto origin = block_origin(block);
+  std::vector<size_t> extent(dims.size());
+  for (size_t d = 0; d < dims.size(); ++d) {
+    extent[d] = std::min(block_dims[d], dims[d] - origin[d]);
+  }
+  return extent;
+}
+
+std::shared_ptr<libpressio_compressor_plugin> pressio_compressed_array::acquire_compressor() {
+  std::lock_guard<std::mutex> guard(compressors_lock);
+  if(idle_compressors.empty()) return prototype->clone();
+  auto compressor = std::move(idle_compressors.back());
+  idle_compressors.pop_back();
+  return compressor;
+}
+
+void pressio_compressed_array::release_compressor(std::shared_ptr<libpressio_compressor_plugin>&& compressor) {
+  std::lock_guard<std::mutex> guard(compressors_lock);
+  idle_compressors.emplace_back(std::move(compressor));
+}
+
+/* the caller holds the lock of block */
+int pressio_compressed_array::compress_block(size_t block, pressio_data const& data) {
+  auto compressor = acquire_compressor();
+  pressio_data compressed = pressio_data::empty(pressio_byte_dtype, {});
+  int ret;
+  {
+    std::unique_lock<std::mutex> guard(serialized_compressor_lock, std::defer_lock);
+    if(serialized) guard.lock();
+    ret = compressor->compress(&data, &compressed);
+  }
+  if(ret) {
+    set_error(ret, std::string("failed to compress block: ") + compressor->error_msg());
+  } else {
+    blocks[block] = std::move(compressed);
+  }
+  release_compressor(std::move(compressor));
+  return ret;
+}
+
+/* the caller holds the lock of block */
+int pressio_compressed_array::decompress_block(size_t block, pressio_data& data) {
+  auto extent = block_extent(block);
+  if(!blocks[block].has_data()) {
+    data = pressio_data::owning(array_dtype, extent);
+    memset(data.data(), 0, data.size_in_bytes());
+    return 0;
+  }
+
+  auto compressor = acquire_compressor();
+  data = pressio_data::owning(array_dtype, extent);
+  int ret;
+  {
+    std::unique_lock<std::mutex> guard(serialized_compressor_lock, std::defer_lock);
+    if(serialized) guard.lock();
+    ret = compressor->decompress(&blocks[block], &data);
+  }
+  if(ret) {
+    set_error(ret, std::string("failed to decompress block: ") + compressor->error_msg());
+  } else if(data.dtype() != array_dtype || data.dimensions() != extent) {
+    ret = set_error(2, "the compressor returned a block of the wrong type or dimensions " + format_dims(data.dimensions()));
+  }
+  release_compressor(std::move(compressor));
+  return ret;
+}
+
+/*
+ * runs body over the blocks on the thread pool, or on the calling thread when
+ * the compressor calls are serialized anyway
+ */
+void pressio_compressed_array::for_blocks(size_t nblocks, std::function<void(size_t, size_t)> const& body) {
+  if(serialized) body(0, nblocks);
+  else pressio_thread_pool::global().parallel_for(0, nblocks, 1, body);
+}
+
+/*
+ * removes least recently used blocks other than keep until the cache fits; the
+ * caller holds cache_lock.  Blocks in use by another thread are skipped rather
+ * than waited for, since that thread may be waiting on cache_lock.
+ */
+void pressio_compressed_array::evict(size_t keep, eviction& victims) {
+  auto it = lru.end();
+  while(used > capacity && it != lru.begin()) {
+    --it;
+    if(it->block == keep) continue;
+    std::unique_lock<std::mutex> lock(block_locks[it->block], std::try_to_lock);
+    if(!lock.owns_lock()) continue;
+    auto victim = it++;
+    used -= victim->data.size_in_bytes();
+    cached.erase(victim->block);
+    victims.entries.splice(victims.entries.end(), lru, victim);
+    victims.locks.emplace_back(std::move(lock));
+  }
+}
+
+/*
+ * compresses the modified victims and releases their locks; victims which
+ * fail to compress go back into the cache, still modified, so that their
+ * changes are not lost
+ */
+int pressio_compressed_array::write_back(eviction& victims) {
+  int ret = 0;
+  for (auto it = victims.entries.begin(); it != victims.entries.end();) {
+    if(it->dirty) {
+      if(int block_ret = compress_block(it->block, it->data)) {
+        if(!ret) ret = block_ret;
+        ++it;
+        continue;
+      }
+    }
+    it = victims.entries.erase(it);
+  }
+  if(!victims.entries.empty()) {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    while(!victims.entries.empty()) {
+      used += victims.entries.front().data.size_in_bytes();
+      lru.splice(lru.end(), victims.entries, victims.entries.begin());
+      cached[lru.back().block] = std::prev(lru.end());
+    }
+  }
+  victims.locks.clear();
+  return ret;
+}
+
+/*
+ * calls body with the decompressed block while holding its lock, loading
+ * the block into the cache if needed
+ */
+template <class Body>
+int pressio_compressed_array::with_block(size_t block, bool modify, Body&& body) {
+  std::lock_guard<std::mutex> block_guard(block_locks[block]);
+  cache_entry* entry = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    auto found = cached.find(block);
+    if(found != cached.end()) {
+      lru.splice(lru.begin(), lru, found->second);
+      entry = &*found->second;
+    }
+  }
+
+  if(entry == nullptr) {
+    pressio_data data;
+    if(int ret = decompress_block(block, data)) return ret;
+    eviction victims;
+    {
+      std::lock_guard<std::mutex> guard(cache_lock);
+      used += data.size_in_bytes();
+      lru.push_front(cache_entry{block, std::move(data), false});
+      cached[block] = lru.begin();
+      entry = &lru.front();
+      evict(block, victims);
+    }
+    //victims which fail to write back stay cached and are retried later, so they do not fail this access
+    write_back(victims);
+  }
+
+  //the entry cannot be evicted while its block lock is held
+  body(entry->data);
+  if(modify) {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    entry->dirty = true;
+  }
+
+  //a block larger than the cache is not kept once it has been written back
+  if(entry->data.size_in_bytes() > capacity) {
+    if(entry->dirty) {
+      if(int ret = compress_block(block, entry->data)) return ret;
+    }
+    std::lock_guard<std::mutex> guard(cache_lock);
+    auto found = cached.find(block);
+    used -= entry->data.size_in_bytes();
+    lru.erase(found->second);
+    cached.erase(found);
+  }
+  return 0;
+}
+
+int pressio_compressed_array::copy_region(std::vector<size_t> const& start, std::vector<size_t> const& count,
+    pressio_data const* src, pressio_data* dst) {
+  const size_t ndims = dims.size();
+  if(start.size() != ndims || count.size() != ndims) {
+    return set_error(3, "the region must have " + std::to_string(ndims) + " dimensions");
+  }
+  for (size_t d = 0; d < ndims; ++d) {
+    if(start[d] > dims[d] || count[d] > dims[d] - start[d]) {
+      return set_error(3, "the region " + format_dims(start) + " + " + format_dims(count) +
+          " is outside of the array " + format_dims(dims));
+    }
+  }
+  if(std::find(count.begin(), count.end(), 0) != count.end()) return 0;
+
+  //the blocks overlapping the region, as a box in the block grid
+  std::vector<size_t> first_block(ndims), block_count(ndims);
+  size_t nblocks = 1;
+  for (size_t d = 0; d < ndims; ++d) {
+    first_block[d] = start[d] / block_dims[d];
+    block_count[d] = (start[d] + count[d] - 1) / block_dims[d] - first_block[d] + 1;
+    nblocks *= block_count[d];
+  }
+
+  const size_t element_size = pressio_dtype_size(array_dtype);
+  const bool modify = src != nullptr;
+  pressio_data const& region = modify ? *src : *dst;
+  uint8_t* region_ptr = static_cast<uint8_t*>(region.data());
+  std::atomic<int> first_error{0};
+
+  for_blocks(nblocks, [&](size_t begin, size_t end) {
+    std::vector<size_t> in_block(ndims), in_region(ndims), overlap(ndims);
+    for (size_t i = begin; i < end; ++i) {
+      size_t block = 0, remaining = i, scale = 1;
+      for (size_t d = 0; d < ndims; ++d) {
+        block += (first_block[d] + remaining % block_count[d]) * scale;
+        remaining /= block_count[d];
+        scale *= grid[d];
+      }
+      auto origin = block_origin(block);
+      auto extent = block_extent(block);
+      for (size_t d = 0; d < ndims; ++d) {
+        const size_t lo = std::max(origin[d], start[d]);
+        const size_t hi = std::min(origin[d] + extent[d], start[d] + count[d]);
+        in_block[d] = lo - origin[d];
+        in_region[d] = lo - start[d];
+        overlap[d] = hi - lo;
+      }
+
+      int ret = with_block(block, modify, [&](pressio_data& data) {
+        uint8_t* block_ptr = static_cast<uint8_t*>(data.data());
+        if(modify) {
+          copy_box(region_ptr, count, in_region, block_ptr, extent, in_block, overlap, element_size);
+        } else {
+          copy_box(block_ptr, extent, in_block, region_ptr, count, in_region, overlap, element_size);
+        }
+      });
+      if(ret) {
+        int expected = 0;
+        first_error.compare_exchange_strong(expected, ret);
+      }
+    }
+  });
+  return first_error.load();
+}
+
+int pressio_compressed_array::read(std::vector<size_t> const& start, std::vector<size_t> const& count, pressio_data* out) {
+  if(count.size() != dims.size()) {
+    return set_error(3, "the region must have " + std::to_string(dims.size()) + " dimensions");
+  }
+  *out = pressio_data::owning(array_dtype, count);
+  return copy_region(start, count, nullptr, out);
+}
+
+int pressio_compressed_array::write(std::vector<size_t> const& start, pressio_data const& values) {
+  if(values.dtype() != array_dtype) return type_mismatch();
+  auto count = values.dimensions();
+  if(count.size() < dims.size()) count.resize(dims.size(), 1);
+  return copy_region(start, count, &values, nullptr);
+}
+
+int pressio_compressed_array::to_data(pressio_data* out) {
+  return read(std::vector<size_t>(dims.size(), 0), dims, out);
+}
+
+int pressio_compressed_array::access(std::vector<size_t> const& index, void* value, bool modify) {
+  if(index.size() != dims.size()) {
+    return set_error(3, "the index must have " + std::to_string(dims.size()) + " dimensions");
+  }
+  size_t block = 0, offset = 0, scale = 1, stride = 1;
+  for (size_t d = 0; d < dims.size(); ++d) {
+    if(index[d] >= dims[d]) {
+      return set_error(3, "the index " + format_dims(index) + " is outside of the array " + format_dims(dims));
+    }
+    block += (index[d] / block_dims[d]) * scale;
+    scale *= grid[d];
+  }
+  auto extent = block_extent(block);
+  for (size_t d = 0; d < dims.size(); ++d) {
+    offset += (index[d] % block_dims[d]) * stride;
+    stride *= extent[d];
+  }
+
+  const size_t element_size = pressio_dtype_size(array_dtype);
+  return with_block(block, modify, [&](pressio_data& data) {
+    uint8_t* element = static_cast<uint8_t*>(data.data()) + offset * element_size;
+    if(modify) memcpy(element, value, element_size);
+    else memcpy(value, element, element_size);
+  });
+}
+
+int pressio_compressed_array::assign(pressio_data const& data) {
+  if(data.dtype() != array_dtype) return type_mismatch();
+  if(data.dimensions() != dims) {
+    return set_error(3, "the data " + format_dims(data.dimensions()) + " does not match the array " + format_dims(dims));
+  }
+  {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    lru.clear();
+    cached.clear();
+    used = 0;
+  }
+
+  const size_t element_size = pressio_dtype_size(array_dtype);
+  const std::vector<size_t> zero(dims.size(), 0);
+  std::atomic<int> first_error{0};
+  for_blocks(blocks.size(), [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; ++block) {
+      auto extent = block_extent(block);
+      auto block_data = pressio_data::owning(array_dtype, extent);
+      copy_box(static_cast<uint8_t const*>(data.data()), dims, block_origin(block),
+          static_cast<uint8_t*>(block_data.data()), extent, zero, extent, element_size);
+      std::lock_guard<std::mutex> guard(block_locks[block]);
+      if(int ret = compress_block(block, block_data)) {
+        int expected = 0;
+        first_error.compare_exchange_strong(expected, ret);
+      }
+    }
+  });
+  return first_error.load();
+}
+
+int pressio_compressed_array::flush() {
+  std::vector<size_t> resident;
+  {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    for (auto const& entry : lru) {
+      if(entry.dirty) resident.push_back(entry.block);
+    }
+  }
+
+  int ret = 0;
+  for (auto block : resident) {
+    std::lock_guard<std::mutex> block_guard(block_locks[block]);
+    cache_entry* entry = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(cache_lock);
+      auto found = cached.find(block);
+      if(found != cached.end()) entry = &*found->second;
+    }
+    //the block may have been written back since it was listed
+    if(entry == nullptr || !entry->dirty) continue;
+    if(int block_ret = compress_block(block, entry->data)) {
+      if(!ret) ret = block_ret;
+    } else {
+      std::lock_guard<std::mutex> guard(cache_lock);
+      entry->dirty = false;
+    }
+  }
+  return ret;
+}
+
+int pressio_compressed_array::set_cache_size(size_t cache_bytes) {
+  eviction victims;
+  {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    capacity = cache_bytes;
+    evict(blocks.size(), victims);
+  }
+  return write_back(victims);
+}
+
+size_t pressio_compressed_array::cache_size() const {
+  std::lock_guard<std::mutex> guard(cache_lock);
+  return capacity;
+}
+
+size_t pressio_compressed_array::cached_bytes() const {
+  std::lock_guard<std::mutex> guard(cache_lock);
+  return used;
+}
+
+size_t pressio_compressed_array::compressed_size() const {
+  size_t total = 0;
+  for (size_t block = 0; block < blocks.size(); ++block) {
+    std::lock_guard<std::mutex> guard(block_locks[block]);
+    if(blocks[block].has_data()) total += blocks[block].size_in_bytes();
+  }
+  return total;
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "libpressio_ext/cpp/compressibility.h"
+
+namespace {
+  /* runs of a cache line amortize the misses of the sample while covering the buffer evenly */
+  constexpr size_t run_bytes = 64;
+}
+
+double pressio_estimate_entropy(void const* data, size_t size_in_bytes, size_t element_size, size_t sample_bytes) {
+  if(size_in_bytes == 0 || element_size == 0) return 0.0;
+  auto bytes = static_cast<uint8_t const*>(data);
+
+  //runs start on element boundaries so each byte lands in the histogram of its position
+  const size_t run = std::max(element_size, run_bytes - run_bytes % element_size);
+  const bool whole = sample_bytes == 0 || sample_bytes >= size_in_bytes;
+  const size_t runs = whole ? 1 : std::max<size_t>(1, sample_bytes / run);
+  const size_t length = whole ? size_in_bytes : run;
+  size_t step = whole ? 0 : size_in_bytes / runs;
+  step -= step % element_size;
+
+  std::vector<std::array<uint32_t, 256>> histograms(element_size);
+  for (auto& histogram : histograms) histogram.fill(0);
+  size_t position = 0;
+  for (size_t r = 0; r < runs; ++r) {
+    const size_t begin = r * step;
+    const size_t end = std::min(size_in_bytes, begin + length);
+    for (size_t i = begin; i < end; ++i) {
+      ++histograms[position][bytes[i]];
+      if(++position == element_size) position = 0;
+    }
+    position = 0;
+  }
+
+  double bits = 0;
+  size_t total = 0;
+  for (auto const& histogram : histograms) {
+    size_t count = 0;
+    for (auto value : histogram) count += value;
+    if(count == 0) continue;
+    double entropy = 0;
+    for (auto value : histogram) {
+      if(value == 0) continue;
+      const double p = static_cast<double>(value) / count;
+      entropy -= p * std::log2(p);
+    }
+    bits += entropy * count;
+    total += count;
+  }
+  return (total == 0) ? 0.0 : bits / total;
+}
+
+double pressio_estimate_compression_ratio(void const* data, size_t size_in_bytes, size_t element_size, size_t sample_bytes) {
+  const double entropy = pressio_estimate_entropy(data, size_in_bytes, element_size, sample_bytes);
+  if(entropy == 0.0) return std::numeric_limits<double>::infinity();
+  return 8.0 / entropy;
+}
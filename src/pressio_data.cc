@@ -5,8 +5,8 @@
 #include <algorithm>
 #include <numeric>
 #include "pressio_data.h"
-#include "multi_dimensional_iterator.h"
 #include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/thread_pool.h"
 #include "libpressio_ext/compat/std_compat.h"
 
 
@@ -65,66 +65,124 @@ namespace {
     std::vector<size_t> const& start;
   };
 
-  template <class Type>
-  void copy_multi_dims(void* src, void* out, copy_multi_dims_args const& args) {
-    Type* source = static_cast<Type*>(src);
-    Type* dest = static_cast<Type*>(out);
-    std::vector<size_t> const ones(args.global_dims.size(), 1);
-    std::vector<size_t> const zeros(args.global_dims.size(), 0);
-    std::vector<size_t> dest_global_dims(args.global_dims.size());
+  /*
+   * copies the selection one row of the fastest varying output dimension at a
+   * time.  Rows are independent, so they are divided among the thread pool
+   */
+  void copy_multi_dims(void const* src, void* out, size_t element_size, copy_multi_dims_args const& args) {
+    const size_t ndims = args.global_dims.size();
+    std::vector<size_t> dest_dims(ndims);
     std::transform(
         std::begin(args.block),
         std::end(args.block),
         std::begin(args.count),
-        std::begin(dest_global_dims),
+        std::begin(dest_dims),
         compat::multiplies<>{}
         );
+    std::vector<size_t> src_strides(ndims, 1);
+    for (size_t d = 1; d < ndims; ++d) {
+      src_strides[d] = src_strides[d-1] * args.global_dims[d-1];
+    }
 
-    auto src_blocks = std::make_shared<multi_dimensional_range<Type>>(source,
-        std::begin(args.global_dims),
-        std::end(args.global_dims),
-        std::begin(args.count),
-        std::begin(args.stride),
-        std::begin(args.start)
-        );
-    auto dst_blocks = std::make_shared<multi_dimensional_range<Type>>(dest,
-        std::begin(dest_global_dims),
-        std::end(dest_global_dims),
-        std::begin(args.count),
-        std::begin(args.block),
-        std::begin(zeros)
-        );
-
-    {
-      auto src_block = std::begin(*src_blocks);
-      auto src_block_end = std::end(*src_blocks);
-      auto dst_block = std::begin(*dst_blocks);
-      auto dst_block_end = std::end(*dst_blocks);
-      for(; src_block != src_block_end; ++src_block, ++dst_block) {
-        auto src_block_it = std::make_shared<multi_dimensional_range<Type>>(src_block,
-            std::begin(args.block),
-            std::begin(ones)
-            );
-        auto dst_block_it = std::make_shared<multi_dimensional_range<Type>>(dst_block,
-            std::begin(args.block),
-            std::begin(ones)
-            );
-        std::copy(std::begin(*src_block_it), std::end(*src_block_it), std::begin(*dst_block_it));
-        
+    const size_t row_elements = dest_dims[0];
+    const size_t row_bytes = row_elements * element_size;
+    const size_t block_bytes = args.block[0] * element_size;
+    const size_t rows = std::accumulate(std::next(std::begin(dest_dims)), std::end(dest_dims), size_t{1}, compat::multiplies<>{});
+    const bool contiguous_rows = args.stride[0] == args.block[0];
+    auto source = static_cast<unsigned char const*>(src);
+    auto dest = static_cast<unsigned char*>(out);
+
+    const size_t min_bytes_per_task = 1 << 16;
+    const size_t grain = std::max<size_t>(1, min_bytes_per_task / std::max<size_t>(1, row_bytes));
+    pressio_thread_pool::global().parallel_for(0, rows, grain, [&](size_t first, size_t last) {
+      for (size_t row = first; row < last; ++row) {
+        //the offset of the first element of the row in the source
+        size_t remainder = row;
+        size_t offset = args.start[0];
+        for (size_t d = 1; d < ndims; ++d) {
+          const size_t o = remainder % dest_dims[d];
+          remainder /= dest_dims[d];
+          offset += (args.start[d] + (o / args.block[d]) * args.stride[d] + o % args.block[d]) * src_strides[d];
+        }
+
+        unsigned char* dest_row = dest + row * row_bytes;
+        if(contiguous_rows) {
+          std::memcpy(dest_row, source + offset * element_size, row_bytes);
+        } else {
+          for (size_t c = 0; c < args.count[0]; ++c) {
+            std::memcpy(dest_row + c * block_bytes, source + (offset + c * args.stride[0]) * element_size, block_bytes);
+          }
+        }
       }
-    }
+    });
   }
 
   struct cast_fn {
     template <class T, class V>
     int operator()(T* src_begin, T* src_end, V* dst_begin) {
-      std::copy(src_begin, src_end, dst_begin);
+      const size_t min_elements_per_task = 1 << 16;
+      //tasks cover whole blocks so each one starts on an aligned element of both buffers when the buffers are aligned
+      const size_t block = pressio_simd_alignment;
+      const size_t elements = static_cast<size_t>(src_end - src_begin);
+      const bool aligned = pressio_is_aligned(src_begin) && pressio_is_aligned(dst_begin);
+      pressio_thread_pool::global().parallel_for(0, (elements + block - 1) / block, min_elements_per_task / block,
+          [=](size_t first, size_t last) {
+            const size_t first_element = first * block;
+            const size_t last_element = std::min(elements, last * block);
+            if(aligned) {
+              T* src = pressio_assume_aligned(src_begin + first_element);
+              V* dst = pressio_assume_aligned(dst_begin + first_element);
+              std::copy(src, src + (last_element - first_element), dst);
+            } else {
+              std::copy(src_begin + first_element, src_begin + last_element, dst_begin + first_element);
+            }
+          });
       return 0;
     }
 };
 }
 
 
+void* pressio_data::materialize() const {
+  std::lock_guard<std::mutex> guard(source->lock);
+  if(data_ptr == nullptr) {
+    auto allocation = pressio_allocate(size_in_bytes());
+    if(allocation.ptr == nullptr) return nullptr;
+    if(source->generate(std::vector<size_t>(dims.size(), 0), dims, allocation.ptr) != 0) {
+      if(allocation.deleter != nullptr) allocation.deleter(allocation.ptr, allocation.metadata);
+      return nullptr;
+    }
+    data_ptr = allocation.ptr;
+    metadata_ptr = allocation.metadata;
+    deleter = allocation.deleter;
+  }
+  return data_ptr;
+}
+
+int pressio_data::read_region(std::vector<size_t> const& start, std::vector<size_t> const& count, void* out) const {
+  if(start.size() != dims.size() || count.size() != dims.size()) return 1;
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if(start[i] > dims[i] || count[i] > dims[i] - start[i]) return 1;
+  }
+  if(std::find(std::begin(count), std::end(count), 0) != std::end(count)) return 0;
+
+  void* ptr = buffer();
+  if(ptr == nullptr) {
+    if(!source) return 1;
+    return source->generate(start, count, out);
+  }
+  const std::vector<size_t> ones(dims.size(), 1);
+  copy_multi_dims_args args {
+    dims,
+    ones,
+    count,
+    ones,
+    start
+  };
+  copy_multi_dims(ptr, out, pressio_dtype_size(data_dtype), args);
+  return 0;
+}
+
 pressio_data pressio_data::select(std::vector<size_t> const& start,
     std::vector<size_t> const& stride,
     std::vector<size_t> const& count,
@@ -140,6 +198,14 @@ pressio_data pressio_data::select(std::vector<size_t> const& start,
   //allocate output buffer
   auto output = pressio_data::owning(this->dtype(), output_dims);
 
+  //contiguous selections of lazy data only produce the selected region
+  if(is_lazy() && buffer() == nullptr && stride == block) {
+    if(read_region(start, output_dims, output.data()) != 0) {
+      return pressio_data::empty(dtype(), dimensions());
+    }
+    return output;
+  }
+
   copy_multi_dims_args args {
     dimensions(),
     stride,
@@ -147,45 +213,7 @@ pressio_data pressio_data::select(std::vector<size_t> const& start,
     block,
     start
   };
-
-  switch(this->dtype())
-  {
-  case pressio_double_dtype: 
-    copy_multi_dims<double>(data(), output.data(), args);
-    break;
-  case pressio_float_dtype:
-    copy_multi_dims<float>(data(), output.data(), args);
-    break;
-  case pressio_uint8_dtype:
-    copy_multi_dims<uint8_t>(data(), output.data(), args);
-    break;
-  case pressio_uint16_dtype:
-    copy_multi_dims<uint16_t>(data(), output.data(), args);
-    break;
-  case pressio_uint32_dtype:
-    copy_multi_dims<uint32_t>(data(), output.data(), args);
-    break;
-  case pressio_uint64_dtype:
-    copy_multi_dims<uint64_t>(data(), output.data(), args);
-    break;
-  case pressio_int8_dtype:
-    copy_multi_dims<int8_t>(data(), output.data(), args);
-    break;
-  case pressio_int16_dtype:
-    copy_multi_dims<int16_t>(data(), output.data(), args);
-    break;
-  case pressio_int32_dtype:
-    copy_multi_dims<int32_t>(data(), output.data(), args);
-    break;
-  case pressio_int64_dtype:
-    copy_multi_dims<int64_t>(data(), output.data(), args);
-    break;
-  case pressio_byte_dtype:
-  default:
-    copy_multi_dims<void*>(data(), output.data(), args);
-    break;
-  }
-
+  copy_multi_dims(data(), output.data(), pressio_dtype_size(dtype()), args);
 
   return output;
 }
@@ -270,6 +298,10 @@ bool pressio_data_has_data(struct pressio_data const* data) {
   return data->has_data();
 }
 
+bool pressio_data_is_aligned(struct pressio_data const* data, size_t alignment) {
+  return data->is_aligned(alignment);
+}
+
 size_t pressio_data_num_dimensions(struct pressio_data const* data) {
   return data->num_dimensions();
 }
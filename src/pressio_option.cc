@@ -1,3 +1,4 @@
+#include <stdexcept>
 #include <string>
 #include "pressio_option.h"
 #include "libpressio_ext/cpp/options.h"
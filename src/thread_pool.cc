@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <utility>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "libpressio_ext/cpp/thread_pool.h"
+
+namespace {
+  /*
+   * identifies the pool and queue owned by the current thread so that tasks
+   * submitted from a worker go to its own queue
+   */
+  thread_local pressio_thread_pool const* current_pool = nullptr;
+  thread_local size_t current_worker = 0;
+  /** the number of budget scopes open on this thread */
+  thread_local unsigned int budget_depth = 0;
+  /** the number of tasks and loops of a pool running on this thread */
+  thread_local unsigned int usage_depth = 0;
+
+  struct usage_scope {
+    usage_scope() { ++usage_depth; }
+    ~usage_scope() { --usage_depth; }
+  };
+
+  unsigned int resolve_nthreads(unsigned int nthreads) {
+    if(nthreads != 0) return nthreads;
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  void pin_current_thread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+  }
+
+  struct loop_state {
+    std::function<void(size_t, size_t)> const* body;
+    size_t begin;
+    size_t end;
+    size_t chunk_size;
+    size_t chunks;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+  };
+
+  /*
+   * claims and runs chunks until none remain; helpers which start after the
+   * loop has completed claim nothing and never touch the body
+   */
+  void run_chunks(loop_state& state) {
+    for(size_t chunk = state.next++; chunk < state.chunks; chunk = state.next++) {
+      const size_t first = state.begin + chunk * state.chunk_size;
+      const size_t last = std::min(state.end, first + state.chunk_size);
+      try {
+        (*state.body)(first, last);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if(!state.error) state.error = std::current_exception();
+      }
+      if(++state.done == state.chunks) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.finished.notify_all();
+      }
+    }
+  }
+}
+
+pressio_thread_pool& pressio_thread_pool::global() {
+  static pressio_thread_pool pool;
+  return pool;
+}
+
+pressio_thread_pool::pressio_thread_pool(unsigned int nthreads, std::vector<int> affinity):
+  requested_threads(nthreads), cpus(std::move(affinity))
+{
+  start();
+}
+
+pressio_thread_pool::~pressio_thread_pool() {
+  stop();
+}
+
+bool pressio_thread_pool::configure(unsigned int nthreads, std::vector<int> affinity) {
+  std::unique_lock<std::mutex> lock(config_mutex);
+  if(resolve_nthreads(nthreads) == thread_count && affinity == cpus) return true;
+  //the work running on this thread would never finish
+  if(usage_depth != 0) return false;
+  idle.wait(lock, [this]{ return in_flight == 0; });
+  stop();
+  requested_threads = nthreads;
+  cpus = std::move(affinity);
+  start();
+  return true;
+}
+
+unsigned int pressio_thread_pool::nthreads() const {
+  return thread_count;
+}
+
+std::vector<int> pressio_thread_pool::affinity() const {
+  std::lock_guard<std::mutex> lock(config_mutex);
+  return cpus;
+}
+
+pressio_thread_pool::usage::usage(pressio_thread_pool& pool): pool(pool) {
+  pool.acquire();
+}
+
+pressio_thread_pool::usage::~usage() {
+  pool.release();
+}
+
+void pressio_thread_pool::acquire() {
+  std::lock_guard<std::mutex> lock(config_mutex);
+  ++in_flight;
+}
+
+void pressio_thread_pool::release() {
+  if(--in_flight == 0) {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    idle.notify_all();
+  }
+}
+
+void pressio_thread_pool::start() {
+  stopping = false;
+  const size_t nworkers = resolve_nthreads(requested_threads) - 1;
+  for (size_t id = 0; id < nworkers; ++id) {
+    queues.emplace_back(new task_queue);
+  }
+  for (size_t id = 0; id < nworkers; ++id) {
+    workers.emplace_back(&pressio_thread_pool::worker_loop, this, id);
+  }  thread_count = static_cast<unsigned int>(nworkers) + 1;
+}
+
+void pressio_thread_pool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) worker.join();
+  workers.clear();
+  queues.clear();
+}
+
+void pressio_thread_pool::submit(std::function<void()> task) {
+  usage in_use(*this);
+  if(queues.empty()) {
+    usage_scope scope;
+    task();
+    return;
+  }
+  const size_t id = (current_pool == this) ? current_worker : next_queue++ % queues.size();
+  //the queued task holds its own usage until it has run
+  acquire();
+  {
+    std::lock_guard<std::mutex> lock(queues[id]->mutex);
+    queues[id]->tasks.emplace_back([this, task]{
+      usage_scope scope;
+      task();
+      release();
+    });
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    ++pending;
+  }
+  wake.notify_one();
+}
+
+bool pressio_thread_pool::try_pop(size_t id, std::function<void()>& task) {
+  {
+    std::lock_guard<std::mutex> lock(queues[id]->mutex);
+    if(!queues[id]->tasks.empty()) {
+      task = std::move(queues[id]->tasks.back());
+      queues[id]->tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t offset = 1; offset < queues.size(); ++offset) {
+    auto& victim = *queues[(id + offset) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void pressio_thread_pool::worker_loop(size_t id) {
+  current_pool = this;
+  current_worker = id;
+  if(!cpus.empty()) pin_current_thread(cpus[id % cpus.size()]);
+
+  std::function<void()> task;
+  while(true) {
+    if(try_pop(id, task)) {
+      --pending;
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    wake.wait(lock, [this]{ return stopping || pending > 0; });
+    if(stopping && pending == 0) return;
+  }
+}
+
+void pressio_thread_pool::parallel_for(size_t begin, size_t end, size_t grain, std::function<void(size_t, size_t)> const& body) {
+  if(begin >= end) return;
+  usage in_use(*this);
+  usage_scope scope;
+  const size_t n = end - begin;
+  grain = std::max<size_t>(1, grain);
+  //a few chunks per thread balances uneven chunks without much scheduling overhead
+  const size_t max_chunks = static_cast<size_t>(nthreads()) * 4;
+  const size_t chunks = std::min((n + grain - 1) / grain, max_chunks);
+  if(chunks <= 1 || queues.empty()) {
+    body(begin, end);
+    return;
+  }
+
+  auto state = std::make_shared<loop_state>();
+  state->body = &body;
+  state->begin = begin;
+  state->end = end;
+  state->chunk_size = (n + chunks - 1) / chunks;
+  state->chunks = (n + state->chunk_size - 1) / state->chunk_size;
+
+  const size_t helpers = std::min(state->chunks - 1, queues.size());
+  for (size_t i = 0; i < helpers; ++i) {
+    submit([state]{ run_chunks(*state); });
+  }
+  run_chunks(*state);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&state]{ return state->done == state->chunks; });
+  if(state->error) std::rethrow_exception(state->error);
+}
+
+pressio_thread_budget& pressio_thread_budget::global() {
+  static pressio_thread_budget budget;
+  return budget;
+}
+
+pressio_thread_budget::scope::scope(pressio_thread_budget& budget): budget(budget_depth++ == 0 ? &budget : nullptr) {
+  if(this->budget) ++this->budget->active;
+}
+
+pressio_thread_budget::scope::~scope() {
+  --budget_depth;
+  if(budget) --budget->active;
+}
+
+void pressio_thread_budget::set_enabled(bool enabled) {
+  is_enabled = enabled;
+}
+
+bool pressio_thread_budget::enabled() const {
+  return is_enabled;
+}
+
+unsigned int pressio_thread_budget::total_threads() const {
+  return pressio_thread_pool::global().nthreads();
+}
+
+unsigned int pressio_thread_budget::outer() const {
+  return active;
+}
+
+unsigned int pressio_thread_budget::inner_threads() const {
+  return std::max(1u, total_threads() / std::max(1u, outer()));
+}
+
+bool pressio_parse_cpu_list(std::string const& list, std::vector<int>& cpus) {
+  cpus.clear();
+  std::istringstream ss(list);
+  std::string range;
+  while(std::getline(ss, range, ',')) {
+    if(range.empty()) continue;
+    int first, last;
+    char dash;
+    std::istringstream range_ss(range);
+    if(!(range_ss >> first) || first < 0) return false;
+    if(range_ss >> dash) {
+      if(dash != '-' || !(range_ss >> last) || last < first) return false;
+    } else {
+      last = first;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return true;
+}
+
+std::string pressio_format_cpu_list(std::vector<int> const& cpus) {
+  std::ostringstream ss;
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    if(i) ss << ',';
+    ss << cpus[i];
+  }
+  return ss.str();
+}
@@ -2,7 +2,19 @@
 python bindings for pressio
 */
 
-%module pressio
+%module(threads="1") pressio
+
+/*
+ * only the compute heavy calls release the GIL; everything else keeps it to
+ * avoid the overhead of releasing and acquiring it for trivial calls
+ */
+%nothread;
+%thread pressio_compressor_compress;
+%thread pressio_compressor_decompress;
+%thread pressio_compressor_get_metrics_results;
+%thread pressio_metrics_get_results;
+%thread pressio_io_read;
+%thread pressio_io_write;
 
 %{
 #define SWIG_FILE_WITH_INIT
@@ -15,6 +27,7 @@ python bindings for pressio
 #include "pressio_options.h"
 #include "pressio_options_iter.h"
 #include "pressio_data.h"
+#include "libpressio_ext/io/pressio_io.h"
 #include "pypressio.h"
 %}
 
@@ -38,6 +51,14 @@ import_array();
 %pointer_functions(double, double)
 %pointer_functions(float, float)
 
+%exception _pressio_io_data_from_numpy_nocopy {
+  $action
+  if(PyErr_Occurred()) SWIG_fail;
+}
+%exception _pressio_io_data_to_numpy_nocopy {
+  $action
+  if(PyErr_Occurred()) SWIG_fail;
+}
 %include "pypressio.h"
 
 %define pressio_numpy_type(type)
@@ -130,12 +151,27 @@ __pressio_to_numpy = {
   _pressio.int64_dtype : _pressio_io_data_to_numpy_int64_t,
 }
 
-def io_data_from_numpy(array):
+def io_data_from_numpy(array, copy=True):
+  """converts a numpy array to a pressio_data
+
+  if copy is False, the pressio_data refers to the memory of the array, which
+  must be C-contiguous and writable, and keeps the array alive until the
+  pressio_data is freed; read-only arrays raise BufferError
+  """
+  if not copy:
+    return _pressio_io_data_from_numpy_nocopy(array)
   length = len(array.shape)
   dtype = array.dtype
   return __pressio_from_numpy[length, dtype](array)
 
-def io_data_to_numpy(ptr):
+def io_data_to_numpy(ptr, copy=True):
+  """converts a pressio_data to a numpy array
+
+  if copy is False, the contents of ptr are moved into the returned array without
+  copying them; ptr is left empty but must still be freed
+  """
+  if not copy:
+    return numpy.asarray(_pressio_io_data_to_numpy_nocopy(ptr))
   num_dims = data_num_dimensions(ptr)
   dtype = data_dtype(ptr)
   dims = [data_get_dimension(ptr, i) for i in range(num_dims)]
@@ -158,3 +194,4 @@ def io_data_to_numpy(ptr):
 %include "pressio_option.h"
 %include "pressio_options.h"
 %include "pressio_options_iter.h"
+%include "libpressio_ext/io/pressio_io.h"
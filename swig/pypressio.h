@@ -4,6 +4,9 @@
 #include <vector>
 #include <cstdint>
 #include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
 
 namespace {
   template <class T>
@@ -55,6 +58,179 @@ std::vector<T> _pressio_io_data_to_numpy(pressio_data* ptr) {
       );
 }
 
+#ifndef SWIG
+namespace {
+  /**
+   * maps a struct module format character and item size from the buffer protocol to a pressio_dtype
+   * \returns false if the format is not supported
+   */
+  bool _pressio_dtype_from_format(const char* format, Py_ssize_t itemsize, pressio_dtype& dtype) {
+    if(format == nullptr) format = "B";
+    if(*format == '@' || *format == '=') ++format;
+#if PY_LITTLE_ENDIAN
+    else if(*format == '<') ++format;
+#else
+    else if(*format == '>' || *format == '!') ++format;
+#endif
+    if(format[0] == '\0' || format[1] != '\0') return false;
+
+    switch(format[0]) {
+      case 'f': if(itemsize != 4) return false; dtype = pressio_float_dtype; return true;
+      case 'd': if(itemsize != 8) return false; dtype = pressio_double_dtype; return true;
+      case 'b': case 'h': case 'i': case 'l': case 'q':
+        switch(itemsize) {
+          case 1: dtype = pressio_int8_dtype; return true;
+          case 2: dtype = pressio_int16_dtype; return true;
+          case 4: dtype = pressio_int32_dtype; return true;
+          case 8: dtype = pressio_int64_dtype; return true;
+          default: return false;
+        }
+      case 'B': case 'H': case 'I': case 'L': case 'Q':
+        switch(itemsize) {
+          case 1: dtype = pressio_uint8_dtype; return true;
+          case 2: dtype = pressio_uint16_dtype; return true;
+          case 4: dtype = pressio_uint32_dtype; return true;
+          case 8: dtype = pressio_uint64_dtype; return true;
+          default: return false;
+        }
+      default:
+        return false;
+    }
+  }
+
+  char* _pressio_format_from_dtype(pressio_dtype dtype) {
+    switch(dtype) {
+      case pressio_float_dtype: return const_cast<char*>("f");
+      case pressio_double_dtype: return const_cast<char*>("d");
+      case pressio_int8_dtype: return const_cast<char*>("b");
+      case pressio_int16_dtype: return const_cast<char*>("h");
+      case pressio_int32_dtype: return const_cast<char*>("i");
+      case pressio_int64_dtype: return const_cast<char*>("q");
+      case pressio_uint16_dtype: return const_cast<char*>("H");
+      case pressio_uint32_dtype: return const_cast<char*>("I");
+      case pressio_uint64_dtype: return const_cast<char*>("Q");
+      default: return const_cast<char*>("B");
+    }
+  }
+
+  /**
+   * releases the buffer, and with it the reference to the exporting object, held by a non-owning pressio_data
+   */
+  void _pressio_release_py_buffer(void*, void* metadata) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    Py_buffer* view = static_cast<Py_buffer*>(metadata);
+    PyBuffer_Release(view);
+    delete view;
+    PyGILState_Release(state);
+  }
+
+  /**
+   * a python object which owns a pressio_data and exports it via the buffer protocol
+   */
+  struct _pressio_data_buffer {
+    PyObject_HEAD
+    pressio_data* data;
+    std::vector<Py_ssize_t>* shape;
+    std::vector<Py_ssize_t>* strides;
+  };
+
+  int _pressio_data_buffer_getbuffer(PyObject* self, Py_buffer* view, int flags) {
+    auto buffer = reinterpret_cast<_pressio_data_buffer*>(self);
+    pressio_data* data = buffer->data;
+    const Py_ssize_t itemsize = static_cast<Py_ssize_t>(pressio_dtype_size(data->dtype()));
+    if(PyBuffer_FillInfo(view, self, data->data(), static_cast<Py_ssize_t>(data->size_in_bytes()), 0, flags) == -1) {
+      return -1;
+    }
+    //without PyBUF_FORMAT the consumer expects unsigned bytes, which PyBuffer_FillInfo already describes
+    if(not (flags & PyBUF_FORMAT)) return 0;
+    view->itemsize = itemsize;
+    view->format = _pressio_format_from_dtype(data->dtype());
+    if((flags & PyBUF_ND) == PyBUF_ND) {
+      view->ndim = static_cast<int>(buffer->shape->size());
+      view->shape = buffer->shape->data();
+    }
+    if((flags & PyBUF_STRIDES) == PyBUF_STRIDES) {
+      view->strides = buffer->strides->data();
+    }
+    return 0;
+  }
+
+  void _pressio_data_buffer_dealloc(PyObject* self) {
+    auto buffer = reinterpret_cast<_pressio_data_buffer*>(self);
+    delete buffer->data;
+    delete buffer->shape;
+    delete buffer->strides;
+    PyTypeObject* type = Py_TYPE(self);
+    type->tp_free(self);
+    Py_DECREF(type);
+  }
+
+  PyTypeObject* _pressio_data_buffer_type() {
+    static PyType_Slot slots[] = {
+      {Py_tp_dealloc, reinterpret_cast<void*>(_pressio_data_buffer_dealloc)},
+      {Py_bf_getbuffer, reinterpret_cast<void*>(_pressio_data_buffer_getbuffer)},
+      {0, nullptr},
+    };
+    static PyType_Spec spec = {
+      "pressio.data_buffer",
+      sizeof(_pressio_data_buffer),
+      0,
+      Py_TPFLAGS_DEFAULT,
+      slots
+    };
+    static PyObject* type = PyType_FromSpec(&spec);
+    return reinterpret_cast<PyTypeObject*>(type);
+  }
+}
+#endif
+
+/**
+ * wraps an object supporting the buffer protocol, such as a C-contiguous numpy array, without copying it
+ *
+ * the buffer must be writable since compressors and io plugins may write into it; a BufferError is raised otherwise.
+ * the returned pressio_data holds a reference to the object until it is freed
+ */
+pressio_data* _pressio_io_data_from_numpy_nocopy(PyObject* array) {
+  Py_buffer* view = new Py_buffer;
+  if(PyObject_GetBuffer(array, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE) == -1) {
+    delete view;
+    return nullptr;
+  }
+  pressio_dtype dtype;
+  if(not _pressio_dtype_from_format(view->format, view->itemsize, dtype)) {
+    PyErr_Format(PyExc_TypeError, "unsupported buffer format %s", view->format ? view->format : "B");
+    PyBuffer_Release(view);
+    delete view;
+    return nullptr;
+  }
+  std::vector<size_t> dims(view->shape, view->shape + view->ndim);
+  if(dims.empty()) dims.push_back(1);
+  return pressio_data_new_move(dtype, view->buf, dims.size(), dims.data(), _pressio_release_py_buffer, view);
+}
+
+/**
+ * moves the contents of ptr into a python object exporting them via the buffer protocol without copying them
+ *
+ * ptr is left empty, but must still be freed by the caller
+ */
+PyObject* _pressio_io_data_to_numpy_nocopy(pressio_data* ptr) {
+  PyTypeObject* type = _pressio_data_buffer_type();
+  if(type == nullptr) return nullptr;
+  auto buffer = PyObject_New(_pressio_data_buffer, type);
+  if(buffer == nullptr) return nullptr;
+
+  buffer->data = new pressio_data(std::move(*ptr));
+  auto const& dims = buffer->data->dimensions();
+  const Py_ssize_t itemsize = static_cast<Py_ssize_t>(pressio_dtype_size(buffer->data->dtype()));
+  buffer->shape = new std::vector<Py_ssize_t>(dims.begin(), dims.end());
+  buffer->strides = new std::vector<Py_ssize_t>(dims.size());
+  Py_ssize_t stride = itemsize;
+  for (size_t i = dims.size(); i > 0; --i) {
+    (*buffer->strides)[i-1] = stride;
+    stride *= static_cast<Py_ssize_t>(dims[i-1]);
+  }
+  return reinterpret_cast<PyObject*>(buffer);
+}
 
 struct pressio_data* data_new_empty(const pressio_dtype dtype, std::vector<uint64_t> dimensions) {
   return new pressio_data(pressio_data::empty(dtype, dimensions));
@@ -0,0 +1,186 @@
+#include <numeric>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "pressio_options.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+
+namespace {
+  const std::vector<pressio_dtype> numeric_dtypes {
+    pressio_double_dtype,
+    pressio_float_dtype,
+    pressio_uint8_dtype,
+    pressio_uint16_dtype,
+    pressio_uint32_dtype,
+    pressio_uint64_dtype,
+    pressio_int8_dtype,
+    pressio_int16_dtype,
+    pressio_int32_dtype,
+    pressio_int64_dtype,
+  };
+
+  pressio_data make_data(pressio_dtype dtype, std::vector<size_t> const& dims) {
+    auto data = pressio_data::owning(dtype, dims);
+    auto bytes = static_cast<unsigned char*>(data.data());
+    for (size_t i = 0; i < data.size_in_bytes(); ++i) {
+      bytes[i] = static_cast<unsigned char>(i * 31);
+    }
+    return data;
+  }
+
+  /** dimensions with roughly 4M elements for 1, 2, or 3 dimensions */
+  std::vector<size_t> dims_for(int64_t ndims) {
+    switch(ndims) {
+      case 1: return {1 << 22};
+      case 2: return {2048, 2048};
+      default: return {256, 256, 64};
+    }
+  }
+
+  pressio_options make_options(int64_t size) {
+    pressio_options options;
+    for (int64_t i = 0; i < size; ++i) {
+      const std::string key = "bench:key" + std::to_string(i);
+      switch(i % 3) {
+        case 0: options.set(key, static_cast<int>(i)); break;
+        case 1: options.set(key, static_cast<double>(i)); break;
+        default: options.set(key, std::to_string(i)); break;
+      }
+    }
+    return options;
+  }
+}
+
+/*
+ * select with args {ndims, stride, block}: every stride-th block of size block in each dimension
+ */
+static void BM_select(benchmark::State& state) {
+  const auto dims = dims_for(state.range(0));
+  const size_t stride = static_cast<size_t>(state.range(1));
+  const size_t block = static_cast<size_t>(state.range(2));
+  auto data = make_data(pressio_float_dtype, dims);
+  std::vector<size_t> start(dims.size(), 0), strides(dims.size(), stride), count, blocks(dims.size(), block);
+  for (auto dim : dims) count.push_back(dim / stride);
+
+  size_t selected = 0;
+  for (auto _ : state) {
+    auto result = data.select(start, strides, count, blocks);
+    selected = result.size_in_bytes();
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * selected));
+}
+BENCHMARK(BM_select)
+  ->ArgNames({"ndims", "stride", "block"})
+  ->Args({1, 1, 1})->Args({1, 2, 1})->Args({1, 8, 4})
+  ->Args({2, 1, 1})->Args({2, 2, 1})->Args({2, 8, 4})
+  ->Args({3, 1, 1})->Args({3, 2, 1})->Args({3, 8, 4});
+
+static void BM_cast(benchmark::State& state) {
+  const auto from = static_cast<pressio_dtype>(state.range(0));
+  const auto to = static_cast<pressio_dtype>(state.range(1));
+  auto data = make_data(from, {1 << 20});
+  for (auto _ : state) {
+    auto result = data.cast(to);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.num_elements()));
+}
+BENCHMARK(BM_cast)->ArgNames({"from", "to"})->Apply([](benchmark::internal::Benchmark* b) {
+  for (auto from : numeric_dtypes) {
+    for (auto to : numeric_dtypes) {
+      b->Args({from, to});
+    }
+  }
+});
+
+static void BM_clone(benchmark::State& state) {
+  auto data = make_data(pressio_byte_dtype, {static_cast<size_t>(state.range(0))});
+  for (auto _ : state) {
+    auto result = pressio_data::clone(data);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size_in_bytes()));
+}
+BENCHMARK(BM_clone)->RangeMultiplier(16)->Range(1 << 10, 1 << 26);
+
+static void BM_copy_constructor(benchmark::State& state) {
+  auto data = make_data(pressio_byte_dtype, {static_cast<size_t>(state.range(0))});
+  for (auto _ : state) {
+    pressio_data result(data);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size_in_bytes()));
+}
+BENCHMARK(BM_copy_constructor)->RangeMultiplier(16)->Range(1 << 10, 1 << 26);
+
+static void BM_for_each(benchmark::State& state) {
+  auto data = make_data(static_cast<pressio_dtype>(state.range(0)), {1 << 22});
+  for (auto _ : state) {
+    double sum = pressio_data_for_each<double>(data, [](auto begin, auto end) {
+        return std::accumulate(begin, end, 0.0);
+    });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.num_elements()));
+}
+BENCHMARK(BM_for_each)->ArgName("dtype")->Apply([](benchmark::internal::Benchmark* b) {
+  for (auto dtype : numeric_dtypes) b->Arg(dtype);
+});
+
+static void BM_options_set(benchmark::State& state) {
+  auto options = make_options(state.range(0));
+  int64_t i = 0;
+  for (auto _ : state) {
+    options.set("bench:key" + std::to_string(i++ % state.range(0)), 1.0);
+  }
+}
+BENCHMARK(BM_options_set)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_options_get(benchmark::State& state) {
+  const auto options = make_options(state.range(0));
+  //an integer key in the middle of the map
+  const std::string key = "bench:key" + std::to_string(state.range(0) / 6 * 3);
+  for (auto _ : state) {
+    int value = 0;
+    benchmark::DoNotOptimize(options.get(key, &value));
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_options_get)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_options_cast(benchmark::State& state) {
+  const auto options = make_options(state.range(0));
+  //a string key in the middle of the map
+  const std::string key = "bench:key" + std::to_string(state.range(0) / 6 * 3 + 2);
+  for (auto _ : state) {
+    double value = 0;
+    benchmark::DoNotOptimize(options.cast(key, &value, pressio_conversion_special));
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_options_cast)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_options_merge(benchmark::State& state) {
+  const auto lhs = make_options(state.range(0));
+  const auto rhs = make_options(state.range(0) * 2);
+  for (auto _ : state) {
+    auto merged = pressio_options_merge(&lhs, &rhs);
+    benchmark::DoNotOptimize(merged);
+    pressio_options_free(merged);
+  }
+}
+BENCHMARK(BM_options_merge)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_check_options(benchmark::State& state) {
+  pressio library;
+  auto compressor = library.get_compressor("noop");
+  auto options = compressor->get_options();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compressor->check_options(options));
+  }
+}
+BENCHMARK(BM_check_options);
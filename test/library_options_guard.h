@@ -0,0 +1,25 @@
+#ifndef LIBPRESSIO_TEST_LIBRARY_OPTIONS_GUARD_H
+#define LIBPRESSIO_TEST_LIBRARY_OPTIONS_GUARD_H
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+
+/*
+ * saves the library wide options such as the size of the global thread pool and
+ * restores them when it goes out of scope, so tests which change them do not
+ * leak their configuration into the tests which run after them
+ */
+class library_options_guard {
+  public:
+  explicit library_options_guard(pressio& library): library(library), saved(library.get_options()) {}
+  ~library_options_guard() {
+    library.set_options(saved);
+  }
+  library_options_guard(library_options_guard const&)=delete;
+  library_options_guard& operator=(library_options_guard const&)=delete;
+
+  private:
+  pressio& library;
+  pressio_options saved;
+};
+
+#endif /* end of include guard: LIBPRESSIO_TEST_LIBRARY_OPTIONS_GUARD_H */
@@ -0,0 +1,222 @@
+/*
+ * runs a fixed workload and compares its throughput against a stored baseline
+ *
+ * usage: perf_regression -b baseline [-t tolerance] [-u] [-o key=value ...] workload
+ *
+ * workloads are compress:<compressor id>, select, cast, or metrics.  The
+ * baseline is a text file with one "workload throughput" pair per line.  When
+ * -u is passed or PRESSIO_PERF_REBASELINE is set in the environment, the
+ * measured throughput replaces the stored value instead of being checked.
+ *
+ * exits with 0 on success, 1 on a regression or error, and 77 (skipped) when
+ * the baseline has no entry for the workload.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/io.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "pressio_tools.h"
+
+namespace {
+  const int skipped = 77;
+  const double min_seconds = 0.5;
+  const int min_repetitions = 3;
+
+  struct workload_error {
+    std::string msg;
+  };
+
+  pressio_data make_input(pressio& library) {
+    auto io = library.get_io("synthetic");
+    io->set_options({{"synthetic:seed", 0u}});
+    //read takes ownership of the template
+    size_t dims[] = {128, 128, 64};
+    pressio_data* data = io->read(pressio_data_new_empty(pressio_double_dtype, 3, dims));
+    if(data == nullptr) throw workload_error{io->error_msg()};
+    pressio_data input(std::move(*data));
+    pressio_data_free(data);
+    return input;
+  }
+
+  /**
+   * repeats an operation which processes bytes bytes until it has run for at
+   * least min_seconds
+   * \returns the best observed throughput in MB/s
+   */
+  double measure(std::function<void()> const& operation, size_t bytes) {
+    using clock = std::chrono::steady_clock;
+    double best = 0, total = 0;
+    for (int repetition = 0; repetition < min_repetitions || total < min_seconds; ++repetition) {
+      auto begin = clock::now();
+      operation();
+      double seconds = std::chrono::duration<double>(clock::now() - begin).count();
+      total += seconds;
+      if(seconds > 0) best = std::max(best, static_cast<double>(bytes) / seconds / 1e6);
+    }
+    return best;
+  }
+
+  std::shared_ptr<libpressio_compressor_plugin> make_compressor(pressio& library, std::string const& id,
+      std::vector<std::pair<std::string, std::string>> const& settings) {
+    auto compressor = library.get_compressor(id);
+    if(not compressor) throw workload_error{"compressor " + id + " is not available"};
+    auto options = compressor->get_options();
+    std::string error;
+    if(not apply_settings(options, settings, error)) throw workload_error{error};
+    if(compressor->set_options(options)) throw workload_error{compressor->error_msg()};
+    return compressor;
+  }
+
+  void round_trip(libpressio_compressor_plugin& compressor, pressio_data const& input) {
+    auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+    auto decompressed = pressio_data::owning(input.dtype(), input.dimensions());
+    if(compressor.compress(&input, &compressed) || compressor.decompress(&compressed, &decompressed)) {
+      throw workload_error{compressor.error_msg()};
+    }
+  }
+
+  double run_workload(std::string const& workload, std::vector<std::pair<std::string, std::string>> const& settings) {
+    pressio library;
+    auto input = make_input(library);
+    const size_t bytes = input.size_in_bytes();
+    const std::string compress_prefix = "compress:";
+
+    if(workload.compare(0, compress_prefix.size(), compress_prefix) == 0) {
+      auto compressor = make_compressor(library, workload.substr(compress_prefix.size()), settings);
+      return measure([&]{ round_trip(*compressor, input); }, bytes);
+    } else if(workload == "metrics") {
+      auto compressor = make_compressor(library, "noop", settings);
+      const std::vector<std::string> ids{"size", "error_stat", "pearson"};
+      pressio_metrics metrics(library.get_metrics(ids.begin(), ids.end()));
+      if(not metrics) throw workload_error{library.err_msg()};
+      compressor->set_metrics(metrics);
+      return measure([&]{ round_trip(*compressor, input); }, bytes);
+    } else if(workload == "select") {
+      const auto dims = input.dimensions();
+      std::vector<size_t> start(dims.size(), 0), stride(dims.size(), 2), count, block(dims.size(), 1);
+      for (auto dim : dims) count.push_back(dim / 2);
+      return measure([&]{ auto selected = input.select(start, stride, count, block); }, bytes);
+    } else if(workload == "cast") {
+      return measure([&]{ auto casted = input.cast(pressio_float_dtype); }, bytes);
+    }
+    throw workload_error{"unknown workload " + workload};
+  }
+
+  std::map<std::string, double> read_baseline(std::string const& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while(std::getline(in, line)) {
+      if(line.empty() || line[0] == '#') continue;
+      std::istringstream fields(line);
+      std::string workload;
+      double throughput;
+      if(fields >> workload >> throughput) baseline[workload] = throughput;
+    }
+    return baseline;
+  }
+
+  bool write_baseline(std::string const& path, std::map<std::string, double> const& baseline) {
+    std::ofstream out(path);
+    out << "# workload throughput_mb_per_second\n";
+    for (auto const& entry : baseline) {
+      out << entry.first << ' ' << entry.second << '\n';
+    }
+    return static_cast<bool>(out);
+  }
+
+  void usage() {
+    std::cerr << "usage: perf_regression -b baseline [-t tolerance] [-u] [-o key=value ...] workload\n"
+      << "  -b file         the baseline file\n"
+      << "  -t tolerance    the allowed fractional slowdown, default 0.25\n"
+      << "  -u              store the measured throughput as the new baseline\n"
+      << "  -o key=value    an option for the compressor\n"
+      << "workloads: compress:<compressor id>, select, cast, metrics\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::string baseline_path;
+  double tolerance = 0.25;
+  bool rebaseline = std::getenv("PRESSIO_PERF_REBASELINE") != nullptr;
+  std::vector<std::pair<std::string, std::string>> settings;
+
+  int opt;
+  while((opt = getopt(argc, argv, "b:t:uo:h")) != -1) {
+    std::pair<std::string, std::string> kv;
+    switch(opt) {
+      case 'b':
+        baseline_path = optarg;
+        break;
+      case 't':
+        tolerance = std::atof(optarg);
+        break;
+      case 'u':
+        rebaseline = true;
+        break;
+      case 'o':
+        if(not parse_key_value(optarg, kv)) {
+          std::cerr << "invalid option " << optarg << std::endl;
+          return 1;
+        }
+        settings.emplace_back(std::move(kv));
+        break;
+      case 'h':
+      default:
+        usage();
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if(baseline_path.empty() || optind + 1 != argc) {
+    usage();
+    return 1;
+  }
+  const std::string workload = argv[optind];
+
+  auto baseline = read_baseline(baseline_path);
+  auto expected = baseline.find(workload);
+  if(not rebaseline && expected == baseline.end()) {
+    std::cout << workload << ": no baseline in " << baseline_path << std::endl;
+    return skipped;
+  }
+
+  double throughput;
+  try {
+    throughput = run_workload(workload, settings);
+  } catch (workload_error const& e) {
+    std::cerr << workload << ": " << e.msg << std::endl;
+    return 1;
+  }
+
+  if(rebaseline) {
+    baseline[workload] = throughput;
+    if(not write_baseline(baseline_path, baseline)) {
+      std::cerr << "failed to write " << baseline_path << std::endl;
+      return 1;
+    }
+    std::cout << workload << ": stored " << throughput << " MB/s" << std::endl;
+    return 0;
+  }
+
+  const double ratio = throughput / expected->second;
+  std::cout << workload << ": " << throughput << " MB/s, baseline " << expected->second
+    << " MB/s (" << ratio << "x)" << std::endl;
+  if(ratio < 1.0 - tolerance) {
+    std::cerr << workload << " regressed beyond the tolerance of " << tolerance << std::endl;
+    return 1;
+  }
+  return 0;
+}
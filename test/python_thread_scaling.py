@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+measures how compression throughput scales with python threads
+
+usage: python_thread_scaling.py <path to swig module> [compressor] [key=value ...]
+
+each thread compresses with its own clone of the compressor; since the
+bindings release the GIL while compressing, throughput should scale with the
+number of threads for thread safe compressors such as zfp or blosc
+"""
+
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+#kind of ugly hack to load the path to the library without installing it
+pressio_path = sys.argv[1]
+sys.path.insert(0, pressio_path)
+
+import numpy as np
+np.random.seed(0)
+
+import pressio
+
+compressor_id = sys.argv[2] if len(sys.argv) > 2 else "zfp"
+settings = dict(arg.split("=", 1) for arg in sys.argv[3:])
+if compressor_id == "zfp" and not settings:
+  settings = {"zfp:accuracy": "1e-3"}
+
+library = pressio.instance()
+compressor = pressio.get_compressor(library, compressor_id.encode())
+if compressor is None:
+  print("compressor", compressor_id, "is not available", file=sys.stderr)
+  sys.exit(77)
+
+options = pressio.compressor_get_options(compressor)
+for key, value in settings.items():
+  if "." in value or "e" in value:
+    pressio.options_set_double(options, key.encode(), float(value))
+  else:
+    pressio.options_set_integer(options, key.encode(), int(value))
+if pressio.compressor_set_options(compressor, options):
+  print(pressio.compressor_error_msg(compressor), file=sys.stderr)
+  sys.exit(1)
+
+data = np.random.rand(64, 64, 64)
+input_data = pressio.io_data_from_numpy(data, copy=False)
+tasks_per_thread = 8
+
+def compress_many(count):
+  local = pressio.compressor_clone(compressor)
+  for _ in range(count):
+    output = pressio.data_new_empty(pressio.byte_dtype, pressio.vector_uint64_t())
+    if pressio.compressor_compress(local, input_data, output):
+      raise RuntimeError(pressio.compressor_error_msg(local))
+    pressio.data_free(output)
+  pressio.compressor_release(local)
+
+print("threads,seconds,MB/s,speedup")
+baseline = None
+for threads in [1, 2, 4, 8]:
+  with ThreadPoolExecutor(max_workers=threads) as pool:
+    begin = time.perf_counter()
+    list(pool.map(compress_many, [tasks_per_thread] * threads))
+    elapsed = time.perf_counter() - begin
+  throughput = threads * tasks_per_thread * data.nbytes / elapsed / 1e6
+  baseline = baseline or throughput
+  print("{},{:.3f},{:.1f},{:.2f}".format(threads, elapsed, throughput, throughput / baseline))
+
+pressio.data_free(input_data)
+pressio.compressor_release(compressor)
@@ -0,0 +1,86 @@
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+
+TEST(BloscPluginTests, FramedChunksAndRegions) {
+  pressio library;
+  auto compressor = library.get_compressor("blosc");
+  ASSERT_TRUE(compressor);
+
+  //chunks of 1000 bytes are rounded down to 250 values, leaving a partial last chunk
+  ASSERT_EQ(compressor->set_options({{"blosc:framed", 1}, {"blosc:chunk_size", 1001u}}), 0);
+  const std::vector<size_t> dims{100, 27};
+  auto input = pressio_data::owning(pressio_int32_dtype, dims);
+  auto ptr = static_cast<int32_t*>(input.data());
+  std::iota(ptr, ptr + input.num_elements(), 0);
+  auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+  auto output = pressio_data::owning(pressio_int32_dtype, dims);
+  ASSERT_EQ(compressor->compress(&input, &compressed), 0) << compressor->error_msg();
+  ASSERT_EQ(compressor->decompress(&compressed, &output), 0) << compressor->error_msg();
+  EXPECT_EQ(output.dimensions(), dims);
+  EXPECT_EQ(memcmp(input.data(), output.data(), input.size_in_bytes()), 0);
+
+  uint64_t chunks = 0;
+  memcpy(&chunks, compressed.data(), sizeof(chunks));
+  EXPECT_EQ(chunks, 11u);
+
+  //a region spanning a partial chunk, two whole chunks, and another partial chunk
+  ASSERT_EQ(compressor->set_options({
+        {"blosc:region_start", pressio_data{240ul}},
+        {"blosc:region_count", pressio_data{600ul}}
+        }), 0);
+  auto region = pressio_data::owning(pressio_int32_dtype, dims);
+  ASSERT_EQ(compressor->decompress(&compressed, &region), 0) << compressor->error_msg();
+  ASSERT_EQ(region.dimensions(), std::vector<size_t>{600});
+  EXPECT_EQ(memcmp(region.data(), ptr + 240, region.size_in_bytes()), 0);
+
+  ASSERT_EQ(compressor->set_options({{"blosc:region_start", pressio_data{2500ul}}}), 0);
+  EXPECT_NE(compressor->decompress(&compressed, &region), 0);
+
+  auto truncated = pressio_data::owning(pressio_byte_dtype, {16});
+  memset(truncated.data(), 0, truncated.size_in_bytes());
+  EXPECT_NE(compressor->decompress(&truncated, &output), 0);
+}
+
+TEST(BloscPluginTests, IncompressibleChunksStoredRaw) {
+  pressio library;
+  auto compressor = library.get_compressor("blosc");
+  ASSERT_TRUE(compressor);
+  ASSERT_EQ(compressor->set_options({
+        {"blosc:framed", 1},
+        {"blosc:chunk_size", 1u << 16},
+        {"blosc:min_estimated_ratio", 1.05}
+        }), 0);
+
+  //the first half is smooth and the second half is noise
+  auto input = pressio_data::owning(pressio_uint32_dtype, {1u << 16});
+  auto ptr = static_cast<uint32_t*>(input.data());
+  std::mt19937 gen(0);
+  for (size_t i = 0; i < input.num_elements(); ++i) {
+    ptr[i] = (i < input.num_elements() / 2) ? static_cast<uint32_t>(i) : static_cast<uint32_t>(gen());
+  }
+  auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+  auto output = pressio_data::owning(pressio_uint32_dtype, {1u << 16});
+  ASSERT_EQ(compressor->compress(&input, &compressed), 0) << compressor->error_msg();
+  ASSERT_EQ(compressor->decompress(&compressed, &output), 0) << compressor->error_msg();
+  EXPECT_EQ(memcmp(input.data(), output.data(), input.size_in_bytes()), 0);
+
+  //the index holds 3 values, 5 offsets, then a flag per chunk
+  std::vector<uint64_t> flags(4);
+  memcpy(flags.data(), static_cast<uint64_t*>(compressed.data()) + 8, sizeof(uint64_t) * flags.size());
+  EXPECT_EQ(flags, (std::vector<uint64_t>{0, 0, 1, 1}));
+
+  ASSERT_EQ(compressor->set_options({
+        {"blosc:region_start", pressio_data{40000ul}},
+        {"blosc:region_count", pressio_data{100ul}}
+        }), 0);
+  auto region = pressio_data::owning(pressio_uint32_dtype, {1u << 16});
+  ASSERT_EQ(compressor->decompress(&compressed, &region), 0) << compressor->error_msg();
+  EXPECT_EQ(memcmp(region.data(), ptr + 40000, region.size_in_bytes()), 0);
+}
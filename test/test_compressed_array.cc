@@ -0,0 +1,216 @@
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "libpressio_ext/cpp/compressed_array.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "pressio_compressor.h"
+#include "gtest/gtest.h"
+
+namespace {
+  pressio_data iota_data(std::vector<size_t> const& dims) {
+    auto data = pressio_data::owning(pressio_int32_dtype, dims);
+    auto ptr = static_cast<int32_t*>(data.data());
+    std::iota(ptr, ptr + data.num_elements(), 0);
+    return data;
+  }
+
+  /*
+   * a copying compressor which reports itself as serialized and records
+   * whether any two of its instances were ever called at the same time
+   */
+  std::atomic<int> serialized_active{0};
+  std::atomic<bool> serialized_overlapped{false};
+
+  class serialized_compressor_plugin: public libpressio_compressor_plugin {
+    public:
+    struct pressio_options get_configuration_impl() const override {
+      struct pressio_options options;
+      options.set("pressio:thread_safe", static_cast<int>(pressio_thread_safety_serialized));
+      return options;
+    }
+    struct pressio_options get_options_impl() const override { return {}; }
+    int set_options_impl(struct pressio_options const&) override { return 0; }
+    int compress_impl(const pressio_data *input, struct pressio_data* output) override {
+      return copy(input, output);
+    }
+    int decompress_impl(const pressio_data *input, struct pressio_data* output) override {
+      return copy(input, output);
+    }
+    int major_version() const override { return 0; }
+    int minor_version() const override { return 0; }
+    int patch_version() const override { return 0; }
+    const char* version() const override { return "0.0.0"; }
+    const char* prefix() const override { return "serialized"; }
+    std::shared_ptr<libpressio_compressor_plugin> clone() override {
+      return std::make_shared<serialized_compressor_plugin>(*this);
+    }
+
+    private:
+    int copy(const pressio_data *input, struct pressio_data* output) {
+      if(serialized_active++ != 0) serialized_overlapped = true;
+      std::this_thread::yield();
+      *output = pressio_data::clone(*input);
+      serialized_active--;
+      return 0;
+    }
+  };
+
+  /*
+   * a copying compressor whose compressions fail while compress_fails is set
+   */
+  std::atomic<bool> compress_fails{false};
+
+  class failing_compressor_plugin: public serialized_compressor_plugin {
+    public:
+    int compress_impl(const pressio_data *input, struct pressio_data* output) override {
+      if(compress_fails) return set_error(1, "compression failed");
+      return serialized_compressor_plugin::compress_impl(input, output);
+    }
+    const char* prefix() const override { return "failing"; }
+    std::shared_ptr<libpressio_compressor_plugin> clone() override {
+      return std::make_shared<failing_compressor_plugin>(*this);
+    }
+  };
+}
+
+TEST(PressioCompressedArrayTests, ReadWriteThroughSmallCache) {
+  pressio library;
+  const std::vector<size_t> dims{13, 7, 5};
+  //blocks of 4x4x4 int32 are 256 bytes; the cache holds two of them
+  pressio_compressed_array array(pressio_int32_dtype, dims, {4, 4, 4}, library.get_compressor("noop"), 512);
+
+  int32_t value = -1;
+  ASSERT_EQ(array.get({12, 6, 4}, &value), 0);
+  EXPECT_EQ(value, 0);
+  EXPECT_EQ(array.compressed_size(), 0u);
+
+  auto input = iota_data(dims);
+  ASSERT_EQ(array.assign(input), 0) << array.error_msg();
+  EXPECT_EQ(array.compressed_size(), input.size_in_bytes());
+
+  ASSERT_EQ(array.set({1, 2, 3}, int32_t{-5}), 0);
+  ASSERT_EQ(array.set({12, 6, 4}, int32_t{-7}), 0);
+  EXPECT_LE(array.cached_bytes(), array.cache_size());
+
+  auto patch = pressio_data::owning(pressio_int32_dtype, {6, 3, 2});
+  std::fill_n(static_cast<int32_t*>(patch.data()), patch.num_elements(), 100);
+  ASSERT_EQ(array.write({2, 3, 1}, patch), 0);
+
+  //every block is touched so the modified blocks must have been written back
+  pressio_data output;
+  ASSERT_EQ(array.to_data(&output), 0) << array.error_msg();
+  ASSERT_EQ(output.dimensions(), dims);
+  auto expected = static_cast<int32_t*>(input.data());
+  expected[1 + 13 * (2 + 7 * 3)] = -5;
+  expected[12 + 13 * (6 + 7 * 4)] = -7;
+  for (size_t k = 1; k < 3; ++k)
+    for (size_t j = 3; j < 6; ++j)
+      for (size_t i = 2; i < 8; ++i)
+        expected[i + 13 * (j + 7 * k)] = 100;
+  auto actual = static_cast<int32_t*>(output.data());
+  for (size_t i = 0; i < input.num_elements(); ++i) {
+    ASSERT_EQ(actual[i], expected[i]) << i;
+  }
+
+  pressio_data region;
+  ASSERT_EQ(array.read({3, 1, 2}, {9, 5, 2}, &region), 0);
+  EXPECT_EQ(region.dimensions(), (std::vector<size_t>{9, 5, 2}));
+  EXPECT_EQ(static_cast<int32_t*>(region.data())[0], expected[3 + 13 * (1 + 7 * 2)]);
+
+  EXPECT_NE(array.read({10, 0, 0}, {4, 1, 1}, &region), 0);
+  double wrong_type;
+  EXPECT_NE(array.get({0, 0, 0}, &wrong_type), 0);
+
+  ASSERT_EQ(array.set_cache_size(0), 0);
+  EXPECT_EQ(array.cached_bytes(), 0u);
+  ASSERT_EQ(array.get({1, 2, 3}, &value), 0);
+  EXPECT_EQ(value, -5);
+}
+
+TEST(PressioCompressedArrayTests, ConcurrentWrites) {
+  pressio library;
+  const size_t nthreads = 4, rows = 8, columns = 64;
+  pressio_compressed_array array(pressio_int32_dtype, {columns, rows * nthreads}, {16, 4},
+      library.get_compressor("noop"), 4 * 16 * 4 * sizeof(int32_t));
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&array, t] {
+      for (size_t j = t * rows; j < (t + 1) * rows; ++j) {
+        for (size_t i = 0; i < columns; ++i) {
+          array.set({i, j}, static_cast<int32_t>(i + columns * j));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  ASSERT_EQ(array.flush(), 0);
+
+  pressio_data output;
+  ASSERT_EQ(array.to_data(&output), 0);
+  auto expected = iota_data({columns, rows * nthreads});
+  EXPECT_EQ(memcmp(output.data(), expected.data(), output.size_in_bytes()), 0);
+}
+
+TEST(PressioCompressedArrayTests, SerializedCompressorsAreNeverConcurrent) {
+  const size_t nthreads = 4, rows = 8, columns = 64;
+  const std::vector<size_t> dims{columns, rows * nthreads};
+  pressio_compressed_array array(pressio_int32_dtype, dims, {16, 4},
+      std::make_shared<serialized_compressor_plugin>(), 4 * 16 * 4 * sizeof(int32_t));
+
+  auto input = iota_data(dims);
+  ASSERT_EQ(array.assign(input), 0) << array.error_msg();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&array, t] {
+      for (size_t j = t * rows; j < (t + 1) * rows; ++j) {
+        for (size_t i = 0; i < columns; ++i) {
+          array.set({i, j}, static_cast<int32_t>(i + columns * j));
+        }
+      }
+      pressio_data region;
+      array.read({0, 0}, {columns, rows * nthreads}, &region);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  ASSERT_EQ(array.flush(), 0);
+
+  pressio_data output;
+  ASSERT_EQ(array.to_data(&output), 0);
+  EXPECT_EQ(memcmp(output.data(), input.data(), output.size_in_bytes()), 0);
+  EXPECT_FALSE(serialized_overlapped);
+}
+
+TEST(PressioCompressedArrayTests, FailedWriteBacksKeepModifiedBlocks) {
+  const std::vector<size_t> dims{64, 32};
+  const size_t block_bytes = 16 * 4 * sizeof(int32_t);
+  pressio_compressed_array array(pressio_int32_dtype, dims, {16, 4},
+      std::make_shared<failing_compressor_plugin>(), 4 * block_bytes);
+
+  auto input = iota_data(dims);
+  auto values = static_cast<int32_t*>(input.data());
+  ASSERT_EQ(array.write({0, 0}, input), 0) << array.error_msg();
+  compress_fails = true;
+  EXPECT_NE(array.set_cache_size(block_bytes), 0);
+  EXPECT_GT(array.cached_bytes(), block_bytes);
+  //accesses still succeed while the blocks they evict cannot be written back
+  EXPECT_EQ(array.set({0, 31}, int32_t{-1}), 0) << array.error_msg();
+  values[64 * 31] = -1;
+  //a block larger than the cache is kept until it has been written back
+  EXPECT_NE(array.set_cache_size(0), 0);
+  EXPECT_NE(array.set({1, 0}, int32_t{-2}), 0);
+  values[1] = -2;
+  compress_fails = false;
+
+  ASSERT_EQ(array.flush(), 0) << array.error_msg();
+  ASSERT_EQ(array.set_cache_size(0), 0) << array.error_msg();
+  EXPECT_EQ(array.cached_bytes(), 0u);
+  pressio_data output;
+  ASSERT_EQ(array.to_data(&output), 0);
+  EXPECT_EQ(memcmp(output.data(), input.data(), output.size_in_bytes()), 0);
+}
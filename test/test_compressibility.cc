@@ -0,0 +1,31 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "libpressio_ext/cpp/compressibility.h"
+#include "gtest/gtest.h"
+
+TEST(PressioCompressibilityTests, SeparatesNoiseFromStructure) {
+  std::mt19937 gen(42);
+  std::vector<uint8_t> noise(1 << 20);
+  for (auto& byte : noise) byte = static_cast<uint8_t>(gen());
+  EXPECT_GT(pressio_estimate_entropy(noise.data(), noise.size(), 1), 7.9);
+  EXPECT_LT(pressio_estimate_compression_ratio(noise.data(), noise.size(), 1), 1.02);
+
+  std::vector<uint8_t> constant(1 << 20, 7);
+  EXPECT_EQ(pressio_estimate_entropy(constant.data(), constant.size(), 1), 0.0);
+
+  //small integers have constant high bytes, which the per-position histograms expose
+  std::vector<uint32_t> counters(1 << 18);
+  for (auto& counter : counters) counter = gen() % 256;
+  const size_t bytes = counters.size() * sizeof(uint32_t);
+  EXPECT_NEAR(pressio_estimate_entropy(counters.data(), bytes, sizeof(uint32_t), 0), 2.0, 0.01);
+  EXPECT_GT(pressio_estimate_compression_ratio(counters.data(), bytes, sizeof(uint32_t)), 3.9);
+
+  //the sample only reads the requested number of bytes spread over the buffer
+  std::vector<uint8_t> halves(1 << 20, 0);
+  for (size_t i = halves.size() / 2; i < halves.size(); ++i) halves[i] = static_cast<uint8_t>(gen());
+  const double sampled = pressio_estimate_entropy(halves.data(), halves.size(), 1, 4096);
+  EXPECT_GT(sampled, 4.0);
+  EXPECT_LT(sampled, 5.5);
+  EXPECT_EQ(pressio_estimate_entropy(halves.data(), 0, 1), 0.0);
+}
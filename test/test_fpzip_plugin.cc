@@ -0,0 +1,42 @@
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "library_options_guard.h"
+
+TEST(FpzipPluginTests, ParallelSlabs) {
+  pressio library;
+  library_options_guard guard(library);
+  //one slab per thread
+  ASSERT_EQ(library.set_options({{"pressio:nthreads", 4u}}), 0);
+  auto compressor = library.get_compressor("fpzip");
+  ASSERT_TRUE(compressor);
+
+  //several fields, one slab per thread, and explicit slab sizes with a partial last slab
+  const std::vector<std::vector<size_t>> shapes{{20, 15, 6, 3}, {20, 15, 9}, {20, 15, 9}};
+  const std::vector<unsigned int> slab_sizes{0, 0, 4};
+  for (size_t s = 0; s < shapes.size(); ++s) {
+    ASSERT_EQ(compressor->set_options({{"fpzip:parallel", 1}, {"fpzip:slab_size", slab_sizes[s]}}), 0);
+    auto input = pressio_data::owning(pressio_float_dtype, shapes[s]);
+    auto ptr = static_cast<float*>(input.data());
+    std::iota(ptr, ptr + input.num_elements(), 0.25f);
+    auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+    auto output = pressio_data::owning(pressio_float_dtype, shapes[s]);
+    ASSERT_EQ(compressor->compress(&input, &compressed), 0) << compressor->error_msg();
+    ASSERT_EQ(compressor->decompress(&compressed, &output), 0) << compressor->error_msg();
+    EXPECT_EQ(memcmp(input.data(), output.data(), input.size_in_bytes()), 0) << s;
+
+    uint64_t slabs = 0;
+    memcpy(&slabs, compressed.data(), sizeof(slabs));
+    EXPECT_EQ(slabs, 3u) << s;
+  }
+
+  auto truncated = pressio_data::owning(pressio_byte_dtype, {16});
+  memset(truncated.data(), 0, truncated.size_in_bytes());
+  auto output = pressio_data::owning(pressio_float_dtype, shapes[1]);
+  EXPECT_NE(compressor->decompress(&truncated, &output), 0);
+}
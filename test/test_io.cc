@@ -1,7 +1,13 @@
+#include <cstring>
 #include <vector>
+#include <algorithm>
 #include <numeric>
+#include <set>
+#include <thread>
+#include <atomic>
 #include "libpressio_ext/io/pressio_io.h"
 #include "libpressio_ext/io/posix.h"
+#include "libpressio_ext/cpp/data.h"
 #include "libpressio_ext/cpp/io.h"
 #include "libpressio_ext/cpp/pressio.h"
 #include "libpressio_ext/cpp/options.h"
@@ -259,6 +265,155 @@ TEST_F(PressioDataIOTests, TestWrite) {
   unlink(tmpwrite_name.data());
 }
 
+TEST_F(PressioDataIOTests, TestReadWriteOffsetByteOrder) {
+  size_t sizes[] = {2,3};
+  auto data = pressio_data_new_owning(pressio_int32_dtype, 2, sizes);
+  int* buffer = static_cast<int*>(pressio_data_ptr(data, nullptr));
+  std::iota(buffer, buffer + pressio_data_num_elements(data), 1);
+  auto tmpwrite_name = std::string("test_io_readXXXXXX");
+  auto tmpwrite_fd = mkstemp(const_cast<char*>(tmpwrite_name.data()));
+  const char header[] = "HEADER!";
+  ASSERT_EQ(write(tmpwrite_fd, header, sizeof(header)), static_cast<ssize_t>(sizeof(header)));
+  close(tmpwrite_fd);
+
+  auto io = pressio_get_io(&library, "posix");
+  (*io)->set_options({
+      {"io:path", tmpwrite_name},
+      {"io:offset", 8u},
+      {"io:byte_order", std::string("big")},
+  });
+  EXPECT_EQ(pressio_io_write(io, data), 0);
+
+  //the header in front of the payload survives the write
+  char written_header[sizeof(header)] = {};
+  FILE* written = fopen(tmpwrite_name.c_str(), "r");
+  ASSERT_NE(written, nullptr);
+  EXPECT_EQ(fread(written_header, 1, sizeof(written_header), written), sizeof(written_header));
+  fclose(written);
+  EXPECT_STREQ(written_header, header);
+
+  //reading with the same layout recovers the original values
+  auto read = pressio_io_read(io, pressio_data_new_empty(pressio_int32_dtype, 2, sizes));
+  ASSERT_NE(read, nullptr);
+  EXPECT_EQ(memcmp(pressio_data_ptr(read, nullptr), buffer, pressio_data_get_bytes(data)), 0);
+  pressio_data_free(read);
+
+  //reading the big endian values directly requires swapping them
+  (*io)->set_options({
+      {"io:path", tmpwrite_name},
+      {"io:byte_order", std::string("native")},
+  });
+  read = pressio_io_read(io, pressio_data_new_empty(pressio_int32_dtype, 2, sizes));
+  ASSERT_NE(read, nullptr);
+  uint32_t* read_buffer = static_cast<uint32_t*>(pressio_data_ptr(read, nullptr));
+  const uint32_t first = 1;
+  const bool little_endian = *reinterpret_cast<const uint8_t*>(&first) == 1;
+  EXPECT_EQ(read_buffer[0], little_endian ? __builtin_bswap32(1u) : 1u);
+  pressio_data_free(read);
+
+  EXPECT_NE((*io)->set_options({{"io:byte_order", std::string("middle")}}), 0);
+
+  pressio_data_free(data);
+  pressio_io_free(io);
+  unlink(tmpwrite_name.data());
+}
+
+TEST_F(PressioDataIOTests, TestReadRecords) {
+  //read the even integers as records of one int every two ints
+  auto io = pressio_get_io(&library, "posix");
+  (*io)->set_options({
+      {"io:file_descriptor", tmp_fd},
+      {"posix:record_size", static_cast<unsigned int>(sizeof(int))},
+      {"posix:record_stride", static_cast<unsigned int>(2 * sizeof(int))},
+  });
+  auto read = pressio_io_read(io, nullptr);
+  ASSERT_NE(read, nullptr);
+  EXPECT_EQ(pressio_data_get_bytes(read), 3 * sizeof(int));
+  int* read_buffer = static_cast<int*>(pressio_data_ptr(read, nullptr));
+  EXPECT_EQ(read_buffer[0], 0);
+  EXPECT_EQ(read_buffer[1], 2);
+  EXPECT_EQ(read_buffer[2], 4);
+  pressio_data_free(read);
+
+  //skip the first integer and read the odd ones into a typed buffer
+  lseek(tmp_fd, 0, SEEK_SET);
+  (*io)->set_options({
+      {"io:file_descriptor", tmp_fd},
+      {"io:offset", static_cast<unsigned int>(sizeof(int))},
+  });
+  size_t sizes[] = {3};
+  read = pressio_io_read(io, pressio_data_new_empty(pressio_int32_dtype, 1, sizes));
+  ASSERT_NE(read, nullptr);
+  read_buffer = static_cast<int*>(pressio_data_ptr(read, nullptr));
+  EXPECT_EQ(read_buffer[0], 1);
+  EXPECT_EQ(read_buffer[1], 3);
+  EXPECT_EQ(read_buffer[2], 5);
+  pressio_data_free(read);
+  pressio_io_free(io);
+}
+
+TEST_F(PressioDataIOTests, TestWriteRecords) {
+  //replace the even integers, leaving the odd ones between the records
+  auto io = pressio_get_io(&library, "posix");
+  (*io)->set_options({
+      {"io:path", tmp_name},
+      {"posix:record_size", static_cast<unsigned int>(sizeof(int))},
+      {"posix:record_stride", static_cast<unsigned int>(2 * sizeof(int))},
+  });
+  auto values = pressio_data::owning(pressio_int32_dtype, {3});
+  std::iota(static_cast<int*>(values.data()), static_cast<int*>(values.data()) + 3, 10);
+  ASSERT_EQ(pressio_io_write(io, &values), 0) << pressio_io_error_msg(io);
+
+  std::vector<int> written(size);
+  ASSERT_EQ(pread(tmp_fd, written.data(), sizeof(int) * size, 0), static_cast<ssize_t>(sizeof(int) * size));
+  EXPECT_EQ(written, (std::vector<int>{10, 1, 11, 3, 12, 5}));
+
+  //the same layout reads back what was written
+  auto read = pressio_io_read(io, nullptr);
+  ASSERT_NE(read, nullptr);
+  ASSERT_EQ(pressio_data_get_bytes(read), values.size_in_bytes());
+  EXPECT_EQ(memcmp(pressio_data_ptr(read, nullptr), values.data(), values.size_in_bytes()), 0);
+  pressio_data_free(read);
+  pressio_io_free(io);
+}
+
+TEST_F(PressioDataIOTests, TestLayoutFromBufferedStream) {
+  //the stream has buffered past the first integer, so the offset is relative to the stream, not its descriptor
+  FILE* file = fdopen(dup(tmp_fd), "r");
+  ASSERT_NE(file, nullptr);
+  int first = -1;
+  ASSERT_EQ(fread(&first, sizeof(int), 1, file), 1u);
+  EXPECT_EQ(first, 0);
+
+  auto io = pressio_get_io(&library, "posix");
+  (*io)->set_options({
+      {"io:file_pointer", static_cast<void*>(file)},
+      {"io:offset", static_cast<unsigned int>(sizeof(int))},
+  });
+  size_t sizes[] = {2};
+  auto read = pressio_io_read(io, pressio_data_new_empty(pressio_int32_dtype, 1, sizes));
+  ASSERT_NE(read, nullptr) << pressio_io_error_msg(io);
+  int* read_buffer = static_cast<int*>(pressio_data_ptr(read, nullptr));
+  EXPECT_EQ(read_buffer[0], 2);
+  EXPECT_EQ(read_buffer[1], 3);
+  pressio_data_free(read);
+  pressio_io_free(io);
+  fclose(file);
+}
+
+TEST_F(PressioDataIOTests, TestLargeOffsets) {
+  auto io = pressio_get_io(&library, "posix");
+  const double offset = 5e9;
+  EXPECT_EQ((*io)->set_options({{"io:offset", offset}}), 0);
+  double configured = 0;
+  EXPECT_EQ((*io)->get_options().get("io:offset", &configured), pressio_options_key_set);
+  EXPECT_EQ(configured, offset);
+  EXPECT_NE((*io)->set_options({{"io:offset", 1.5}}), 0);
+  EXPECT_NE((*io)->set_options({{"posix:record_stride", -8.0}}), 0);
+  EXPECT_EQ((*io)->set_options({{"io:offset", 0u}}), 0);
+  pressio_io_free(io);
+}
+
 TEST_F(PressioDataIOTests, TestWriteCSV) {
   size_t sizes[] = {2,3};
   auto data = pressio_data_new_owning(pressio_int32_dtype, 2, sizes);
@@ -309,3 +464,339 @@ TEST_F(PressioDataIOTests, TestReadCSV) {
   close(tmpwrite_fd);
   unlink(tmpwrite_name.data());
 }
+
+TEST_F(PressioDataIOTests, TestMemoryReadWrite) {
+  size_t sizes[] = {2,3};
+  auto data = pressio_data_new_owning(pressio_int32_dtype, 2, sizes);
+  int* buffer = static_cast<int*>(pressio_data_ptr(data, nullptr));
+  std::iota(buffer, buffer + pressio_data_num_elements(data), 0);
+
+  auto io = pressio_get_io(&library, "memory");
+  (*io)->set_options({
+      {"io:path", std::string("test_memory_read_write")}
+  });
+  EXPECT_EQ(pressio_io_write(io, data), 0);
+  pressio_data_free(data);
+
+  pressio_data* read = pressio_io_read(io, nullptr);
+  ASSERT_NE(read, nullptr);
+  EXPECT_EQ(pressio_data_dtype(read), pressio_int32_dtype);
+  EXPECT_EQ(pressio_data_num_dimensions(read), 2);
+  EXPECT_EQ(pressio_data_get_dimension(read, 0), 2);
+  EXPECT_EQ(pressio_data_get_dimension(read, 1), 3);
+  int* read_buffer = static_cast<int*>(pressio_data_ptr(read, nullptr));
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(read_buffer[i], i);
+  }
+
+  //reads are references to the same stored buffer
+  pressio_data* read2 = pressio_io_read(io, nullptr);
+  ASSERT_NE(read2, nullptr);
+  EXPECT_EQ(pressio_data_ptr(read, nullptr), pressio_data_ptr(read2, nullptr));
+
+  pressio_data_free(read);
+  pressio_data_free(read2);
+  pressio_io_free(io);
+}
+
+TEST_F(PressioDataIOTests, TestMemoryEviction) {
+  size_t sizes[] = {512 * 1024};
+  auto io = pressio_get_io(&library, "memory");
+  (*io)->set_options({
+      {"memory:capacity_mb", 1u}
+  });
+
+  pressio_data* held = nullptr;
+  for (auto name : {"test_memory_evict_a", "test_memory_evict_b", "test_memory_evict_c"}) {
+    auto data = pressio_data_new_owning(pressio_uint8_dtype, 1, sizes);
+    memset(pressio_data_ptr(data, nullptr), 1, pressio_data_get_bytes(data));
+    (*io)->set_options({{"io:path", std::string(name)}});
+    EXPECT_EQ(pressio_io_write(io, data), 0);
+    pressio_data_free(data);
+    if(held == nullptr) held = pressio_io_read(io, nullptr);
+  }
+
+  //the least recently used buffer is evicted, but outstanding references remain valid
+  (*io)->set_options({{"io:path", std::string("test_memory_evict_a")}});
+  EXPECT_EQ(pressio_io_read(io, nullptr), nullptr);
+  ASSERT_NE(held, nullptr);
+  EXPECT_EQ(static_cast<uint8_t*>(pressio_data_ptr(held, nullptr))[0], 1);
+  pressio_data_free(held);
+
+  (*io)->set_options({{"io:path", std::string("test_memory_evict_c")}});
+  pressio_data* read = pressio_io_read(io, nullptr);
+  EXPECT_NE(read, nullptr);
+  pressio_data_free(read);
+
+  size_t large_sizes[] = {2 * 1024 * 1024};
+  auto too_large = pressio_data_new_owning(pressio_uint8_dtype, 1, large_sizes);
+  EXPECT_NE(pressio_io_write(io, too_large), 0);
+  pressio_data_free(too_large);
+
+  (*io)->set_options({{"memory:capacity_mb", 0u}});
+  pressio_io_free(io);
+}
+
+TEST_F(PressioDataIOTests, TestShmRingBuffer) {
+  const std::string name = "/pressio_test_shm_" + std::to_string(getpid());
+  auto writer = pressio_get_io(&library, "shm");
+  (*writer)->set_options({
+      {"io:path", name},
+      {"shm:create", 1},
+      {"shm:slots", 2u},
+      {"shm:slot_size_mb", 1u},
+      {"shm:timeout_ms", 100u},
+  });
+  auto reader = pressio_get_io(&library, "shm");
+  (*reader)->set_options({
+      {"io:path", name},
+      {"shm:timeout_ms", 100u},
+  });
+
+  size_t sizes[] = {2,3};
+  auto make_data = [&sizes](int start) {
+    auto data = pressio_data_new_owning(pressio_int32_dtype, 2, sizes);
+    int* buffer = static_cast<int*>(pressio_data_ptr(data, nullptr));
+    std::iota(buffer, buffer + pressio_data_num_elements(data), start);
+    return data;
+  };
+
+  //the writer must create the segment before the reader can attach
+  auto first = make_data(0);
+  EXPECT_EQ(pressio_io_write(writer, first), 0);
+  auto second = make_data(10);
+  EXPECT_EQ(pressio_io_write(writer, second), 0);
+
+  //the ring is full, so the writer times out
+  auto third = make_data(20);
+  EXPECT_NE(pressio_io_write(writer, third), 0);
+
+  pressio_data* read = pressio_io_read(reader, nullptr);
+  ASSERT_NE(read, nullptr);
+  EXPECT_EQ(pressio_data_dtype(read), pressio_int32_dtype);
+  EXPECT_EQ(pressio_data_num_dimensions(read), 2);
+  EXPECT_EQ(pressio_data_get_dimension(read, 0), 2);
+  EXPECT_EQ(pressio_data_get_dimension(read, 1), 3);
+  EXPECT_EQ(memcmp(pressio_data_ptr(read, nullptr), pressio_data_ptr(first, nullptr), pressio_data_get_bytes(first)), 0);
+
+  //the slot is only handed back to the writer once the reader frees it
+  EXPECT_NE(pressio_io_write(writer, third), 0);
+  pressio_data_free(read);
+  EXPECT_EQ(pressio_io_write(writer, third), 0);
+
+  for (auto expected : {second, third}) {
+    read = pressio_io_read(reader, nullptr);
+    ASSERT_NE(read, nullptr);
+    EXPECT_EQ(memcmp(pressio_data_ptr(read, nullptr), pressio_data_ptr(expected, nullptr), pressio_data_get_bytes(expected)), 0);
+    pressio_data_free(read);
+  }
+
+  //the ring is empty, so the reader times out
+  EXPECT_EQ(pressio_io_read(reader, nullptr), nullptr);
+
+  size_t large_sizes[] = {2 * 1024 * 1024};
+  auto too_large = pressio_data_new_owning(pressio_uint8_dtype, 1, large_sizes);
+  EXPECT_NE(pressio_io_write(writer, too_large), 0);
+
+  pressio_data_free(too_large);
+  pressio_data_free(first);
+  pressio_data_free(second);
+  pressio_data_free(third);
+  pressio_io_free(reader);
+  pressio_io_free(writer);
+}
+
+TEST_F(PressioDataIOTests, TestShmConcurrentReadersAndWriters) {
+  const std::string name = "/pressio_test_shm_concurrent_" + std::to_string(getpid());
+  const int nthreads = 3, per_writer = 40;
+  std::vector<pressio_io*> writers, readers;
+  for (int i = 0; i < nthreads; ++i) {
+    auto writer = pressio_get_io(&library, "shm");
+    (*writer)->set_options({
+        {"io:path", name},
+        {"shm:create", static_cast<int>(i == 0)},
+        {"shm:slots", 2u},
+        {"shm:slot_size_mb", 1u},
+        {"shm:timeout_ms", 10000u},
+    });
+    writers.push_back(writer);
+    auto reader = pressio_get_io(&library, "shm");
+    (*reader)->set_options({
+        {"io:path", name},
+        {"shm:timeout_ms", 10000u},
+    });
+    readers.push_back(reader);
+  }
+
+  //the first writer creates the segment before anyone else attaches
+  size_t sizes[] = {2};
+  auto write = [&sizes](pressio_io* writer, int id, int sequence) {
+    auto data = pressio_data_new_owning(pressio_int32_dtype, 1, sizes);
+    int* buffer = static_cast<int*>(pressio_data_ptr(data, nullptr));
+    buffer[0] = id;
+    buffer[1] = sequence;
+    int rc = pressio_io_write(writer, data);
+    pressio_data_free(data);
+    return rc;
+  };
+  ASSERT_EQ(write(writers.front(), 0, 0), 0);
+
+  //the ring has fewer slots than threads on each side, so slots are contended and reused
+  const int total = nthreads * per_writer;
+  std::atomic<int> claimed{0};
+  std::atomic<int> failures{0};
+  std::vector<std::vector<std::pair<int,int>>> received(nthreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int sequence = (t == 0) ? 1 : 0; sequence < per_writer; ++sequence) {
+        if(write(writers[t], t, sequence)) failures++;
+      }
+    });
+    threads.emplace_back([&, t] {
+      while(claimed++ < total) {
+        pressio_data* data = pressio_io_read(readers[t], nullptr);
+        if(data == nullptr) {
+          failures++;
+          continue;
+        }
+        int* buffer = static_cast<int*>(pressio_data_ptr(data, nullptr));
+        received[t].emplace_back(buffer[0], buffer[1]);
+        pressio_data_free(data);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(failures, 0);
+
+  //every buffer arrives exactly once, and each reader sees each writer's buffers in order
+  std::set<std::pair<int,int>> all;
+  for (auto const& values : received) {
+    std::vector<int> last(nthreads, -1);
+    for (auto const& value : values) {
+      EXPECT_GT(value.second, last[value.first]);
+      last[value.first] = value.second;
+      EXPECT_TRUE(all.insert(value).second);
+    }
+  }
+  EXPECT_EQ(all.size(), static_cast<size_t>(total));
+
+  for (int i = 0; i < nthreads; ++i) {
+    pressio_io_free(readers[i]);
+    pressio_io_free(writers[i]);
+  }
+}
+
+TEST_F(PressioDataIOTests, TestSyntheticDeterministic) {
+  size_t sizes[] = {64, 32, 8};
+  auto io = pressio_get_io(&library, "synthetic");
+  auto read_with = [&](unsigned int seed, unsigned int nthreads) {
+    (*io)->set_options({
+        {"synthetic:kind", std::string("gaussian")},
+        {"synthetic:seed", seed},
+        {"synthetic:nthreads", nthreads},
+    });
+    return pressio_io_read(io, pressio_data_new_empty(pressio_float_dtype, 3, sizes));
+  };
+
+  auto serial = read_with(1, 1);
+  auto parallel = read_with(1, 4);
+  auto other_seed = read_with(2, 4);
+  ASSERT_NE(serial, nullptr);
+  ASSERT_NE(parallel, nullptr);
+  ASSERT_NE(other_seed, nullptr);
+  EXPECT_EQ(pressio_data_dtype(serial), pressio_float_dtype);
+  EXPECT_EQ(pressio_data_num_elements(serial), 64 * 32 * 8);
+
+  const size_t bytes = pressio_data_get_bytes(serial);
+  EXPECT_EQ(memcmp(pressio_data_ptr(serial, nullptr), pressio_data_ptr(parallel, nullptr), bytes), 0);
+  EXPECT_NE(memcmp(pressio_data_ptr(serial, nullptr), pressio_data_ptr(other_seed, nullptr), bytes), 0);
+
+  //the field is normalized to roughly unit variance
+  float* values = static_cast<float*>(pressio_data_ptr(serial, nullptr));
+  double sum = 0, sum_sq = 0;
+  const size_t n = pressio_data_num_elements(serial);
+  for (size_t i = 0; i < n; ++i) {
+    sum += values[i];
+    sum_sq += values[i] * values[i];
+  }
+  const double variance = sum_sq / n - (sum / n) * (sum / n);
+  EXPECT_GT(variance, 0.1);
+  EXPECT_LT(variance, 10.0);
+
+  pressio_data_free(serial);
+  pressio_data_free(parallel);
+  pressio_data_free(other_seed);
+  EXPECT_EQ(pressio_io_read(io, nullptr), nullptr);
+  pressio_io_free(io);
+}
+
+TEST_F(PressioDataIOTests, TestSyntheticKinds) {
+  size_t sizes[] = {100, 100};
+  auto io = pressio_get_io(&library, "synthetic");
+
+  (*io)->set_options({
+      {"synthetic:kind", std::string("labels")},
+      {"synthetic:labels", 5u},
+  });
+  auto labels = pressio_io_read(io, pressio_data_new_empty(pressio_int32_dtype, 2, sizes));
+  ASSERT_NE(labels, nullptr);
+  int* label_values = static_cast<int*>(pressio_data_ptr(labels, nullptr));
+  auto minmax = std::minmax_element(label_values, label_values + pressio_data_num_elements(labels));
+  EXPECT_GE(*minmax.first, 0);
+  EXPECT_LT(*minmax.second, 5);
+  pressio_data_free(labels);
+
+  (*io)->set_options({
+      {"synthetic:kind", std::string("sparse")},
+      {"synthetic:density", 0.25},
+      {"synthetic:fill_value", -999.0},
+  });
+  auto sparse = pressio_io_read(io, pressio_data_new_empty(pressio_double_dtype, 2, sizes));
+  ASSERT_NE(sparse, nullptr);
+  double* sparse_values = static_cast<double*>(pressio_data_ptr(sparse, nullptr));
+  const size_t n = pressio_data_num_elements(sparse);
+  const size_t filled = std::count(sparse_values, sparse_values + n, -999.0);
+  EXPECT_GT(filled, n * 6 / 10);
+  EXPECT_LT(filled, n * 9 / 10);
+  pressio_data_free(sparse);
+
+  (*io)->set_options({
+      {"synthetic:kind", std::string("analytic")},
+      {"synthetic:noise", 0.1},
+      {"synthetic:scale", 100.0},
+  });
+  auto analytic = pressio_io_read(io, pressio_data_new_empty(pressio_int16_dtype, 2, sizes));
+  ASSERT_NE(analytic, nullptr);
+  pressio_data_free(analytic);
+
+  EXPECT_NE((*io)->set_options({{"synthetic:kind", std::string("fractal")}}), 0);
+  pressio_io_free(io);
+}
+
+TEST_F(PressioDataIOTests, TestSyntheticLazy) {
+  const std::vector<size_t> sizes{40, 30, 20};
+  auto io = pressio_get_io(&library, "synthetic");
+  (*io)->set_options({
+      {"synthetic:kind", std::string("analytic")},
+      {"synthetic:noise", 0.5},
+  });
+  auto eager = pressio_io_read(io, pressio_data_new_empty(pressio_float_dtype, 3, sizes.data()));
+  (*io)->set_options({{"synthetic:lazy", 1}});
+  auto lazy = pressio_io_read(io, pressio_data_new_empty(pressio_float_dtype, 3, sizes.data()));
+  pressio_io_free(io);
+  ASSERT_NE(eager, nullptr);
+  ASSERT_NE(lazy, nullptr);
+  EXPECT_FALSE(eager->is_lazy());
+  ASSERT_TRUE(lazy->is_lazy());
+
+  const std::vector<size_t> start{3, 7, 11}, count{20, 10, 5};
+  auto expected = eager->select(start, {1, 1, 1}, count, {1, 1, 1});
+  std::vector<float> region(20 * 10 * 5);
+  ASSERT_EQ(lazy->read_region(start, count, region.data()), 0);
+  EXPECT_EQ(memcmp(region.data(), expected.data(), expected.size_in_bytes()), 0);
+
+  EXPECT_EQ(memcmp(lazy->data(), eager->data(), eager->size_in_bytes()), 0);
+  pressio_data_free(eager);
+  pressio_data_free(lazy);
+}
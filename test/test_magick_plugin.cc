@@ -0,0 +1,39 @@
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+
+TEST(MagickPluginTests, ParallelSlices) {
+  pressio library;
+  auto compressor = library.get_compressor("magick");
+  ASSERT_TRUE(compressor);
+  ASSERT_EQ(compressor->set_options({
+        {"magick:compressed_magick", std::string("PNG")},
+        {"magick:parallel", 1}
+        }), 0);
+
+  const std::vector<size_t> dims{5, 32, 24};
+  auto input = pressio_data::owning(pressio_byte_dtype, dims);
+  auto ptr = static_cast<uint8_t*>(input.data());
+  for (size_t i = 0; i < input.num_elements(); ++i) {
+    ptr[i] = static_cast<uint8_t>(i * 7);
+  }
+  auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+  auto output = pressio_data::owning(pressio_byte_dtype, dims);
+  ASSERT_EQ(compressor->compress(&input, &compressed), 0) << compressor->error_msg();
+  ASSERT_EQ(compressor->decompress(&compressed, &output), 0) << compressor->error_msg();
+  EXPECT_EQ(output.dimensions(), dims);
+  EXPECT_EQ(memcmp(input.data(), output.data(), input.size_in_bytes()), 0);
+
+  uint64_t slices = 0;
+  memcpy(&slices, compressed.data(), sizeof(slices));
+  EXPECT_EQ(slices, 5u);
+
+  auto truncated = pressio_data::owning(pressio_byte_dtype, {16});
+  memset(truncated.data(), 0, truncated.size_in_bytes());
+  EXPECT_NE(compressor->decompress(&truncated, &output), 0);
+}
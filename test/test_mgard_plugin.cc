@@ -0,0 +1,86 @@
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "library_options_guard.h"
+
+namespace {
+  /*
+   * with mgard:s=0 the tolerance bounds the L2 norm of the error, and the
+   * subdomain tolerances are chosen so that it holds for the whole array
+   */
+  void expect_within_tolerance(pressio_data const& input, pressio_data const& output, double tolerance) {
+    ASSERT_EQ(input.num_elements(), output.num_elements());
+    auto original = static_cast<double const*>(input.data());
+    auto decompressed = static_cast<double const*>(output.data());
+    double squared_error = 0;
+    for (size_t i = 0; i < input.num_elements(); ++i) {
+      squared_error += (decompressed[i] - original[i]) * (decompressed[i] - original[i]);
+    }
+    EXPECT_LE(std::sqrt(squared_error), tolerance);
+  }
+}
+
+TEST(MgardPluginTests, DecomposedSubdomains) {
+  pressio library;
+  library_options_guard guard(library);
+  ASSERT_EQ(library.set_options({{"pressio:nthreads", 4u}}), 0);
+  auto compressor = library.get_compressor("mgard");
+  ASSERT_TRUE(compressor);
+
+  //slabs per thread of a 3d array, explicit slabs with a thicker last slab, and a 4d array of 3d domains
+  const std::vector<std::vector<size_t>> shapes{{17, 19, 23}, {17, 19, 23}, {9, 10, 11, 3}};
+  const std::vector<unsigned int> subdomain_sizes{0, 7, 0};
+  const std::vector<uint64_t> expected_subdomains{4, 3, 6};
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    ASSERT_EQ(compressor->set_options({
+          {"mgard:tolerance", 1e-4},
+          {"mgard:s", 0.0},
+          {"mgard:decompose", 1},
+          {"mgard:subdomain_size", subdomain_sizes[i]}
+          }), 0);
+    auto input = pressio_data::owning(pressio_double_dtype, shapes[i]);
+    auto ptr = static_cast<double*>(input.data());
+    std::iota(ptr, ptr + input.num_elements(), 0.5);
+    auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+    auto output = pressio_data::owning(pressio_double_dtype, shapes[i]);
+    ASSERT_EQ(compressor->compress(&input, &compressed), 0) << compressor->error_msg();
+    ASSERT_EQ(compressor->decompress(&compressed, &output), 0) << compressor->error_msg();
+    EXPECT_EQ(output.dimensions(), shapes[i]);
+
+    uint64_t subdomains = 0;
+    memcpy(&subdomains, compressed.data(), sizeof(subdomains));
+    EXPECT_EQ(subdomains, expected_subdomains[i]) << i;
+
+    expect_within_tolerance(input, output, 1e-4);
+  }
+
+  //with many threads per domain the automatic slabs stay thick enough for MGARD
+  ASSERT_EQ(library.set_options({{"pressio:nthreads", 16u}}), 0);
+  ASSERT_EQ(compressor->set_options({{"mgard:subdomain_size", 0u}}), 0);
+  for (auto const& dims : {std::vector<size_t>{17, 19, 8}, std::vector<size_t>{17, 7}}) {
+    auto input = pressio_data::owning(pressio_double_dtype, dims);
+    auto ptr = static_cast<double*>(input.data());
+    std::iota(ptr, ptr + input.num_elements(), 0.5);
+    auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+    auto output = pressio_data::owning(pressio_double_dtype, dims);
+    ASSERT_EQ(compressor->compress(&input, &compressed), 0) << compressor->error_msg();
+    ASSERT_EQ(compressor->decompress(&compressed, &output), 0) << compressor->error_msg();
+    uint64_t header[2];
+    memcpy(header, compressed.data(), sizeof(header));
+    EXPECT_EQ(header[0], 2u);
+    EXPECT_EQ(header[1], 3u);
+    expect_within_tolerance(input, output, 1e-4);
+  }
+  EXPECT_NE(compressor->set_options({{"mgard:subdomain_size", 2u}}), 0);
+
+  auto truncated = pressio_data::owning(pressio_byte_dtype, {16});
+  memset(truncated.data(), 0, truncated.size_in_bytes());
+  auto output = pressio_data::owning(pressio_double_dtype, shapes[0]);
+  EXPECT_NE(compressor->decompress(&truncated, &output), 0);
+}
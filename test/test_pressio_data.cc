@@ -2,10 +2,22 @@
 #include <numeric>
 #include <memory>
 #include <array>
+#include <atomic>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include "pressio_data.h"
+#include "libpressio_ext/cpp/allocation.h"
 #include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
 #include "libpressio_ext/cpp/printers.h"
 #include "multi_dimensional_iterator.h"
+#include "library_options_guard.h"
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
@@ -258,3 +270,177 @@ TEST(test_mulit_dimensional_array, test_mulit_dimensional_array_operator) {
   pressio_data_free(data);
 }
 
+
+TEST(PressioDataAllocationTests, Policies) {
+  const std::vector<size_t> dims{256, 257};
+  for (auto numa : {pressio_numa_policy::system, pressio_numa_policy::interleave, pressio_numa_policy::local, pressio_numa_policy::node}) {
+    pressio_allocation_policy policy;
+    policy.numa = numa;
+    auto data = pressio_data::owning(pressio_int32_dtype, dims, policy);
+    ASSERT_TRUE(data.has_data()) << pressio_numa_policy_name(numa);
+    auto ptr = static_cast<int*>(data.data());
+    std::iota(ptr, ptr + data.num_elements(), 0);
+
+    auto copy = data;
+    auto copy_ptr = static_cast<int*>(copy.data());
+    EXPECT_TRUE(std::equal(ptr, ptr + data.num_elements(), copy_ptr)) << pressio_numa_policy_name(numa);
+  }
+
+  pressio_numa_policy parsed;
+  EXPECT_TRUE(pressio_parse_numa_policy("interleave", parsed));
+  EXPECT_TRUE(parsed == pressio_numa_policy::interleave);
+  EXPECT_FALSE(pressio_parse_numa_policy("nearby", parsed));
+}
+
+#if defined(__linux__)
+TEST(PressioDataAllocationTests, InterleavedPages) {
+  pressio_allocation_policy policy;
+  policy.numa = pressio_numa_policy::interleave;
+  auto data = pressio_data::owning(pressio_double_dtype, {1 << 16}, policy);
+
+  int mode = -1;
+  if(syscall(SYS_get_mempolicy, &mode, nullptr, 0, data.data(), MPOL_F_ADDR) != 0) {
+    GTEST_SKIP() << "get_mempolicy is not supported";
+  }
+  EXPECT_EQ(mode, MPOL_INTERLEAVE);
+}
+#endif
+
+TEST(PressioDataAllocationTests, HugePages) {
+  for (auto huge_pages : {pressio_huge_page_policy::transparent, pressio_huge_page_policy::hugetlbfs}) {
+    pressio_allocation_policy policy;
+    policy.huge_pages = huge_pages;
+    auto data = pressio_data::owning(pressio_uint8_dtype, {3 * pressio_huge_page_size() + 1}, policy);
+    ASSERT_TRUE(data.has_data()) << pressio_huge_page_policy_name(huge_pages);
+#if defined(__linux__)
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data.data()) % pressio_huge_page_size(), 0u);
+#endif
+    auto ptr = static_cast<uint8_t*>(data.data());
+    for (size_t i = 0; i < data.num_elements(); ++i) ptr[i] = static_cast<uint8_t>(i);
+    EXPECT_EQ(ptr[data.num_elements() - 1], static_cast<uint8_t>(data.num_elements() - 1));
+  }
+
+  pressio_huge_page_policy parsed;
+  EXPECT_TRUE(pressio_parse_huge_page_policy("transparent", parsed));
+  EXPECT_TRUE(parsed == pressio_huge_page_policy::transparent);
+  EXPECT_FALSE(pressio_parse_huge_page_policy("gigantic", parsed));
+}
+
+TEST(PressioDataAllocationTests, PageFaultsMetric) {
+  pressio library;
+  library_options_guard guard(library);
+  ASSERT_EQ(library.set_options({{"pressio:huge_pages", std::string("transparent")}}), 0);
+  auto compressor = library.get_compressor("noop");
+  const std::vector<std::string> metric_ids{"page_faults"};
+  pressio_metrics metrics(library.get_metrics(metric_ids.begin(), metric_ids.end()));
+  compressor->set_metrics(metrics);
+
+  auto input = pressio_data::owning(pressio_double_dtype, {1 << 20});
+  auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+  auto output = pressio_data::owning(pressio_double_dtype, {1 << 20});
+  ASSERT_EQ(compressor->compress(&input, &compressed), 0);
+  ASSERT_EQ(compressor->decompress(&compressed, &output), 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(compressed.data()) % pressio_huge_page_size(), 0u);
+
+  auto results = compressor->get_metrics_results();
+  unsigned int minor_faults = 0;
+  EXPECT_EQ(results.get("page_faults:compress:minor_faults", &minor_faults), pressio_options_key_set);
+  EXPECT_EQ(results.key_status("page_faults:decompress:minor_faults"), pressio_options_key_set);
+  EXPECT_NE(results.key_status("page_faults:compress:dtlb_load_misses"), pressio_options_key_does_not_exist);
+
+  EXPECT_EQ(library.set_options({{"pressio:huge_pages", std::string("gigantic")}}), 6);
+}
+
+TEST(PressioDataAllocationTests, Alignment) {
+  for (size_t n : {1ul, 3ul, 17ul, 1000ul}) {
+    auto data = pressio_data::owning(pressio_float_dtype, {n});
+    EXPECT_TRUE(data.is_aligned()) << n;
+    EXPECT_TRUE(pressio_data_is_aligned(&data, pressio_simd_alignment)) << n;
+  }
+  pressio_data literal{1.0, 2.0, 3.0};
+  EXPECT_TRUE(literal.is_aligned());
+
+  pressio_allocation_policy policy;
+  policy.alignment = 4096;
+  EXPECT_TRUE(pressio_data::owning(pressio_byte_dtype, {10}, policy).is_aligned(4096));
+  EXPECT_FALSE(pressio_valid_alignment(48));
+
+  //casts take the aligned path for whole buffers and the unaligned path for offset views
+  const size_t n = (1 << 17) + 5;
+  auto input = pressio_data::owning(pressio_int32_dtype, {n + 1});
+  auto ptr = static_cast<int32_t*>(input.data());
+  std::iota(ptr, ptr + n + 1, 0);
+  auto offset = pressio_data::nonowning(pressio_int32_dtype, ptr + 1, {n});
+  EXPECT_FALSE(offset.is_aligned());
+  for (auto const* source : {&input, &offset}) {
+    auto casted = source->cast(pressio_double_dtype);
+    ASSERT_TRUE(casted.is_aligned());
+    auto src = static_cast<int32_t*>(source->data());
+    auto dst = static_cast<double*>(casted.data());
+    EXPECT_TRUE(std::equal(src, src + source->num_elements(), dst));
+  }
+}
+
+TEST(PressioDataLazyTests, GeneratesRegionsOnDemand) {
+  //each element holds its linear index
+  const std::vector<size_t> dims{7, 5, 3};
+  auto generated = std::make_shared<std::atomic<size_t>>(0);
+  auto lazy = pressio_data::lazy(pressio_int32_dtype, dims,
+      [dims, generated](std::vector<size_t> const& start, std::vector<size_t> const& count, void* out) {
+        auto ptr = static_cast<int32_t*>(out);
+        for (size_t k = 0; k < count[2]; ++k)
+          for (size_t j = 0; j < count[1]; ++j)
+            for (size_t i = 0; i < count[0]; ++i)
+              *ptr++ = static_cast<int32_t>((start[0] + i) + dims[0] * ((start[1] + j) + dims[1] * (start[2] + k)));
+        *generated += (ptr - static_cast<int32_t*>(out));
+        return 0;
+      });
+  EXPECT_TRUE(lazy.is_lazy());
+  EXPECT_TRUE(lazy.has_data());
+
+  std::vector<int32_t> region(2 * 3 * 2);
+  ASSERT_EQ(lazy.read_region({4, 1, 1}, {2, 3, 2}, region.data()), 0);
+  EXPECT_EQ(*generated, region.size());
+  EXPECT_EQ(region[0], 4 + 7 * (1 + 5 * 1));
+  EXPECT_EQ(region.back(), 5 + 7 * (3 + 5 * 2));
+  EXPECT_NE(lazy.read_region({6, 0, 0}, {2, 1, 1}, region.data()), 0);
+
+  //copies and contiguous selections do not produce the whole buffer
+  auto copy = pressio_data::clone(lazy);
+  EXPECT_TRUE(copy.is_lazy());
+  auto selected = copy.select({1, 0, 2}, {1, 1, 1}, {3, 5, 1}, {1, 1, 1});
+  ASSERT_EQ(selected.dimensions(), (std::vector<size_t>{3, 5, 1}));
+  EXPECT_EQ(static_cast<int32_t*>(selected.data())[0], 1 + 7 * 5 * 2);
+  EXPECT_EQ(*generated, region.size() + selected.num_elements());
+
+  //data() produces the buffer once; there is no buffer to be aligned before it
+  EXPECT_FALSE(lazy.is_aligned());
+  *generated = 0;
+  auto values = static_cast<int32_t*>(lazy.data());
+  ASSERT_NE(values, nullptr);
+  EXPECT_EQ(lazy.data(), values);
+  EXPECT_TRUE(lazy.is_aligned());
+  EXPECT_EQ(*generated, lazy.num_elements());
+  for (size_t i = 0; i < lazy.num_elements(); ++i) {
+    ASSERT_EQ(values[i], static_cast<int32_t>(i));
+  }
+
+  //the error statistics compare lazy inputs without producing a second copy
+  *generated = 0;
+  pressio library;
+  auto compressor = library.get_compressor("noop");
+  const std::vector<std::string> metric_ids{"error_stat"};
+  pressio_metrics metrics(library.get_metrics(metric_ids.begin(), metric_ids.end()));
+  compressor->set_metrics(metrics);
+  auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+  auto output = pressio_data::owning(pressio_int32_dtype, dims);
+  ASSERT_EQ(compressor->compress(&copy, &compressed), 0);
+  ASSERT_EQ(compressor->decompress(&compressed, &output), 0);
+  auto results = compressor->get_metrics_results();
+  double max_error = -1, value_max = 0;
+  EXPECT_EQ(results.get("error_stat:max_error", &max_error), pressio_options_key_set);
+  EXPECT_EQ(results.get("error_stat:value_max", &value_max), pressio_options_key_set);
+  EXPECT_EQ(max_error, 0.0);
+  EXPECT_EQ(value_max, static_cast<double>(lazy.num_elements() - 1));
+  EXPECT_EQ(*generated, 2 * lazy.num_elements());
+}
@@ -44,3 +44,22 @@ pressio.options_get_double(metric_results, b"size:compression_ratio", compressio
 print("compression ratio", pressio.double_value(compression_ratio))
 
 result = pressio.io_data_to_numpy(decompressed_data)
+
+#the zero-copy paths share memory with numpy instead of copying it
+nocopy_input = pressio.io_data_from_numpy(data, copy=False)
+assert pressio.data_get_bytes(nocopy_input) == data.nbytes
+pressio.data_free(nocopy_input)
+
+#read-only memory cannot be handed to plugins that may write into it
+readonly = data.copy()
+readonly.setflags(write=False)
+try:
+    pressio.io_data_from_numpy(readonly, copy=False)
+    assert False, "read-only arrays must not be wrapped"
+except BufferError:
+    pass
+
+nocopy_result = pressio.io_data_to_numpy(decompressed_data, copy=False)
+assert nocopy_result.shape == result.shape
+assert np.array_equal(nocopy_result, result)
+assert not pressio.data_has_data(decompressed_data)
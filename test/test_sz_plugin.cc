@@ -5,6 +5,8 @@
 #include "pressio.h"
 #include "pressio_version.h"
 #include "pressio_compressor.h"
+#include "pressio_data.h"
+#include "pressio_options.h"
 
 class PressioCompressor: public ::testing::Test {
   protected:
@@ -33,3 +35,44 @@ TEST_F(PressioCompressor, VersionTest) {
   EXPECT_EQ(pressio_compressor_patch_version(compressor), SZ_VER_BUILD);
 }
 
+
+TEST_F(PressioCompressor, OpenMP) {
+  auto options = pressio_compressor_get_options(compressor);
+  pressio_options_set_integer(options, "sz:openmp", 1);
+  pressio_options_set_uinteger(options, "sz:nthreads", 2);
+  pressio_options_set_integer(options, "sz:error_bound_mode", ABS);
+  pressio_options_set_double(options, "sz:abs_err_bound", 1e-3);
+  ASSERT_EQ(pressio_compressor_set_options(compressor, options), 0);
+
+  size_t dims[] = {30, 20, 10};
+  auto input = pressio_data_new_owning(pressio_float_dtype, 3, dims);
+  float* values = static_cast<float*>(pressio_data_ptr(input, nullptr));
+  for (size_t i = 0; i < pressio_data_num_elements(input); ++i) values[i] = static_cast<float>(i % 97) / 10.0f;
+  auto compressed = pressio_data_new_empty(pressio_byte_dtype, 0, nullptr);
+  auto output = pressio_data_new_empty(pressio_float_dtype, 3, dims);
+
+  int ret = pressio_compressor_compress(compressor, input, compressed);
+  if(LIBPRESSIO_SZ_HAS_OPENMP) {
+    ASSERT_EQ(ret, 0) << pressio_compressor_error_msg(compressor);
+    ASSERT_EQ(pressio_compressor_decompress(compressor, compressed, output), 0) << pressio_compressor_error_msg(compressor);
+    float* decompressed = static_cast<float*>(pressio_data_ptr(output, nullptr));
+    for (size_t i = 0; i < pressio_data_num_elements(input); ++i) {
+      ASSERT_NEAR(decompressed[i], values[i], 1e-3 * 1.01) << i;
+    }
+
+    //inputs the OpenMP routines do not handle are rejected
+    size_t dims2d[] = {600, 10};
+    auto input2d = pressio_data_new_owning(pressio_float_dtype, 2, dims2d);
+    EXPECT_NE(pressio_compressor_compress(compressor, input2d, compressed), 0);
+    pressio_data_free(input2d);
+  } else {
+    EXPECT_NE(ret, 0);
+  }
+
+  pressio_options_set_integer(options, "sz:openmp", 0);
+  pressio_compressor_set_options(compressor, options);
+  pressio_options_free(options);
+  pressio_data_free(input);
+  pressio_data_free(compressed);
+  pressio_data_free(output);
+}
@@ -0,0 +1,217 @@
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "libpressio_ext/cpp/thread_pool.h"
+#include "library_options_guard.h"
+#include "pressio.h"
+#include "pressio_options.h"
+#include "gtest/gtest.h"
+
+TEST(PressioThreadPoolTests, ParallelForCoversRange) {
+  pressio_thread_pool pool(4);
+  EXPECT_EQ(pool.nthreads(), 4u);
+
+  std::vector<std::atomic<int>> visits(100003);
+  pool.parallel_for(3, visits.size(), 1000, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) ++visits[i];
+  });
+  for (size_t i = 0; i < visits.size(); ++i) {
+    EXPECT_EQ(visits[i].load(), (i < 3) ? 0 : 1) << i;
+  }
+}
+
+TEST(PressioThreadPoolTests, NestedParallelFor) {
+  pressio_thread_pool pool(3);
+  std::atomic<size_t> total{0};
+  pool.parallel_for(0, 16, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      pool.parallel_for(0, 1000, 10, [&](size_t inner_first, size_t inner_last) {
+        total += inner_last - inner_first;
+      });
+    }
+  });
+  EXPECT_EQ(total.load(), 16000u);
+}
+
+TEST(PressioThreadPoolTests, ExceptionsPropagate) {
+  pressio_thread_pool pool(4);
+  EXPECT_THROW(pool.parallel_for(0, 100, 1, [](size_t first, size_t last) {
+    if(first <= 50 && 50 < last) throw std::runtime_error("failed");
+  }), std::runtime_error);
+}
+
+TEST(PressioThreadPoolTests, SubmitAndReconfigure) {
+  std::atomic<int> ran{0};
+  {
+    pressio_thread_pool pool(2);
+    for (int i = 0; i < 100; ++i) pool.submit([&]{ ++ran; });
+    pool.configure(1, {});
+    EXPECT_EQ(ran.load(), 100);
+    //with one thread, tasks run on the calling thread
+    pool.submit([&]{ ++ran; });
+    EXPECT_EQ(ran.load(), 101);
+    pool.configure(3, {0});
+    for (int i = 0; i < 100; ++i) pool.submit([&]{ ++ran; });
+  }
+  EXPECT_EQ(ran.load(), 201);
+}
+
+TEST(PressioThreadPoolTests, ReconfigureWithSameSettingsKeepsWorkers) {
+  pressio_thread_pool pool(2, {0});
+  std::atomic<bool> ran{false};
+  //restarting would join the worker running this task
+  pool.submit([&]{ pool.configure(2, {0}); ran = true; });
+  pool.configure(1, {});
+  EXPECT_TRUE(ran.load());
+}
+
+TEST(PressioThreadPoolTests, ReconfigureWaitsForRunningWork) {
+  pressio_thread_pool pool(4);
+  std::atomic<int> ran{0};
+  std::atomic<int> accepted{0};
+  std::thread loop([&]{
+    for (int i = 0; i < 50; ++i) {
+      pool.parallel_for(0, 64, 1, [&](size_t first, size_t last) {
+        ran += static_cast<int>(last - first);
+        //a loop body cannot wait for its own loop
+        if(pool.configure(5, {})) ++accepted;
+      });
+    }
+  });
+  for (unsigned int i = 0; i < 50; ++i) {
+    EXPECT_TRUE(pool.configure(1 + i % 4, {}));
+  }
+  loop.join();
+  EXPECT_EQ(ran.load(), 50 * 64);
+  EXPECT_EQ(accepted.load(), 0);
+}
+
+TEST(PressioThreadPoolTests, CpuLists) {
+  std::vector<int> cpus;
+  EXPECT_TRUE(pressio_parse_cpu_list("0-3,8,10-11", cpus));
+  EXPECT_EQ(cpus, (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(pressio_format_cpu_list(cpus), "0,1,2,3,8,10,11");
+  EXPECT_TRUE(pressio_parse_cpu_list("", cpus));
+  EXPECT_TRUE(cpus.empty());
+  EXPECT_FALSE(pressio_parse_cpu_list("3-1", cpus));
+  EXPECT_FALSE(pressio_parse_cpu_list("a", cpus));
+}
+
+TEST(PressioThreadPoolTests, LibraryOptions) {
+  pressio library;
+  library_options_guard guard(library);
+  EXPECT_EQ(library.set_options({{"pressio:nthreads", 4u}}), 0);
+  unsigned int nthreads = 0;
+  library.get_options().get("pressio:nthreads", &nthreads);
+  EXPECT_EQ(nthreads, 4u);
+  EXPECT_NE(library.set_options({{"pressio:affinity", std::string("x")}}), 0);
+  //an invalid option leaves the valid ones before it unapplied
+  EXPECT_EQ(library.set_options({{"pressio:nthreads", 2u}, {"pressio:alignment", 3u}}), 7);
+  EXPECT_EQ(pressio_thread_pool::global().nthreads(), 4u);
+
+  //select and cast use the shared pool and must give the same result as a single thread
+  auto data = pressio_data::owning(pressio_int32_dtype, {64, 48, 20});
+  auto values = static_cast<int*>(data.data());
+  std::iota(values, values + data.num_elements(), 0);
+  auto parallel_select = data.select({1, 2, 0}, {3, 2, 2}, {20, 20, 10}, {2, 1, 1});
+  auto parallel_cast = data.cast(pressio_double_dtype);
+
+  auto c_library = pressio_instance();
+  auto options = pressio_options_new();
+  pressio_options_set_uinteger(options, "pressio:nthreads", 1);
+  EXPECT_EQ(pressio_set_options(c_library, options), 0);
+  pressio_options_free(options);
+  pressio_release(c_library);
+
+  auto serial_select = data.select({1, 2, 0}, {3, 2, 2}, {20, 20, 10}, {2, 1, 1});
+  auto serial_cast = data.cast(pressio_double_dtype);
+  ASSERT_EQ(parallel_select.size_in_bytes(), serial_select.size_in_bytes());
+  EXPECT_EQ(memcmp(parallel_select.data(), serial_select.data(), serial_select.size_in_bytes()), 0);
+  EXPECT_EQ(memcmp(parallel_cast.data(), serial_cast.data(), serial_cast.size_in_bytes()), 0);
+
+  //spot check an element: output (1, 1, 1) reads source (1 + 3*0 + 1, 2 + 2*1, 0 + 2*1)
+  auto selected = static_cast<int*>(serial_select.data());
+  EXPECT_EQ(selected[1 + 40 * (1 + 20 * 1)], 2 + 64 * (4 + 48 * 2));
+}
+
+namespace {
+  /*
+   * a compressor configured to use 3 threads internally which records the thread
+   * counts it is given and waits in compress until a second compression has started
+   */
+  struct budget_recorder : public libpressio_compressor_plugin {
+    budget_recorder(std::atomic<int>& started, std::vector<unsigned int>& inner, std::mutex& mutex):
+      started(started), inner(inner), mutex(mutex) {}
+
+    void record() {
+      std::lock_guard<std::mutex> lock(mutex);
+      inner.push_back(budgeted_threads(3));
+    }
+    pressio_options get_options_impl() const override { return {}; }
+    pressio_options get_configuration_impl() const override { return {}; }
+    int set_options_impl(pressio_options const&) override { return 0; }
+    int compress_impl(const pressio_data*, pressio_data*) override {
+      record();
+      ++started;
+      while(started.load() < 2) std::this_thread::yield();
+      return 0;
+    }
+    int decompress_impl(const pressio_data*, pressio_data*) override {
+      record();
+      return 0;
+    }
+    const char* version() const override { return "0.0.0"; }
+    const char* prefix() const override { return "budget_recorder"; }
+    std::shared_ptr<libpressio_compressor_plugin> clone() override { return nullptr; }
+
+    std::atomic<int>& started;
+    std::vector<unsigned int>& inner;
+    std::mutex& mutex;
+  };
+}
+
+TEST(PressioThreadPoolTests, ThreadBudget) {
+  pressio library;
+  library_options_guard guard(library);
+  ASSERT_EQ(library.set_options({{"pressio:nthreads", 4u}, {"pressio:thread_budget", 1}}), 0);
+
+  std::atomic<int> started{0};
+  std::vector<unsigned int> inner;
+  std::mutex mutex;
+  budget_recorder first(started, inner, mutex), second(started, inner, mutex);
+  const std::vector<std::string> metric_ids{"thread_budget"};
+  pressio_metrics metrics(library.get_metrics(metric_ids.begin(), metric_ids.end()));
+  ASSERT_TRUE(metrics);
+  second.set_metrics(metrics);
+
+  auto input = pressio_data::owning(pressio_float_dtype, {10});
+  auto output = pressio_data::empty(pressio_byte_dtype, {});
+  std::thread other([&]{ pressio_data out = pressio_data::empty(pressio_byte_dtype, {}); first.compress(&input, &out); });
+  while(started.load() < 1) std::this_thread::yield();
+  second.compress(&input, &output);
+  other.join();
+
+  //the first compression had the whole pool, the second shared it with the first
+  EXPECT_EQ(inner, (std::vector<unsigned int>{4, 2}));
+  unsigned int outer = 0, inner_threads = 0;
+  auto results = second.get_metrics_results();
+  results.get("thread_budget:compress:outer_threads", &outer);
+  results.get("thread_budget:compress:inner_threads", &inner_threads);
+  EXPECT_EQ(outer, 2u);
+  EXPECT_EQ(inner_threads, 2u);
+
+  //without the budget the configured thread count is used
+  EXPECT_EQ(library.set_options({{"pressio:thread_budget", 0}}), 0);
+  second.decompress(&output, &input);
+  EXPECT_EQ(inner.back(), 3u);
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "zfp.h"
+
+namespace {
+  pressio_data smooth_field(std::vector<size_t> const& dims) {
+    auto data = pressio_data::owning(pressio_double_dtype, dims);
+    auto ptr = static_cast<double*>(data.data());
+    for (size_t k = 0; k < dims[2]; ++k) {
+      for (size_t j = 0; j < dims[1]; ++j) {
+        for (size_t i = 0; i < dims[0]; ++i) {
+          ptr[i + dims[0] * (j + dims[1] * k)] = std::sin(0.1 * i) * std::cos(0.07 * j) + 0.01 * k;
+        }
+      }
+    }
+    return data;
+  }
+
+  double max_error(pressio_data const& a, pressio_data const& b) {
+    auto pa = static_cast<double*>(a.data());
+    auto pb = static_cast<double*>(b.data());
+    double error = 0;
+    for (size_t i = 0; i < a.num_elements(); ++i) error = std::max(error, std::abs(pa[i] - pb[i]));
+    return error;
+  }
+}
+
+TEST(ZfpPluginTests, ProgressiveDecompression) {
+  pressio library;
+  auto compressor = library.get_compressor("zfp");
+  ASSERT_TRUE(compressor);
+  const std::vector<size_t> dims{37, 30, 9};
+  auto input = smooth_field(dims);
+  ASSERT_EQ(compressor->set_options({{"zfp:accuracy", 1e-8}, {"zfp:progressive", 1}}), 0);
+
+  auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+  ASSERT_EQ(compressor->compress(&input, &compressed), 0);
+
+  auto full = pressio_data::owning(pressio_double_dtype, dims);
+  ASSERT_EQ(compressor->decompress(&compressed, &full), 0);
+  EXPECT_LE(max_error(input, full), 1e-8);
+
+  //a coarser accuracy decodes fewer bit planes of each block
+  ASSERT_EQ(compressor->set_options({{"zfp:progressive_accuracy", 1e-3}}), 0);
+  auto coarse = pressio_data::owning(pressio_double_dtype, dims);
+  ASSERT_EQ(compressor->decompress(&compressed, &coarse), 0);
+  EXPECT_LE(max_error(input, coarse), 1e-3);
+  EXPECT_GT(max_error(input, coarse), max_error(input, full));
+
+  //a byte budget reads a prefix of each block
+  ASSERT_EQ(compressor->set_options({{"zfp:progressive_accuracy", 0.0}, {"zfp:progressive_bytes", static_cast<unsigned int>(compressed.size_in_bytes() / 4)}}), 0);
+  auto budget = pressio_data::owning(pressio_double_dtype, dims);
+  ASSERT_EQ(compressor->decompress(&compressed, &budget), 0);
+  EXPECT_LT(max_error(input, budget), 1.0);
+
+  //the stream records its number of blocks
+  auto wrong = pressio_data::owning(pressio_double_dtype, {64, 64, 64});
+  EXPECT_NE(compressor->decompress(&compressed, &wrong), 0);
+}
+
+TEST(ZfpPluginTests, RegionDecompression) {
+  pressio library;
+  const std::vector<size_t> dims{37, 30, 9};
+  const std::vector<size_t> start{5, 11, 2}, count{9, 3, 6};
+  auto input = smooth_field(dims);
+
+  for (auto const& compression_options : std::vector<pressio_options>{
+      {{"zfp:rate", 16.0}, {"zfp:type", static_cast<unsigned int>(zfp_type_double)}, {"zfp:dims", 3u}, {"zfp:wra", 0}},
+      {{"zfp:accuracy", 1e-6}, {"zfp:progressive", 1}},
+      }) {
+    auto compressor = library.get_compressor("zfp");
+    ASSERT_EQ(compressor->set_options(compression_options), 0);
+    auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+    ASSERT_EQ(compressor->compress(&input, &compressed), 0);
+    auto full = pressio_data::owning(pressio_double_dtype, dims);
+    ASSERT_EQ(compressor->decompress(&compressed, &full), 0);
+
+    ASSERT_EQ(compressor->set_options({
+          {"zfp:region_start", pressio_data{5ul, 11ul, 2ul}},
+          {"zfp:region_count", pressio_data{9ul, 3ul, 6ul}},
+          }), 0);
+    auto region = pressio_data::owning(pressio_double_dtype, dims);
+    ASSERT_EQ(compressor->decompress(&compressed, &region), 0);
+    ASSERT_EQ(region.dimensions(), count);
+
+    //the region holds the same values as the corresponding part of a full decompression
+    auto expected = full.select(start, {1, 1, 1}, count, {1, 1, 1});
+    auto region_ptr = static_cast<double*>(region.data());
+    EXPECT_TRUE(std::equal(region_ptr, region_ptr + region.num_elements(), static_cast<double*>(expected.data())));
+
+    ASSERT_EQ(compressor->set_options({{"zfp:region_count", pressio_data{40ul, 3ul, 6ul}}}), 0);
+    EXPECT_NE(compressor->decompress(&compressed, &region), 0);
+  }
+}
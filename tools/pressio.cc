@@ -0,0 +1,451 @@
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/io.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "pressio_compressor.h"
+#include "pressio_tools.h"
+
+/*
+ * compresses or decompresses files with any compressor
+ *
+ * each file is handled by one of a pool of workers, each of which owns a
+ * clone of the configured compressor.  With -s, raw files are streamed through
+ * the compressor in slabs along the slowest varying dimension; the compressed
+ * file is then a sequence of frames, each a native endian uint64 size followed
+ * by the compressed slab.
+ */
+
+namespace {
+  using setting = std::pair<std::string, std::string>;
+
+  struct cli_config {
+    bool decompress = false;
+    std::string compressor = "noop";
+    std::vector<setting> settings;
+    std::string io = "posix";
+    std::vector<setting> io_settings;
+    pressio_dtype dtype = pressio_byte_dtype;
+    std::vector<size_t> dims;
+    size_t slab = 0;
+    size_t workers = 1;
+    std::vector<std::string> metrics;
+    std::string suffix;
+    std::string format = "text";
+    std::vector<std::string> files;
+  };
+
+  struct slab_result {
+    size_t input_bytes = 0;
+    size_t output_bytes = 0;
+    double seconds = 0;
+    std::map<std::string, std::string> metrics;
+  };
+
+  struct file_result {
+    std::string input;
+    std::string output;
+    std::string error;
+    std::vector<slab_result> slabs;
+  };
+
+  void usage(const char* name) {
+    std::cerr << "usage: " << name << " [options] file...\n"
+      << "  -c compressor   compressor to use (default noop)\n"
+      << "  -o key=value    compressor option, may be repeated\n"
+      << "  -x              decompress the files instead of compressing them\n"
+      << "  -i io           io module that reads uncompressed input or writes decompressed output (default posix)\n"
+      << "  -I key=value    io option, may be repeated; io:path is set to each file\n"
+      << "  -t dtype        dtype of the uncompressed data\n"
+      << "  -d d1,d2,...    dimensions of the uncompressed data, required to decompress\n"
+      << "  -s count        stream raw files in slabs of count indices of the last dimension\n"
+      << "  -j workers      number of files processed in parallel (default 1)\n"
+      << "  -m metric       metrics module whose results are reported, may be repeated\n"
+      << "  -e suffix       suffix appended to output files (default .pressio, or .out with -x)\n"
+      << "  -f text|json    output format (default text)\n"
+      << "  -h              show this message\n";
+  }
+
+  bool parse_args(int argc, char* argv[], cli_config& config) {
+    int opt;
+    setting kv;
+    std::vector<size_t> values;
+    while((opt = getopt(argc, argv, "c:o:xi:I:t:d:s:j:m:e:f:h")) != -1) {
+      switch(opt) {
+        case 'c':
+          config.compressor = optarg;
+          break;
+        case 'o':
+          if(not parse_key_value(optarg, kv)) { std::cerr << "invalid option " << optarg << std::endl; return false; }
+          config.settings.emplace_back(kv);
+          break;
+        case 'x':
+          config.decompress = true;
+          break;
+        case 'i':
+          config.io = optarg;
+          break;
+        case 'I':
+          if(not parse_key_value(optarg, kv)) { std::cerr << "invalid io option " << optarg << std::endl; return false; }
+          config.io_settings.emplace_back(kv);
+          break;
+        case 't':
+          if(not parse_dtype(optarg, config.dtype)) { std::cerr << "invalid dtype " << optarg << std::endl; return false; }
+          break;
+        case 'd':
+          if(not parse_dims(optarg, config.dims)) { std::cerr << "invalid dims " << optarg << std::endl; return false; }
+          break;
+        case 's':
+          if(not parse_dims(optarg, values) || values.size() != 1) { std::cerr << "invalid slab size " << optarg << std::endl; return false; }
+          config.slab = values.front();
+          break;
+        case 'j':
+          if(not parse_dims(optarg, values) || values.size() != 1) { std::cerr << "invalid worker count " << optarg << std::endl; return false; }
+          config.workers = values.front();
+          break;
+        case 'm':
+          config.metrics.emplace_back(optarg);
+          break;
+        case 'e':
+          config.suffix = optarg;
+          break;
+        case 'f':
+          config.format = optarg;
+          if(config.format != "text" && config.format != "json") { std::cerr << "invalid format " << optarg << std::endl; return false; }
+          break;
+        case 'h':
+        default:
+          return false;
+      }
+    }
+    for (int i = optind; i < argc; ++i) config.files.emplace_back(argv[i]);
+    if(config.files.empty()) { std::cerr << "at least one file is required" << std::endl; return false; }
+    if(config.decompress && config.dims.empty()) { std::cerr << "-d is required to decompress" << std::endl; return false; }
+    if(config.slab && config.dims.empty()) { std::cerr << "-d is required to stream slabs" << std::endl; return false; }
+    if(config.suffix.empty()) config.suffix = config.decompress ? ".out" : ".pressio";
+    return true;
+  }
+
+  /**
+   * the state owned by each worker
+   */
+  struct worker_state {
+    std::shared_ptr<libpressio_compressor_plugin> compressor;
+    std::shared_ptr<libpressio_io_plugin> io;
+    std::mutex* serialize;
+  };
+
+  struct cli_error {
+    std::string msg;
+  };
+
+  class file_processor {
+    public:
+    file_processor(cli_config const& config, worker_state& state): config(config), state(state) {}
+
+    file_result process(std::string const& path) {
+      file_result result;
+      result.input = path;
+      result.output = path + config.suffix;
+      try {
+        if(config.slab) process_slabs(result);
+        else if(config.decompress) decompress_file(result);
+        else compress_file(result);
+      } catch (cli_error const& e) {
+        result.error = e.msg;
+      }
+      return result;
+    }
+
+    private:
+    void compress_file(file_result& result) {
+      pressio_data input = read_input(result.input);
+      result.slabs.emplace_back(compress_slab(input, [&](pressio_data const& compressed) {
+        std::ofstream out(result.output, std::ios::binary);
+        out.write(static_cast<const char*>(compressed.data()), compressed.size_in_bytes());
+        if(!out) throw cli_error{"failed to write " + result.output};
+      }));
+    }
+
+    void decompress_file(file_result& result) {
+      std::ifstream in(result.input, std::ios::binary | std::ios::ate);
+      if(!in) throw cli_error{"failed to open " + result.input};
+      auto compressed = pressio_data::owning(pressio_byte_dtype, {static_cast<size_t>(in.tellg())});
+      in.seekg(0);
+      in.read(static_cast<char*>(compressed.data()), compressed.size_in_bytes());
+      if(!in) throw cli_error{"failed to read " + result.input};
+
+      result.slabs.emplace_back(decompress_slab(compressed, config.dims, [&](pressio_data const& decompressed) {
+        write_output(result.output, decompressed);
+      }));
+    }
+
+    /*
+     * raw files are read and written slab by slab so that only one slab is in
+     * memory at a time
+     */
+    void process_slabs(file_result& result) {
+      std::ifstream in(result.input, std::ios::binary);
+      std::ofstream out(result.output, std::ios::binary);
+      if(!in) throw cli_error{"failed to open " + result.input};
+      if(!out) throw cli_error{"failed to open " + result.output};
+
+      const size_t slowest = config.dims.back();
+      for (size_t begin = 0; begin < slowest; begin += config.slab) {
+        auto slab_dims = config.dims;
+        slab_dims.back() = std::min(config.slab, slowest - begin);
+
+        if(config.decompress) {
+          uint64_t frame_size = 0;
+          in.read(reinterpret_cast<char*>(&frame_size), sizeof(frame_size));
+          auto compressed = pressio_data::owning(pressio_byte_dtype, {static_cast<size_t>(frame_size)});
+          in.read(static_cast<char*>(compressed.data()), compressed.size_in_bytes());
+          if(!in) throw cli_error{"truncated frame in " + result.input};
+          result.slabs.emplace_back(decompress_slab(compressed, slab_dims, [&](pressio_data const& decompressed) {
+            out.write(static_cast<const char*>(decompressed.data()), decompressed.size_in_bytes());
+          }));
+        } else {
+          auto input = pressio_data::owning(config.dtype, slab_dims);
+          in.read(static_cast<char*>(input.data()), input.size_in_bytes());
+          if(!in) throw cli_error{result.input + " is smaller than the given dimensions"};
+          result.slabs.emplace_back(compress_slab(input, [&](pressio_data const& compressed) {
+            const uint64_t frame_size = compressed.size_in_bytes();
+            out.write(reinterpret_cast<const char*>(&frame_size), sizeof(frame_size));
+            out.write(static_cast<const char*>(compressed.data()), compressed.size_in_bytes());
+          }));
+        }
+        if(!out) throw cli_error{"failed to write " + result.output};
+      }
+    }
+
+    slab_result compress_slab(pressio_data const& input, std::function<void(pressio_data const&)> const& write) {
+      slab_result slab;
+      auto compressed = pressio_data::empty(pressio_byte_dtype, {});
+      slab.seconds = timed([&]{ return state.compressor->compress(&input, &compressed); });
+      //error metrics need the decompressed data, so round trip when metrics are requested
+      if(!config.metrics.empty()) {
+        auto decompressed = pressio_data::owning(input.dtype(), input.dimensions());
+        timed([&]{ return state.compressor->decompress(&compressed, &decompressed); });
+        slab.metrics = metrics_results();
+      }
+      slab.input_bytes = input.size_in_bytes();
+      slab.output_bytes = compressed.size_in_bytes();
+      write(compressed);
+      return slab;
+    }
+
+    slab_result decompress_slab(pressio_data const& compressed, std::vector<size_t> const& dims,
+        std::function<void(pressio_data const&)> const& write) {
+      slab_result slab;
+      auto decompressed = pressio_data::owning(config.dtype, dims);
+      slab.seconds = timed([&]{ return state.compressor->decompress(&compressed, &decompressed); });
+      if(!config.metrics.empty()) slab.metrics = metrics_results();
+      slab.input_bytes = compressed.size_in_bytes();
+      slab.output_bytes = decompressed.size_in_bytes();
+      write(decompressed);
+      return slab;
+    }
+
+    /**
+     * runs a compressor operation, serializing it for compressors that are not thread safe
+     * \returns the duration of the operation in seconds
+     */
+    double timed(std::function<int()> const& operation) {
+      std::unique_lock<std::mutex> lock;
+      if(state.serialize) lock = std::unique_lock<std::mutex>(*state.serialize);
+      auto begin = std::chrono::steady_clock::now();
+      if(operation()) throw cli_error{state.compressor->error_msg()};
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    std::map<std::string, std::string> metrics_results() const {
+      std::map<std::string, std::string> results;
+      for (auto const& entry : state.compressor->get_metrics_results()) {
+        auto value = entry.second.as(pressio_option_charptr_type, pressio_conversion_special);
+        if(value.has_value()) results[entry.first] = value.get_value<std::string>();
+      }
+      return results;
+    }
+
+    pressio_data read_input(std::string const& path) {
+      set_io_path(path);
+      pressio_data* template_data = config.dims.empty() ? nullptr :
+        pressio_data_new_empty(config.dtype, config.dims.size(), config.dims.data());
+      pressio_data* read = state.io->read(template_data);
+      if(read == nullptr) throw cli_error{state.io->error_msg()};
+      pressio_data input(std::move(*read));
+      pressio_data_free(read);
+      return input;
+    }
+
+    void write_output(std::string const& path, pressio_data const& data) {
+      set_io_path(path);
+      if(state.io->write(&data)) throw cli_error{state.io->error_msg()};
+    }
+
+    void set_io_path(std::string const& path) {
+      if(state.io->set_options({{"io:path", path}})) throw cli_error{state.io->error_msg()};
+    }
+
+    cli_config const& config;
+    worker_state& state;
+  };
+
+  /**
+   * creates the compressor and io module used by the first worker
+   * \returns false on failure after reporting the error
+   */
+  bool configure(pressio& library, cli_config const& config, worker_state& state) {
+    state.compressor = library.get_compressor(config.compressor);
+    if(not state.compressor) {
+      std::cerr << library.err_msg() << std::endl;
+      return false;
+    }
+    auto options = state.compressor->get_options();
+    std::string error;
+    if(not apply_settings(options, config.settings, error) || state.compressor->set_options(options)) {
+      std::cerr << config.compressor << ": " << (error.empty() ? state.compressor->error_msg() : error) << std::endl;
+      return false;
+    }
+
+    state.io = library.get_io(config.io);
+    if(not state.io) {
+      std::cerr << library.err_msg() << std::endl;
+      return false;
+    }
+    auto io_options = state.io->get_options();
+    error.clear();
+    if(not apply_settings(io_options, config.io_settings, error) || state.io->set_options(io_options)) {
+      std::cerr << config.io << ": " << (error.empty() ? state.io->error_msg() : error) << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool attach_metrics(pressio& library, cli_config const& config, libpressio_compressor_plugin& compressor) {
+    if(config.metrics.empty()) return true;
+    pressio_metrics metrics(library.get_metrics(config.metrics.begin(), config.metrics.end()));
+    if(not metrics) {
+      std::cerr << library.err_msg() << std::endl;
+      return false;
+    }
+    compressor.set_metrics(metrics);
+    return true;
+  }
+
+  void print_results(cli_config const& config, std::vector<file_result> const& results, double seconds) {
+    size_t total_input = 0, total_output = 0;
+    for (auto const& file : results) {
+      for (auto const& slab : file.slabs) {
+        total_input += slab.input_bytes;
+        total_output += slab.output_bytes;
+      }
+    }
+    const double throughput = (seconds > 0) ? static_cast<double>(config.decompress ? total_output : total_input) / seconds / 1e6 : 0;
+
+    std::cout.precision(10);
+    if(config.format == "text") {
+      for (auto const& file : results) {
+        if(!file.error.empty()) {
+          std::cout << file.input << ": error: " << file.error << '\n';
+          continue;
+        }
+        for (size_t i = 0; i < file.slabs.size(); ++i) {
+          auto const& slab = file.slabs[i];
+          std::cout << file.input;
+          if(config.slab) std::cout << '[' << i << ']';
+          std::cout << " -> " << file.output << ": " << slab.input_bytes << " -> " << slab.output_bytes
+            << " bytes in " << slab.seconds << " s";
+          for (auto const& metric : slab.metrics) std::cout << ' ' << metric.first << '=' << metric.second;
+          std::cout << '\n';
+        }
+      }
+      std::cout << results.size() << " files, " << total_input << " -> " << total_output << " bytes in "
+        << seconds << " s (" << throughput << " MB/s)" << std::endl;
+    } else {
+      std::cout << "{\"seconds\": " << seconds << ", \"input_bytes\": " << total_input
+        << ", \"output_bytes\": " << total_output << ", \"MBps\": " << throughput << ", \"files\": [\n";
+      for (size_t f = 0; f < results.size(); ++f) {
+        auto const& file = results[f];
+        std::cout << "  {\"input\": \"" << json_escape(file.input) << "\", \"output\": \"" << json_escape(file.output) << '"';
+        if(!file.error.empty()) std::cout << ", \"error\": \"" << json_escape(file.error) << '"';
+        std::cout << ", \"slabs\": [";
+        for (size_t i = 0; i < file.slabs.size(); ++i) {
+          auto const& slab = file.slabs[i];
+          std::cout << (i ? ", " : "") << "{\"input_bytes\": " << slab.input_bytes << ", \"output_bytes\": " << slab.output_bytes
+            << ", \"seconds\": " << slab.seconds << ", \"metrics\": {";
+          bool first = true;
+          for (auto const& metric : slab.metrics) {
+            std::cout << (first ? "" : ", ") << '"' << json_escape(metric.first) << "\": \"" << json_escape(metric.second) << '"';
+            first = false;
+          }
+          std::cout << "}}";
+        }
+        std::cout << "]}" << (f + 1 < results.size() ? "," : "") << '\n';
+      }
+      std::cout << "]}" << std::endl;
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  cli_config config;
+  if(not parse_args(argc, argv, config)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  pressio library;
+  const size_t nworkers = std::max<size_t>(1, std::min(config.workers, config.files.size()));
+  std::vector<worker_state> states(nworkers);
+  if(not configure(library, config, states.front())) return 1;
+
+  //unless a compressor is safe across instances its clones may share global state, so their calls are serialized
+  std::mutex serialize;
+  int thread_safety = pressio_thread_safety_single;
+  states.front().compressor->get_configuration().get("pressio:thread_safe", &thread_safety);
+  for (size_t w = 0; w < nworkers; ++w) {
+    auto& state = states[w];
+    if(w != 0) {
+      state.compressor = states.front().compressor->clone();
+      state.io = states.front().io->clone();
+    }
+    state.serialize = (thread_safety != pressio_thread_safety_multiple) ? &serialize : nullptr;
+    if(not attach_metrics(library, config, *state.compressor)) return 1;
+  }
+
+  std::vector<file_result> results(config.files.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&](size_t w) {
+    file_processor processor(config, states[w]);
+    for (size_t i = next++; i < config.files.size(); i = next++) {
+      results[i] = processor.process(config.files[i]);
+    }
+  };
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t w = 1; w < nworkers; ++w) threads.emplace_back(worker, w);
+  worker(0);
+  for (auto& thread : threads) thread.join();
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  print_results(config, results, seconds);
+  return std::any_of(results.begin(), results.end(), [](file_result const& r) { return !r.error.empty(); }) ? 1 : 0;
+}
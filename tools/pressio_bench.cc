@@ -0,0 +1,459 @@
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libpressio_ext/cpp/compressor.h"
+#include "libpressio_ext/cpp/data.h"
+#include "libpressio_ext/cpp/io.h"
+#include "libpressio_ext/cpp/metrics.h"
+#include "libpressio_ext/cpp/options.h"
+#include "libpressio_ext/cpp/pressio.h"
+#include "pressio_compressor.h"
+#include "pressio_tools.h"
+
+namespace {
+  using setting = std::pair<std::string, std::string>;
+
+  struct dataset_spec {
+    std::string io;
+    std::vector<setting> settings;
+    pressio_dtype dtype = pressio_byte_dtype;
+    std::vector<size_t> dims;
+  };
+
+  struct bench_config {
+    std::vector<std::string> compressors;
+    std::vector<setting> settings;
+    std::vector<std::pair<std::string, std::vector<std::string>>> sweeps;
+    std::vector<dataset_spec> datasets;
+    std::vector<size_t> threads{1};
+    std::vector<std::string> metrics;
+    unsigned int warmup = 1;
+    unsigned int repetitions = 5;
+    std::string format = "csv";
+    std::string output;
+    bool pin = false;
+  };
+
+  struct bench_result {
+    std::string compressor;
+    std::string options;
+    std::string dataset;
+    size_t threads;
+    size_t input_bytes;
+    size_t compressed_bytes;
+    std::vector<double> compress_seconds;
+    std::vector<double> decompress_seconds;
+    std::map<std::string, double> metrics;
+  };
+
+  void usage(const char* name) {
+    std::cerr << "usage: " << name << " [options]\n"
+      << "  -c compressor   compressor to benchmark, may be repeated or comma separated\n"
+      << "  -o key=value    compressor option applied to every run\n"
+      << "  -s key=v1,v2    compressor option to sweep over, sweeps form a cartesian product\n"
+      << "  -i io           io module used to load a dataset, starts a new dataset\n"
+      << "  -I key=value    io option for the most recent dataset\n"
+      << "  -t dtype        dtype of the most recent dataset\n"
+      << "  -d d1,d2,...    dimensions of the most recent dataset\n"
+      << "  -n t1,t2,...    thread counts, each thread compresses the dataset with its own compressor (default 1)\n"
+      << "  -w count        warm-up runs before timing (default 1)\n"
+      << "  -r count        timed repetitions (default 5)\n"
+      << "  -m metric       metrics module whose results are reported, may be repeated\n"
+      << "  -f csv|json     output format (default csv)\n"
+      << "  -O path         write results to path instead of stdout\n"
+      << "  -p              pin each thread to its own cpu\n"
+      << "  -h              show this message\n";
+  }
+
+  bool parse_args(int argc, char* argv[], bench_config& config) {
+    int opt;
+    std::pair<std::string, std::string> kv;
+    while((opt = getopt(argc, argv, "c:o:s:i:I:t:d:n:w:r:m:f:O:ph")) != -1) {
+      switch(opt) {
+        case 'c':
+          for (auto const& id : split(optarg, ',')) config.compressors.emplace_back(id);
+          break;
+        case 'o':
+          if(not parse_key_value(optarg, kv)) { std::cerr << "invalid option " << optarg << std::endl; return false; }
+          config.settings.emplace_back(kv);
+          break;
+        case 's':
+          if(not parse_key_value(optarg, kv)) { std::cerr << "invalid sweep " << optarg << std::endl; return false; }
+          config.sweeps.emplace_back(kv.first, split(kv.second, ','));
+          break;
+        case 'i':
+          config.datasets.emplace_back();
+          config.datasets.back().io = optarg;
+          break;
+        case 'I':
+          if(config.datasets.empty()) { std::cerr << "-I requires a preceding -i" << std::endl; return false; }
+          if(not parse_key_value(optarg, kv)) { std::cerr << "invalid io option " << optarg << std::endl; return false; }
+          config.datasets.back().settings.emplace_back(kv);
+          break;
+        case 't':
+          if(config.datasets.empty()) { std::cerr << "-t requires a preceding -i" << std::endl; return false; }
+          if(not parse_dtype(optarg, config.datasets.back().dtype)) { std::cerr << "invalid dtype " << optarg << std::endl; return false; }
+          break;
+        case 'd':
+          if(config.datasets.empty()) { std::cerr << "-d requires a preceding -i" << std::endl; return false; }
+          if(not parse_dims(optarg, config.datasets.back().dims)) { std::cerr << "invalid dims " << optarg << std::endl; return false; }
+          break;
+        case 'n':
+          if(not parse_dims(optarg, config.threads)) { std::cerr << "invalid thread counts " << optarg << std::endl; return false; }
+          break;
+        case 'w':
+          if(not parse_count(optarg, config.warmup)) { std::cerr << "invalid warmup count " << optarg << std::endl; return false; }
+          break;
+        case 'r':
+          if(not parse_count(optarg, config.repetitions)) { std::cerr << "invalid repetition count " << optarg << std::endl; return false; }
+          config.repetitions = std::max(1u, config.repetitions);
+          break;
+        case 'm':
+          config.metrics.emplace_back(optarg);
+          break;
+        case 'f':
+          config.format = optarg;
+          if(config.format != "csv" && config.format != "json") { std::cerr << "invalid format " << optarg << std::endl; return false; }
+          break;
+        case 'O':
+          config.output = optarg;
+          break;
+        case 'p':
+          config.pin = true;
+          break;
+        case 'h':
+        default:
+          return false;
+      }
+    }
+    if(config.compressors.empty()) { std::cerr << "at least one compressor is required" << std::endl; return false; }
+    if(config.datasets.empty()) { std::cerr << "at least one dataset is required" << std::endl; return false; }
+    return true;
+  }
+
+  /**
+   * expands the sweeps into every combination of settings
+   */
+  std::vector<std::vector<setting>> expand_sweeps(bench_config const& config) {
+    std::vector<std::vector<setting>> combinations{config.settings};
+    for (auto const& sweep : config.sweeps) {
+      std::vector<std::vector<setting>> expanded;
+      for (auto const& combination : combinations) {
+        for (auto const& value : sweep.second) {
+          expanded.emplace_back(combination);
+          expanded.back().emplace_back(sweep.first, value);
+        }
+      }
+      combinations = std::move(expanded);
+    }
+    return combinations;
+  }
+
+  std::string describe(std::vector<setting> const& settings) {
+    std::string description;
+    for (auto const& s : settings) {
+      if(!description.empty()) description += ';';
+      description += s.first + '=' + s.second;
+    }
+    return description;
+  }
+
+  bool load_dataset(pressio& library, dataset_spec const& spec, pressio_data& data) {
+    auto io = library.get_io(spec.io);
+    if(not io) {
+      std::cerr << library.err_msg() << std::endl;
+      return false;
+    }
+    auto options = io->get_options();
+    std::string error;
+    if(not apply_settings(options, spec.settings, error) || io->set_options(options)) {
+      std::cerr << spec.io << ": " << (error.empty() ? io->error_msg() : error) << std::endl;
+      return false;
+    }
+    pressio_data* template_data = spec.dims.empty() ? nullptr : pressio_data_new_empty(spec.dtype, spec.dims.size(), spec.dims.data());
+    pressio_data* read = io->read(template_data);
+    if(read == nullptr) {
+      std::cerr << spec.io << ": " << io->error_msg() << std::endl;
+      return false;
+    }
+    data = std::move(*read);
+    pressio_data_free(read);
+    return true;
+  }
+
+  /**
+   * the cpus this process may run on, used to pin threads
+   */
+  std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if(CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+      }
+    }
+    return cpus;
+  }
+
+  void pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  /**
+   * runs task(thread) on each thread after all threads have started
+   * \returns the elapsed wall time in seconds from the first start to the last finish, or a negative value if a task failed
+   */
+  template <class Task>
+  double run_parallel(size_t nthreads, std::vector<int> const& cpus, Task&& task) {
+    using clock = std::chrono::steady_clock;
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> failed{false};
+    std::vector<clock::time_point> begins(nthreads), ends(nthreads);
+    auto worker = [&](size_t thread) {
+      if(!cpus.empty()) pin_thread(cpus[thread % cpus.size()]);
+      ready.fetch_add(1);
+      while(ready.load() < nthreads) std::this_thread::yield();
+      begins[thread] = clock::now();
+      if(task(thread)) failed = true;
+      ends[thread] = clock::now();
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < nthreads; ++thread) {
+      workers.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (auto& w : workers) w.join();
+
+    if(failed) return -1;
+    auto begin = *std::min_element(begins.begin(), begins.end());
+    auto end = *std::max_element(ends.begin(), ends.end());
+    return std::chrono::duration<double>(end - begin).count();
+  }
+
+  double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    return (n % 2) ? values[n/2] : (values[n/2 - 1] + values[n/2]) / 2;
+  }
+
+  double minimum(std::vector<double> const& values) {
+    return *std::min_element(values.begin(), values.end());
+  }
+
+  bool benchmark(pressio& library, bench_config const& config, std::shared_ptr<libpressio_compressor_plugin> const& compressor,
+      pressio_data const& input, size_t nthreads, std::vector<int> const& cpus, bench_result& result) {
+    std::vector<std::shared_ptr<libpressio_compressor_plugin>> compressors{compressor};
+    std::vector<pressio_data> compressed, decompressed;
+    for (size_t thread = 0; thread < nthreads; ++thread) {
+      if(thread != 0) compressors.emplace_back(compressor->clone());
+      compressed.emplace_back(pressio_data::empty(pressio_byte_dtype, {}));
+      decompressed.emplace_back(pressio_data::owning(input.dtype(), input.dimensions()));
+    }
+
+    auto compress = [&](size_t thread) { return compressors[thread]->compress(&input, &compressed[thread]); };
+    auto decompress = [&](size_t thread) { return compressors[thread]->decompress(&compressed[thread], &decompressed[thread]); };
+
+    for (unsigned int run = 0; run < config.warmup + config.repetitions; ++run) {
+      double compress_time = run_parallel(nthreads, cpus, compress);
+      double decompress_time = (compress_time < 0) ? -1 : run_parallel(nthreads, cpus, decompress);
+      if(compress_time < 0 || decompress_time < 0) {
+        for (auto const& c : compressors) {
+          if(c->error_code()) {
+            std::cerr << result.compressor << ": " << c->error_msg() << std::endl;
+            break;
+          }
+        }
+        return false;
+      }
+      if(run >= config.warmup) {
+        result.compress_seconds.push_back(compress_time);
+        result.decompress_seconds.push_back(decompress_time);
+      }
+    }
+    result.compressed_bytes = compressed.front().size_in_bytes();
+
+    //metrics are collected in a separate untimed run so they do not perturb the timings
+    if(!config.metrics.empty()) {
+      auto metered = compressor->clone();
+      pressio_metrics metrics(library.get_metrics(config.metrics.begin(), config.metrics.end()));
+      if(not metrics) {
+        std::cerr << library.err_msg() << std::endl;
+        return false;
+      }
+      metered->set_metrics(metrics);
+      pressio_data metered_compressed = pressio_data::empty(pressio_byte_dtype, {});
+      pressio_data metered_decompressed = pressio_data::owning(input.dtype(), input.dimensions());
+      if(metered->compress(&input, &metered_compressed) || metered->decompress(&metered_compressed, &metered_decompressed)) {
+        std::cerr << result.compressor << ": " << metered->error_msg() << std::endl;
+        return false;
+      }
+      for (auto const& entry : metered->get_metrics_results()) {
+        auto value = entry.second.as(pressio_option_double_type, pressio_conversion_explicit);
+        if(value.has_value()) result.metrics[entry.first] = value.get_value<double>();
+      }
+    }
+    return true;
+  }
+
+  std::string csv_field(std::string const& field) {
+    if(field.find_first_of(",\"\n") == std::string::npos) return field;
+    std::string quoted = "\"";
+    for (char c : field) {
+      if(c == '"') quoted += '"';
+      quoted += c;
+    }
+    return quoted + '"';
+  }
+
+  void print_results(std::ostream& out, bench_config const& config, std::vector<bench_result> const& results) {
+    out.precision(10);
+    std::vector<std::string> metric_names;
+    for (auto const& result : results) {
+      for (auto const& metric : result.metrics) {
+        if(std::find(metric_names.begin(), metric_names.end(), metric.first) == metric_names.end()) {
+          metric_names.push_back(metric.first);
+        }
+      }
+    }
+    std::sort(metric_names.begin(), metric_names.end());
+
+    auto stats = [](bench_result const& r) {
+      const double mb = static_cast<double>(r.input_bytes) * r.threads / 1e6;
+      return std::vector<std::pair<std::string, double>>{
+        {"compression_ratio", r.compressed_bytes ? static_cast<double>(r.input_bytes) / r.compressed_bytes : 0.0},
+        {"compress_seconds_median", median(r.compress_seconds)},
+        {"compress_seconds_min", minimum(r.compress_seconds)},
+        {"compress_MBps", mb / median(r.compress_seconds)},
+        {"decompress_seconds_median", median(r.decompress_seconds)},
+        {"decompress_seconds_min", minimum(r.decompress_seconds)},
+        {"decompress_MBps", mb / median(r.decompress_seconds)},
+      };
+    };
+
+    if(config.format == "csv") {
+      out << "compressor,options,dataset,threads,repetitions,input_bytes,compressed_bytes";
+      if(!results.empty()) for (auto const& stat : stats(results.front())) out << ',' << stat.first;
+      for (auto const& name : metric_names) out << ',' << csv_field(name);
+      out << '\n';
+      for (auto const& r : results) {
+        out << csv_field(r.compressor) << ',' << csv_field(r.options) << ',' << csv_field(r.dataset) << ','
+          << r.threads << ',' << r.compress_seconds.size() << ',' << r.input_bytes << ',' << r.compressed_bytes;
+        for (auto const& stat : stats(r)) out << ',' << stat.second;
+        for (auto const& name : metric_names) {
+          out << ',';
+          auto it = r.metrics.find(name);
+          if(it != r.metrics.end()) out << it->second;
+        }
+        out << '\n';
+      }
+    } else {
+      out << "[\n";
+      for (size_t i = 0; i < results.size(); ++i) {
+        auto const& r = results[i];
+        out << "  {\"compressor\": \"" << json_escape(r.compressor) << "\", \"options\": \"" << json_escape(r.options)
+          << "\", \"dataset\": \"" << json_escape(r.dataset) << "\", \"threads\": " << r.threads
+          << ", \"repetitions\": " << r.compress_seconds.size() << ", \"input_bytes\": " << r.input_bytes
+          << ", \"compressed_bytes\": " << r.compressed_bytes;
+        for (auto const& stat : stats(r)) out << ", \"" << stat.first << "\": " << stat.second;
+        out << ", \"metrics\": {";
+        bool first = true;
+        for (auto const& metric : r.metrics) {
+          out << (first ? "" : ", ") << '"' << json_escape(metric.first) << "\": " << metric.second;
+          first = false;
+        }
+        out << "}}" << (i + 1 < results.size() ? "," : "") << '\n';
+      }
+      out << "]\n";
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  bench_config config;
+  if(not parse_args(argc, argv, config)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  pressio library;
+  std::vector<std::pair<std::string, pressio_data>> datasets;
+  for (auto const& spec : config.datasets) {
+    pressio_data data = pressio_data::empty(pressio_byte_dtype, {});
+    if(not load_dataset(library, spec, data)) return 1;
+    std::string name = spec.io;
+    if(!spec.settings.empty()) name += ':' + describe(spec.settings);
+    datasets.emplace_back(name, std::move(data));
+  }
+
+  const std::vector<int> cpus = config.pin ? allowed_cpus() : std::vector<int>{};
+  std::vector<bench_result> results;
+  int status = 0;
+  for (auto const& compressor_id : config.compressors) {
+    for (auto const& settings : expand_sweeps(config)) {
+      auto compressor = library.get_compressor(compressor_id);
+      if(not compressor) {
+        std::cerr << library.err_msg() << std::endl;
+        status = 1;
+        break;
+      }
+      auto options = compressor->get_options();
+      std::string error;
+      if(not apply_settings(options, settings, error) || compressor->set_options(options)) {
+        std::cerr << compressor_id << ": " << (error.empty() ? compressor->error_msg() : error) << std::endl;
+        status = 1;
+        continue;
+      }
+      int thread_safety = pressio_thread_safety_single;
+      compressor->get_configuration().get("pressio:thread_safe", &thread_safety);
+
+      for (auto const& dataset : datasets) {
+        for (size_t nthreads : config.threads) {
+          if(nthreads > 1 && thread_safety != pressio_thread_safety_multiple) {
+            std::cerr << compressor_id << ": skipping " << nthreads << " threads, the compressor is not thread safe" << std::endl;
+            continue;
+          }
+          bench_result result;
+          result.compressor = compressor_id;
+          result.options = describe(settings);
+          result.dataset = dataset.first;
+          result.threads = nthreads;
+          result.input_bytes = dataset.second.size_in_bytes();
+          if(benchmark(library, config, compressor, dataset.second, nthreads, cpus, result)) {
+            results.emplace_back(std::move(result));
+          } else {
+            status = 1;
+          }
+        }
+      }
+    }
+  }
+
+  if(config.output.empty()) {
+    print_results(std::cout, config, results);
+  } else {
+    std::ofstream out(config.output);
+    print_results(out, config, results);
+    if(!out) {
+      std::cerr << "failed to write " << config.output << std::endl;
+      return 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,146 @@
+#ifndef PRESSIO_TOOLS_H
+#define PRESSIO_TOOLS_H
+
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "pressio_dtype.h"
+#include "libpressio_ext/cpp/options.h"
+
+/**
+ * \file
+ * \brief helpers shared by the command line tools
+ */
+
+/**
+ * splits a string on a delimiter, keeping empty fields
+ */
+inline std::vector<std::string> split(std::string const& str, char delim) {
+  std::vector<std::string> fields;
+  std::istringstream ss(str);
+  std::string field;
+  while(std::getline(ss, field, delim)) {
+    fields.emplace_back(field);
+  }
+  if(!str.empty() && str.back() == delim) fields.emplace_back();
+  return fields;
+}
+
+/**
+ * splits an argument of the form key=value
+ * \returns false if the argument does not contain an =
+ */
+inline bool parse_key_value(std::string const& arg, std::pair<std::string, std::string>& kv) {
+  auto pos = arg.find('=');
+  if(pos == std::string::npos || pos == 0) return false;
+  kv = {arg.substr(0, pos), arg.substr(pos + 1)};
+  return true;
+}
+
+/**
+ * converts string values to the types expected by a plugin and stores them into options
+ *
+ * \param[in,out] options the options of the plugin, used to determine the type of each key
+ * \param[in] settings the keys and string values to set
+ * \param[out] error a description of the first setting which could not be applied
+ * \returns false if a key is not supported by the plugin or its value cannot be converted
+ */
+inline bool apply_settings(pressio_options& options, std::vector<std::pair<std::string, std::string>> const& settings, std::string& error) {
+  for (auto const& setting : settings) {
+    if(options.key_status(setting.first) == pressio_options_key_does_not_exist) {
+      error = "unknown option " + setting.first;
+      return false;
+    }
+    if(options.cast_set(setting.first, pressio_option(setting.second), pressio_conversion_special) != pressio_options_key_set) {
+      error = "invalid value " + setting.second + " for option " + setting.first;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * parses the name of a dtype such as float, double, int32, or uint8
+ * \returns false if the name is not recognized
+ */
+inline bool parse_dtype(std::string const& name, pressio_dtype& dtype) {
+  static const std::vector<std::pair<std::string, pressio_dtype>> names {
+    {"float", pressio_float_dtype},
+    {"double", pressio_double_dtype},
+    {"int8", pressio_int8_dtype},
+    {"int16", pressio_int16_dtype},
+    {"int32", pressio_int32_dtype},
+    {"int64", pressio_int64_dtype},
+    {"uint8", pressio_uint8_dtype},
+    {"uint16", pressio_uint16_dtype},
+    {"uint32", pressio_uint32_dtype},
+    {"uint64", pressio_uint64_dtype},
+    {"byte", pressio_byte_dtype},
+  };
+  for (auto const& entry : names) {
+    if(entry.first == name) {
+      dtype = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * parses a count such as a number of repetitions
+ * \returns false if the count is not a non-negative integer that fits in an unsigned int
+ */
+inline bool parse_count(std::string const& str, unsigned int& count) {
+  if(str.empty() || str[0] < '0' || str[0] > '9') return false;
+  try {
+    size_t pos;
+    unsigned long long value = std::stoull(str, &pos);
+    if(pos != str.size() || value > std::numeric_limits<unsigned int>::max()) return false;
+    count = static_cast<unsigned int>(value);
+    return true;
+  } catch (std::exception const&) {
+    return false;
+  }
+}
+
+/**
+ * parses a comma separated list of dimensions
+ * \returns false if a dimension is not a positive integer
+ */
+inline bool parse_dims(std::string const& str, std::vector<size_t>& dims) {
+  dims.clear();
+  for (auto const& field : split(str, ',')) {
+    try {
+      size_t pos;
+      unsigned long long dim = std::stoull(field, &pos);
+      if(pos != field.size() || dim == 0) return false;
+      dims.push_back(static_cast<size_t>(dim));
+    } catch (std::exception const&) {
+      return false;
+    }
+  }
+  return !dims.empty();
+}
+
+/**
+ * escapes a string for use in a JSON document
+ */
+inline std::string json_escape(std::string const& str) {
+  std::string escaped;
+  for (char c : str) {
+    switch(c) {
+      case '"': escaped += "\\\""; break;
+      case '\\': escaped += "\\\\"; break;
+      case '\n': escaped += "\\n"; break;
+      case '\t': escaped += "\\t"; break;
+      default: escaped += c;
+    }
+  }
+  return escaped;
+}
+
+#endif /* end of include guard: PRESSIO_TOOLS_H */